@@ -0,0 +1,56 @@
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include "loganalyzer.h"
+
+ //all doxygen comments are generated with AI assistance
+
+namespace {
+
+void usage() {
+    std::cerr << "Usage: log_analyzer [--threads N] [--csv PREFIX] [LOG_FILE]\n"
+              << "Rebuilds busy timelines, the queue-depth curve, scale events and rejection counts\n"
+              << "from a load_balancer log (default load_balancer_log.txt)." << std::endl;
+}
+
+} // namespace
+
+/**
+ * @brief Entry point of the offline log analyzer.
+ *
+ * Parses the log on all cores (or --threads N), prints a summary and, with
+ * --csv PREFIX, writes the reconstructed timelines for plotting.
+ *
+ * @return int Status code of the program (0 for success).
+ */
+int main(int argc, char* argv[]) {
+    std::string logFile = "load_balancer_log.txt";
+    std::string csvPrefix;
+    int threads = 0;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--threads" && hasValue) {
+            threads = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--csv" && hasValue) {
+            csvPrefix = argv[++i];
+        } else if (!arg.empty() && arg[0] != '-') {
+            logFile = arg;
+        } else {
+            usage();
+            return 1;
+        }
+    }
+
+    LogAnalyzer analyzer;
+    if (!analyzer.analyze(logFile, threads)) {
+        return 1;
+    }
+    analyzer.report(std::cout);
+    if (!csvPrefix.empty() && !analyzer.writeCsv(csvPrefix)) {
+        return 1;
+    }
+    return 0;
+}
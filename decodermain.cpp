@@ -0,0 +1,90 @@
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "logevent.h"
+
+ //all doxygen comments are generated with AI assistance
+
+namespace {
+
+void usage() {
+    std::cerr << "Usage: log_decoder [--output PATH] [LOG_FILE]\n"
+              << "Turns a binary event log written with --binary-log (default load_balancer_log.bin)\n"
+              << "back into the text log of the same run, on standard output or into PATH." << std::endl;
+}
+
+} // namespace
+
+/**
+ * @brief Entry point of the offline event-log decoder.
+ *
+ * Maps the binary log read-only and writes the text lines the simulator
+ * would have logged, byte for byte.
+ *
+ * @return int Status code of the program (0 for success).
+ */
+int main(int argc, char* argv[]) {
+    std::string logFile = "load_balancer_log.bin";
+    std::string outputFile;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--output" && i + 1 < argc) {
+            outputFile = argv[++i];
+        } else if (!arg.empty() && arg[0] != '-') {
+            logFile = arg;
+        } else {
+            usage();
+            return 1;
+        }
+    }
+
+    int fd = open(logFile.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        std::cerr << "Failed to open " << logFile << ": " << std::strerror(errno) << std::endl;
+        return 1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        std::cerr << "Failed to stat " << logFile << ": " << std::strerror(errno) << std::endl;
+        close(fd);
+        return 1;
+    }
+    const size_t size = static_cast<size_t>(st.st_size);
+    const char* data = nullptr;
+    if (size > 0) {
+        void* p = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p == MAP_FAILED) {
+            std::cerr << "Failed to map " << logFile << ": " << std::strerror(errno) << std::endl;
+            close(fd);
+            return 1;
+        }
+        madvise(p, size, MADV_SEQUENTIAL);
+        data = static_cast<const char*>(p);
+    }
+    close(fd);
+
+    bool ok;
+    if (outputFile.empty()) {
+        std::ios::sync_with_stdio(false);
+        ok = decodeEventLog(data, size, std::cout);
+    } else {
+        std::ofstream out(outputFile, std::ios::binary);
+        if (!out.is_open()) {
+            std::cerr << "Failed to open output file: " << outputFile << std::endl;
+            ok = false;
+        } else {
+            ok = decodeEventLog(data, size, out);
+        }
+    }
+    if (data != nullptr) {
+        munmap(const_cast<char*>(data), size);
+    }
+    return ok ? 0 : 1;
+}
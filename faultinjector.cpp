@@ -0,0 +1,86 @@
+#include "faultinjector.h"
+
+/**
+ * @brief Constructs a FaultInjector.
+ * 
+ * @param config The fault model.
+ * @param logger Log to record crashes, slowdowns and recoveries in.
+ */
+FaultInjector::FaultInjector(const FaultConfig& config, LogManager& logger)
+    : config(config), logger(logger) {}
+
+/**
+ * @brief Checks whether the model injects any faults.
+ * 
+ * @return True if the crash or slowdown rate is positive.
+ */
+bool FaultInjector::enabled() const {
+    return config.crashRate > 0.0 || config.slowRate > 0.0;
+}
+
+/**
+ * @brief Recovers servers whose fault has ended and draws new faults.
+ * 
+ * A server with an active fault draws nothing; a healthy server draws one
+ * uniform number that selects a crash, a slowdown or nothing. Nothing is
+ * drawn when the model is disabled, so such runs consume the generator
+ * exactly as before.
+ * 
+ * @param servers The servers to act on.
+ * @param currTime The current time in clock cycles.
+ * @param rng The simulation's random number generator.
+ */
+void FaultInjector::step(std::vector<WebServer>& servers, int currTime, std::mt19937& rng) {
+    if (!enabled()) {
+        return;
+    }
+    for (auto& server : servers) {
+        const FaultState& state = server.getFaultState();
+        if (state.recoverAt >= 0) {
+            if (currTime >= state.recoverAt) {
+                server.recover(currTime);
+                logger.event(LogEventKind::Recovered, currTime, server.getName());
+            }
+            continue;
+        }
+        double u = rng() / 4294967296.0;
+        if (u < config.crashRate) {
+            server.crash(currTime, currTime + config.recoveryTime);
+            crashes++;
+            logger.event(LogEventKind::Crashed, currTime, server.getName());
+        } else if (u < config.crashRate + config.slowRate) {
+            server.slowDown(currTime, config.slowFactor, currTime + config.recoveryTime);
+            slowdowns++;
+            logger.event(LogEventKind::SlowedDown, currTime, server.getName(), static_cast<uint32_t>(config.slowFactor));
+        }
+    }
+}
+
+/**
+ * @brief Gets the number of crashes injected.
+ * 
+ * @return The crash count.
+ */
+int FaultInjector::getCrashes() const {
+    return crashes;
+}
+
+/**
+ * @brief Gets the number of slowdowns injected.
+ * 
+ * @return The slowdown count.
+ */
+int FaultInjector::getSlowdowns() const {
+    return slowdowns;
+}
+
+/**
+ * @brief Restores the fault counts saved in a snapshot.
+ * 
+ * @param crashCount Crashes injected before the snapshot.
+ * @param slowdownCount Slowdowns injected before the snapshot.
+ */
+void FaultInjector::restoreCounts(int crashCount, int slowdownCount) {
+    crashes = crashCount;
+    slowdowns = slowdownCount;
+}
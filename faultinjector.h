@@ -0,0 +1,86 @@
+/**
+ * @file faultinjector.h
+ *
+ * This file contains the FaultInjector class, which crashes and slows down
+ * WebServers at random and brings them back after a recovery time.
+ *
+ * Every decision is drawn from the simulation's seeded generator, one draw
+ * per healthy server per cycle, so a run is reproducible from its seed and
+ * two runs that differ only in balancer policy (e.g. hedging on or off) see
+ * exactly the same incidents.
+ */
+
+#ifndef FAULTINJECTOR_H
+#define FAULTINJECTOR_H
+
+#include "webserver.h"
+#include "logmanager.h"
+#include <random>
+#include <vector>
+
+ //all doxygen comments are generated with AI assistance
+
+/**
+ * @brief Parameters of the fault model.
+ */
+struct FaultConfig {
+    double crashRate = 0.0;   ///< Probability per healthy server per cycle of a crash.
+    double slowRate = 0.0;    ///< Probability per healthy server per cycle of a slowdown.
+    int slowFactor = 4;       ///< A slowed server works at 1/slowFactor of normal speed.
+    int recoveryTime = 200;   ///< Cycles until a crashed or slowed server recovers.
+};
+
+/**
+ * @class FaultInjector
+ * @brief Applies the fault model to a set of servers once per cycle.
+ */
+class FaultInjector {
+public:
+    /**
+     * @brief Constructs a FaultInjector.
+     * @param config The fault model.
+     * @param logger Log to record crashes, slowdowns and recoveries in.
+     */
+    FaultInjector(const FaultConfig& config, LogManager& logger);
+
+    /**
+     * @brief Checks whether the model injects any faults.
+     * @return True if the crash or slowdown rate is positive.
+     */
+    bool enabled() const;
+
+    /**
+     * @brief Recovers servers whose fault has ended and draws new faults.
+     * @param servers The servers to act on.
+     * @param currTime The current time in clock cycles.
+     * @param rng The simulation's random number generator.
+     */
+    void step(std::vector<WebServer>& servers, int currTime, std::mt19937& rng);
+
+    /**
+     * @brief Gets the number of crashes injected.
+     * @return The crash count.
+     */
+    int getCrashes() const;
+
+    /**
+     * @brief Gets the number of slowdowns injected.
+     * @return The slowdown count.
+     */
+    int getSlowdowns() const;
+
+    /**
+     * @brief Restores the fault counts saved in a snapshot.
+     * @param crashCount Crashes injected before the snapshot.
+     * @param slowdownCount Slowdowns injected before the snapshot.
+     */
+    void restoreCounts(int crashCount, int slowdownCount);
+
+private:
+    FaultConfig config;  ///< The fault model.
+    LogManager& logger;  ///< Log for fault events.
+    int crashes = 0;     ///< Crashes injected so far.
+    int slowdowns = 0;   ///< Slowdowns injected so far.
+};
+
+#endif
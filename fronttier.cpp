@@ -0,0 +1,486 @@
+#include "fronttier.h"
+#include "memoryaccount.h"
+#include "profiler.h"
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+#include <thread>
+
+/**
+ * @brief Parses a routing policy name (round-robin, least-queue, source-hash).
+ *
+ * @param name The name given on the command line.
+ * @param out Receives the policy.
+ * @return True if the name is known.
+ */
+bool parseRoutingPolicy(const std::string& name, RoutingPolicy& out) {
+    if (name == "round-robin") {
+        out = RoutingPolicy::RoundRobin;
+    } else if (name == "least-queue") {
+        out = RoutingPolicy::LeastQueue;
+    } else if (name == "source-hash") {
+        out = RoutingPolicy::SourceHash;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Parses a balancing mode name (none, shed, steal).
+ *
+ * @param name The name given on the command line.
+ * @param out Receives the mode.
+ * @return True if the name is known.
+ */
+bool parseTierBalancing(const std::string& name, TierBalancing& out) {
+    if (name == "none") {
+        out = TierBalancing::None;
+    } else if (name == "shed") {
+        out = TierBalancing::Shed;
+    } else if (name == "steal") {
+        out = TierBalancing::Steal;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Constructs a barrier.
+ *
+ * @param parties Threads that must arrive before any of them continues.
+ */
+CycleBarrier::CycleBarrier(int parties)
+    : parties(parties) {}
+
+/**
+ * @brief Blocks until every party has arrived, then releases them all.
+ *
+ * The generation counter lets the barrier be reused at once: a thread that
+ * races ahead to the next wait cannot be confused with the current one.
+ */
+void CycleBarrier::arriveAndWait() {
+    std::unique_lock<std::mutex> lock(mutex);
+    unsigned long arrivedIn = generation;
+    if (++waiting == parties) {
+        waiting = 0;
+        generation++;
+        released.notify_all();
+        return;
+    }
+    released.wait(lock, [this, arrivedIn]() { return generation != arrivedIn; });
+}
+
+/**
+ * @brief Constructs a region.
+ *
+ * @param index Position in the tier, also used in the log file name.
+ * @param config Tier parameters.
+ * @param seed Seed of the region's generator.
+ */
+FrontTier::Region::Region(int index, const TierConfig& config, unsigned seed)
+    : index(index),
+      log("load_balancer_log_" + std::to_string(index) + (config.binaryLog ? ".bin" : ".txt"),
+          config.binaryLog ? LogFormat::Binary : LogFormat::Text),
+      balancer(log),
+      faults(config.faults, log),
+      rng(seed) {
+    balancer.setResilience(config.resilience);
+    balancer.setStreamSlots(config.streamSlots);
+    balancer.setQueueSpill(config.queueMemory, config.spillDir);
+}
+
+/**
+ * @brief Constructs the tier and its regions.
+ *
+ * Region k logs to load_balancer_log_<k>.txt and draws its faults from a
+ * generator seeded with seed + 1 + k, so its incidents do not depend on how
+ * the other regions or the front tier use their generators.
+ *
+ * @param config Tier parameters.
+ * @param logger Log for the tier's own summary.
+ * @param seed Seed of the tier's generator.
+ */
+FrontTier::FrontTier(const TierConfig& config, LogManager& logger, unsigned seed)
+    : config(config), logger(logger), rng(seed), barrier(std::max(1, config.balancers) + 1) {
+    if (this->config.arrivalRate < 0) {
+        this->config.arrivalRate = 0.1 * std::max(1, config.balancers);
+    }
+    for (int k = 0; k < std::max(1, config.balancers); ++k) {
+        regions.push_back(std::unique_ptr<Region>(new Region(k, this->config, seed + 1 + static_cast<unsigned>(k))));
+    }
+}
+
+/**
+ * @brief Provisions the fleets and routes the initial requests.
+ *
+ * Like the single-balancer simulation, every region starts with 100 queued
+ * requests per server; they are routed by the same policy as later arrivals.
+ *
+ * @return True on success, false if a blocklist could not be loaded.
+ */
+bool FrontTier::start() {
+    for (auto& region : regions) {
+        if (!config.blocklistFile.empty() && !region->balancer.loadBlockedIpRanges(config.blocklistFile)) {
+            return false;
+        }
+        region->balancer.provisionServers(config.serversPerBalancer);
+        region->log.log("");
+        region->log.log("-------------------Simulation Starts-----------------------------");
+        region->log.log("");
+    }
+
+    const int initialRequests = config.serversPerBalancer * 100 * static_cast<int>(regions.size());
+    for (int i = 0; i < initialRequests; ++i) {
+        Request req = generateRequest();
+        Region& region = *regions[route(req)];
+        region.balancer.addRequest(req);
+        region.log.event(LogEventKind::InitialRequest, 0, 0, req, static_cast<uint32_t>(req.getProcessTime()));
+    }
+
+    for (auto& region : regions) {
+        region->log.log("");
+        region->log.log("------------------------------------------------");
+        region->log.log("Starting Queue Size: " + std::to_string(region->balancer.getRequestQueueSize()));
+        region->log.log("------------------------------------------------");
+        region->log.log("");
+    }
+    return true;
+}
+
+/**
+ * @brief Runs the regions on their own threads until the given cycle.
+ *
+ * Each cycle the front tier routes arrivals, releases the regions through
+ * the barrier, waits for all of them at the barrier again and then balances
+ * work between them. Afterwards every region log gets its final status and
+ * the tier summary goes to the tier's log.
+ *
+ * @param runTime Clock cycle to stop at.
+ */
+void FrontTier::run(int runTime) {
+    std::vector<std::thread> workers;
+    for (size_t k = 0; k < regions.size(); ++k) {
+        workers.push_back(std::thread(&FrontTier::workerLoop, this, k));
+    }
+
+    stopping = false;
+    for (; currentTime < runTime; ++currentTime) {
+        PROFILE_ZONE("cycle");
+        {
+            PROFILE_ZONE("routing");
+            routeArrivals();
+        }
+        barrier.arriveAndWait(); // regions start the cycle
+        barrier.arriveAndWait(); // every region finished it
+        if (config.balancing != TierBalancing::None) {
+            PROFILE_ZONE("balancing");
+            balance();
+        }
+    }
+    stopping = true;
+    barrier.arriveAndWait();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    this->runTime = runTime;
+
+    for (auto& region : regions) {
+        const LoadBalancer& lb = region->balancer;
+        region->log.log("");
+        region->log.log("-------------------Simulation Completed-----------------------------");
+        region->log.log("");
+        std::stringstream ss;
+        ss << "Final status (balancer " << region->index << "):" << std::endl
+           << "  Total servers: " << lb.getServers().size() << std::endl
+           << "  Requests completed: " << lb.getLatency().count() << std::endl
+           << "  Rejected/discarded requests: " << lb.getRejectedRequests() << std::endl
+           << "  Ending Queue Size: " << lb.getRequestQueueSize() << std::endl
+           << "  Shed: " << region->shed << ", stolen by peers: " << region->stolen << ", received: " << region->received;
+        if (lb.getRequestQueue().isSpilling()) {
+            ss << std::endl << "  " << lb.getRequestQueue().describeSpill();
+        }
+        region->log.log(ss.str());
+        region->log.log("");
+        region->log.log("Requests handled by each server:");
+        for (const auto& server : lb.getServers()) {
+            region->log.log("  Server " + std::string(1, server.getName()) + ": " + std::to_string(server.getProcessedRequestCount()));
+        }
+    }
+}
+
+/**
+ * @brief Body of a region's thread.
+ *
+ * @param index The region this thread serves.
+ */
+void FrontTier::workerLoop(size_t index) {
+    Region& region = *regions[index];
+    for (;;) {
+        barrier.arriveAndWait();
+        if (stopping) {
+            return;
+        }
+        runRegionCycle(region);
+        barrier.arriveAndWait();
+    }
+}
+
+/**
+ * @brief One cycle of a region: faults, serving, autoscaling, then new work.
+ *
+ * The order matches the single-balancer loop: requests that reach the region
+ * in a cycle are queued after its servers had their turn, so they are
+ * dispatched from the next cycle on.
+ *
+ * @param region The region.
+ */
+void FrontTier::runRegionCycle(Region& region) {
+    PROFILE_ZONE("region");
+    LoadBalancer& lb = region.balancer;
+    const int now = lb.getTime();
+
+    region.faults.step(lb.getServers(), lb.getTime(), region.rng);
+    lb.processServers(lb.getServers());
+    lb.allocateServer();
+    lb.deallocateServer();
+
+    for (const auto& t : region.inbound) {
+        lb.receiveTransfer(t.request);
+        region.received++;
+        region.log.event(LogEventKind::Received, now, 0, t.request, static_cast<uint32_t>(t.from));
+    }
+    region.inbound.clear();
+
+    for (const auto& req : region.arrivals) {
+        lb.addRequest(req);
+        region.log.event(LogEventKind::NewRequest, now, 0, req, static_cast<uint32_t>(req.getProcessTime()));
+    }
+    region.arrivals.clear();
+
+    lb.incTime();
+}
+
+/**
+ * @brief Builds a random request arriving now.
+ *
+ * Uses the same distributions as the single-balancer simulation and gives
+ * the request an id that is unique across regions, so a request keeps its
+ * identity when it moves.
+ *
+ * @return The request.
+ */
+Request FrontTier::generateRequest() {
+    uint32_t ipIn = static_cast<uint32_t>(rng());
+    uint32_t ipOut = static_cast<uint32_t>(rng());
+    int processTime = static_cast<int>(rng() % 50) + 1;
+    char jobType = (rng() % 2 == 0) ? 'P' : 'S';
+
+    minProcessTime = minProcessTime == 0 ? processTime : std::min(minProcessTime, processTime);
+    maxProcessTime = std::max(maxProcessTime, processTime);
+
+    Request req(ipIn, ipOut, processTime, jobType, currentTime);
+    req.setId(nextRequestId++);
+    return req;
+}
+
+/**
+ * @brief Picks the region for a new request.
+ *
+ * @param req The request.
+ * @return Index of the region.
+ */
+size_t FrontTier::route(const Request& req) {
+    switch (config.routing) {
+    case RoutingPolicy::LeastQueue: {
+        size_t best = 0;
+        for (size_t k = 1; k < regions.size(); ++k) {
+            if (load(*regions[k]) < load(*regions[best])) {
+                best = k;
+            }
+        }
+        return best;
+    }
+    case RoutingPolicy::SourceHash:
+        return ((req.getIpInAddr() >> 8) * 2654435761u >> 8) % regions.size();
+    case RoutingPolicy::RoundRobin:
+    default:
+        const size_t k = nextRegion;
+        nextRegion = (k + 1) % regions.size();
+        return k;
+    }
+}
+
+/**
+ * @brief Routes this cycle's arrivals and hands due transfers to their regions.
+ *
+ * Arrivals follow the configured rate: its integer part every cycle, plus one
+ * more with probability equal to its fractional part.
+ */
+void FrontTier::routeArrivals() {
+    size_t due = 0;
+    while (due < inTransit.size() && inTransit[due].arriveAt <= currentTime) {
+        Region& to = *regions[static_cast<size_t>(inTransit[due].to)];
+        to.inbound.push_back(inTransit[due]);
+        to.inTransit--;
+        due++;
+    }
+    inTransit.erase(inTransit.begin(), inTransit.begin() + static_cast<std::ptrdiff_t>(due));
+
+    int count = static_cast<int>(config.arrivalRate);
+    if (rng() / 4294967296.0 < config.arrivalRate - count) {
+        count++;
+    }
+    for (int i = 0; i < count; ++i) {
+        Request req = generateRequest();
+        regions[route(req)]->arrivals.push_back(req);
+    }
+}
+
+/**
+ * @brief Gets the queued plus inbound requests per server of a region.
+ *
+ * @param region The region.
+ * @return The load; requests routed to it this cycle count as queued.
+ */
+double FrontTier::load(const Region& region) {
+    const size_t queued = region.balancer.getRequestQueueSize() + region.arrivals.size() +
+                          region.inbound.size() + static_cast<size_t>(region.inTransit);
+    return static_cast<double>(queued) / std::max<size_t>(1, region.balancer.getServers().size());
+}
+
+/**
+ * @brief Sheds or steals queued work according to the balancing mode.
+ *
+ * Shedding: a region with more than shedAbove queued requests per server
+ * sends the excess to the least-loaded peers, as long as they stay at or
+ * below that level themselves. Stealing: a region whose idle servers
+ * outnumber its queued and inbound requests pulls the difference from the
+ * most-loaded peer, but only from the part of that peer's queue beyond one
+ * request per server. Either way moved requests spend transferDelay cycles
+ * in transit; requests already on a server never move.
+ */
+void FrontTier::balance() {
+    if (regions.size() < 2) {
+        return;
+    }
+    if (config.balancing == TierBalancing::Shed) {
+        for (auto& source : regions) {
+            const int servers = static_cast<int>(source->balancer.getServers().size());
+            int excess = static_cast<int>(source->balancer.getRequestQueueSize()) - config.shedAbove * servers;
+            while (excess > 0) {
+                Region* target = nullptr;
+                for (auto& peer : regions) {
+                    if (peer != source && load(*peer) < config.shedAbove && (target == nullptr || load(*peer) < load(*target))) {
+                        target = peer.get();
+                    }
+                }
+                if (target == nullptr) {
+                    break;
+                }
+                const int room = static_cast<int>(config.shedAbove * target->balancer.getServers().size() -
+                                                  load(*target) * target->balancer.getServers().size());
+                const int moved = std::max(1, std::min(excess, room));
+                transfer(*source, *target, moved, LogEventKind::Shed);
+                source->shed += moved;
+                excess -= moved;
+            }
+        }
+    } else if (config.balancing == TierBalancing::Steal) {
+        for (auto& thief : regions) {
+            int idle = 0;
+            for (const auto& server : thief->balancer.getServers()) {
+                idle += (server.isIdle() && !server.isEjected() && server.checkHealth()) ? 1 : 0;
+            }
+            const int wanted = idle - static_cast<int>(thief->balancer.getRequestQueueSize() + thief->inbound.size()) - thief->inTransit;
+            if (wanted <= 0) {
+                continue;
+            }
+            Region* victim = nullptr;
+            for (auto& peer : regions) {
+                if (peer != thief && (victim == nullptr || load(*peer) > load(*victim))) {
+                    victim = peer.get();
+                }
+            }
+            const int spare = static_cast<int>(victim->balancer.getRequestQueueSize()) -
+                              static_cast<int>(victim->balancer.getServers().size());
+            const int moved = std::min(wanted, spare);
+            if (moved > 0) {
+                transfer(*victim, *thief, moved, LogEventKind::Stolen);
+                victim->stolen += moved;
+            }
+        }
+    }
+}
+
+/**
+ * @brief Moves the newest queued requests of one region towards another.
+ *
+ * @param from The region giving up the requests.
+ * @param to The region receiving them after transferDelay cycles.
+ * @param count Requests to move.
+ * @param kind Shed or Stolen, for the giving region's log.
+ */
+void FrontTier::transfer(Region& from, Region& to, int count, LogEventKind kind) {
+    for (int i = 0; i < count && !from.balancer.isRequestQueueEmpty(); ++i) {
+        Transfer t = {currentTime + 1 + config.transferDelay, from.index, to.index, from.balancer.takeNewestRequest()};
+        inTransit.push_back(t);
+        to.inTransit++;
+        from.log.event(kind, currentTime, 0, t.request, static_cast<uint32_t>(to.index));
+    }
+}
+
+/**
+ * @brief Describes throughput, latency and transfers of every region and of the tier.
+ *
+ * @return Report lines for the final status.
+ */
+std::string FrontTier::describe() const {
+    static const char* const routingNames[] = {"round-robin", "least-queue", "source-hash"};
+    static const char* const balancingNames[] = {"none", "shed", "steal"};
+    LatencyHistogram all;
+    size_t servers = 0;
+    size_t queued = 0;
+    int rejected = 0;
+    int moved = 0;
+
+    std::ostringstream ss;
+    ss << "Tier status (" << regions.size() << " balancers, routing " << routingNames[static_cast<int>(config.routing)]
+       << ", balancing " << balancingNames[static_cast<int>(config.balancing)] << ", transfer delay "
+       << config.transferDelay << " cycles, " << config.arrivalRate << " arrivals per cycle):" << std::endl;
+    for (const auto& region : regions) {
+        const LoadBalancer& lb = region->balancer;
+        const LatencyHistogram& latency = lb.getLatency();
+        ss << "  Balancer " << region->index << ": " << lb.getServers().size() << " servers, "
+           << latency.count() << " completed, " << lb.getRequestQueueSize() << " queued, shed "
+           << region->shed << ", stolen " << region->stolen << ", received " << region->received
+           << ", p50/p99 " << latency.percentile(50) << " / " << latency.percentile(99) << " cycles" << std::endl;
+        all.merge(latency);
+        servers += lb.getServers().size();
+        queued += lb.getRequestQueueSize();
+        rejected += lb.getRejectedRequests();
+        moved += region->shed + region->stolen;
+    }
+    ss << std::fixed << std::setprecision(3)
+       << "  Total: " << servers << " servers, " << all.count() << " completed ("
+       << (runTime > 0 ? static_cast<double>(all.count()) / runTime : 0.0) << " per cycle), "
+       << rejected << " rejected, " << queued << " queued, " << inTransit.size() << " in transit, "
+       << moved << " moved between balancers" << std::endl
+       << "  Latency p50/p99/p99.9: " << all.percentile(50) << " / " << all.percentile(99) << " / "
+       << all.percentile(99.9) << " cycles" << std::endl
+       << "  Task Time Range: " << minProcessTime << " to " << maxProcessTime << std::endl
+       << "Memory:";
+    const std::string heap = describeHeapUsage();
+    if (!heap.empty()) {
+        ss << std::endl << heap;
+    }
+    for (const auto& region : regions) {
+        std::string lines = region->balancer.describeMemory(region->balancer.getServers());
+        for (size_t pos = lines.find('\n'); pos != std::string::npos; pos = lines.find('\n', pos + 3)) {
+            lines.replace(pos, 1, "\n  ");
+        }
+        ss << std::endl << "  Balancer " << region->index << ":" << std::endl << "  " << lines;
+    }
+    return ss.str();
+}
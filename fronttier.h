@@ -0,0 +1,231 @@
+/**
+ * @file fronttier.h
+ *
+ * This file contains the FrontTier class, a global tier that routes requests
+ * to several regional LoadBalancers, each with its own fleet, autoscaling,
+ * fault model and log, and moves queued work between them when one region
+ * is overloaded.
+ *
+ * Every region runs on its own thread. A cycle has two phases separated by a
+ * CycleBarrier: the regions serve their fleets in parallel, then the front
+ * tier alone routes new arrivals and decides transfers. Since no region is
+ * touched by two threads in the same phase the queues need no locks, and a
+ * run is reproducible from its seed however the threads are scheduled.
+ */
+
+#ifndef FRONTTIER_H
+#define FRONTTIER_H
+
+#include "loadbalancer.h"
+#include "logmanager.h"
+#include "faultinjector.h"
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <vector>
+
+ //all doxygen comments are generated with AI assistance
+
+/**
+ * @brief How the front tier picks a region for a new request.
+ */
+enum class RoutingPolicy {
+    RoundRobin,  ///< Regions in turn.
+    LeastQueue,  ///< Region with the fewest queued requests per server.
+    SourceHash   ///< Region chosen by the source /24 network (client affinity).
+};
+
+/**
+ * @brief How overloaded regions hand work to their peers.
+ */
+enum class TierBalancing {
+    None,   ///< Regions never exchange work.
+    Shed,   ///< A region queued beyond its limit pushes the excess to the least-loaded peer.
+    Steal   ///< A region with idle servers pulls queued work from the most-loaded peer.
+};
+
+/**
+ * @brief Parameters of a multi-balancer run.
+ */
+struct TierConfig {
+    int balancers = 0;                            ///< Regional LoadBalancers, 0 for the classic single balancer.
+    int serversPerBalancer = 10;                  ///< Initial servers in every region.
+    RoutingPolicy routing = RoutingPolicy::RoundRobin; ///< Front-tier routing policy.
+    TierBalancing balancing = TierBalancing::None; ///< Work exchange between regions.
+    int shedAbove = 5;                            ///< Queued requests per server a region keeps before shedding.
+    int transferDelay = 5;                        ///< Cycles a request spends moving between regions.
+    double arrivalRate = -1.0;                    ///< New requests per cycle across the tier, negative for 0.1 per region.
+    int streamSlots = 0;                          ///< Stream slots of every server.
+    std::string blocklistFile;                    ///< CIDR blocklist for every region, empty for the built-in ranges.
+    size_t queueMemory = 0;                       ///< Queued requests each region keeps in memory, 0 for no limit.
+    std::string spillDir = "/tmp";                ///< Where regions spill the rest of their queues.
+    bool binaryLog = false;                       ///< Regions write binary event logs instead of text.
+    FaultConfig faults;                           ///< Fault model, applied in every region.
+    ResilienceConfig resilience;                  ///< Health checks, retries and hedging of every region.
+};
+
+/**
+ * @brief Parses a routing policy name (round-robin, least-queue, source-hash).
+ * @param name The name given on the command line.
+ * @param out Receives the policy.
+ * @return True if the name is known.
+ */
+bool parseRoutingPolicy(const std::string& name, RoutingPolicy& out);
+
+/**
+ * @brief Parses a balancing mode name (none, shed, steal).
+ * @param name The name given on the command line.
+ * @param out Receives the mode.
+ * @return True if the name is known.
+ */
+bool parseTierBalancing(const std::string& name, TierBalancing& out);
+
+/**
+ * @class CycleBarrier
+ * @brief Reusable barrier for a fixed number of threads (C++11 has none).
+ */
+class CycleBarrier {
+public:
+    /**
+     * @brief Constructs a barrier.
+     * @param parties Threads that must arrive before any of them continues.
+     */
+    explicit CycleBarrier(int parties);
+
+    /**
+     * @brief Blocks until every party has arrived, then releases them all.
+     */
+    void arriveAndWait();
+
+private:
+    std::mutex mutex;               ///< Guards the counters.
+    std::condition_variable released; ///< Signalled when a generation completes.
+    const int parties;              ///< Threads per generation.
+    int waiting = 0;                ///< Threads arrived in the current generation.
+    unsigned long generation = 0;   ///< Completed generations.
+};
+
+/**
+ * @class FrontTier
+ * @brief Routes requests to regional LoadBalancers and balances work between them.
+ */
+class FrontTier {
+public:
+    /**
+     * @brief Constructs the tier and its regions.
+     *
+     * Region k logs to load_balancer_log_<k>.txt, or load_balancer_log_<k>.bin
+     * with a binary log.
+     *
+     * @param config Tier parameters.
+     * @param logger Log for the tier's own summary.
+     * @param seed Seed of the tier's generator; every region derives its own from it.
+     */
+    FrontTier(const TierConfig& config, LogManager& logger, unsigned seed);
+
+    /**
+     * @brief Provisions the fleets and routes the initial requests.
+     * @return True on success, false if a blocklist could not be loaded.
+     */
+    bool start();
+
+    /**
+     * @brief Runs the regions on their own threads until the given cycle.
+     * @param runTime Clock cycle to stop at.
+     */
+    void run(int runTime);
+
+    /**
+     * @brief Describes throughput, latency and transfers of every region and of the tier.
+     * @return Report lines for the final status.
+     */
+    std::string describe() const;
+
+private:
+    /**
+     * @brief A request moving between regions.
+     */
+    struct Transfer {
+        int arriveAt;     ///< Cycle the request reaches its new region.
+        int from;         ///< Region it left.
+        int to;           ///< Region it goes to.
+        Request request;  ///< The request.
+    };
+
+    /**
+     * @brief One regional balancer with its log, faults and private generator.
+     */
+    struct Region {
+        Region(int index, const TierConfig& config, unsigned seed);
+
+        int index;                      ///< Position in the tier.
+        LogManager log;                 ///< The region's own log file.
+        LoadBalancer balancer;          ///< The regional balancer and its fleet.
+        FaultInjector faults;           ///< Faults of this region's servers.
+        std::mt19937 rng;               ///< Used only by the region's thread.
+        std::vector<Request> arrivals;  ///< Routed here this cycle.
+        std::vector<Transfer> inbound;  ///< Transfers arriving this cycle.
+        int inTransit = 0;              ///< Transfers on their way here.
+        int shed = 0;                   ///< Requests this region shed to peers.
+        int stolen = 0;                 ///< Requests peers stole from this region.
+        int received = 0;               ///< Requests received from peers.
+    };
+
+    /**
+     * @brief Builds a random request arriving now.
+     */
+    Request generateRequest();
+
+    /**
+     * @brief Picks the region for a new request.
+     */
+    size_t route(const Request& req);
+
+    /**
+     * @brief Routes this cycle's arrivals and hands due transfers to their regions.
+     */
+    void routeArrivals();
+
+    /**
+     * @brief One cycle of a region: faults, serving, autoscaling, then new work.
+     */
+    void runRegionCycle(Region& region);
+
+    /**
+     * @brief Body of a region's thread.
+     */
+    void workerLoop(size_t index);
+
+    /**
+     * @brief Sheds or steals queued work according to the balancing mode.
+     */
+    void balance();
+
+    /**
+     * @brief Moves the newest queued requests of one region towards another.
+     */
+    void transfer(Region& from, Region& to, int count, LogEventKind kind);
+
+    /**
+     * @brief Gets the queued plus inbound requests per server of a region.
+     */
+    static double load(const Region& region);
+
+    TierConfig config;                            ///< Tier parameters.
+    LogManager& logger;                           ///< The tier's own log.
+    std::mt19937 rng;                             ///< Arrivals and routing.
+    std::vector<std::unique_ptr<Region> > regions; ///< Regional balancers.
+    std::vector<Transfer> inTransit;              ///< Requests between regions, in send order.
+    CycleBarrier barrier;                         ///< Separates the parallel and serial phases.
+    bool stopping = false;                        ///< Tells the region threads to exit.
+    int currentTime = 0;                          ///< The tier's clock.
+    int runTime = 0;                              ///< Cycles the last run() covered.
+    uint32_t nextRequestId = 1;                   ///< Ids are unique across regions.
+    size_t nextRegion = 0;                        ///< Round-robin position.
+    int minProcessTime = 0;                       ///< Shortest generated process time, 0 if none.
+    int maxProcessTime = 0;                       ///< Longest generated process time.
+};
+
+#endif
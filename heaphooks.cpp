@@ -0,0 +1,81 @@
+// heaphooks.cpp
+//
+// Replacement global operator new and delete that feed the heap counters in
+// memoryaccount.cpp. Linked into the simulator only, so the proxy's event
+// loops never share these counters.
+
+#include "memoryaccount.h"
+#include <cstdlib>
+#include <malloc.h>
+#include <new>
+
+namespace {
+
+/**
+ * @brief Allocates and counts a block, as operator new must (never returns null).
+ */
+void* countedAlloc(std::size_t size) {
+    void* p = std::malloc(size != 0 ? size : 1);
+    while (p == nullptr) {
+        std::new_handler handler = std::get_new_handler();
+        if (handler == nullptr) {
+            throw std::bad_alloc();
+        }
+        handler();
+        p = std::malloc(size != 0 ? size : 1);
+    }
+    recordHeapAllocation(malloc_usable_size(p));
+    return p;
+}
+
+/**
+ * @brief Counts and releases a block.
+ */
+void countedFree(void* p) noexcept {
+    if (p != nullptr) {
+        recordHeapFree(malloc_usable_size(p));
+        std::free(p);
+    }
+}
+
+} // namespace
+
+void* operator new(std::size_t size) {
+    return countedAlloc(size);
+}
+
+void* operator new[](std::size_t size) {
+    return countedAlloc(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    try {
+        return countedAlloc(size);
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+    try {
+        return countedAlloc(size);
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+void operator delete(void* p) noexcept {
+    countedFree(p);
+}
+
+void operator delete[](void* p) noexcept {
+    countedFree(p);
+}
+
+void operator delete(void* p, const std::nothrow_t&) noexcept {
+    countedFree(p);
+}
+
+void operator delete[](void* p, const std::nothrow_t&) noexcept {
+    countedFree(p);
+}
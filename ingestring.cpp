@@ -0,0 +1,275 @@
+#include "ingestring.h"
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <ctime>
+#include <iostream>
+#include <new>
+
+static_assert(sizeof(IngestRecord) == 16, "IngestRecord layout is part of the shared-memory format");
+static_assert(sizeof(IngestSlot) == 24, "IngestSlot layout is part of the shared-memory format");
+static_assert(sizeof(IngestRingHeader) == 256, "IngestRingHeader layout is part of the shared-memory format");
+
+namespace {
+
+/**
+ * @brief Thin wrapper over the futex system call on a shared (non-private) word.
+ */
+long futex(std::atomic<uint32_t>* word, int op, uint32_t value, const timespec* timeout) {
+    return syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), op, value, timeout, nullptr, 0);
+}
+
+/**
+ * @brief Maps a shared-memory object of the given size.
+ * @return The mapping, or nullptr on failure.
+ */
+void* mapShared(int fd, size_t bytes) {
+    void* p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    return p == MAP_FAILED ? nullptr : p;
+}
+
+} // namespace
+
+/**
+ * @brief Checks a record against the layout rules: job type 'P' or 'S',
+ *        process time 1 to kMaxIngestProcessTime, reserved bytes zero.
+ *
+ * Producers are other processes, so nothing they write is trusted: an unknown
+ * job type would never complete on a server and a huge process time would
+ * overflow the simulation's int clock arithmetic.
+ *
+ * @param rec The record as read from the ring.
+ * @return True if the record may become a Request.
+ */
+bool isValidIngestRecord(const IngestRecord& rec) {
+    return (rec.jobType == 'P' || rec.jobType == 'S') && rec.processTime >= 1 &&
+           rec.processTime <= kMaxIngestProcessTime && rec.reserved[0] == 0 && rec.reserved[1] == 0 &&
+           rec.reserved[2] == 0;
+}
+
+IngestProducer::IngestProducer() {}
+
+IngestProducer::~IngestProducer() {
+    close();
+}
+
+/**
+ * @brief Attaches to a ring created by an IngestConsumer.
+ * @param name The shared-memory object name (e.g. "/lb_ingest").
+ * @return True if the ring exists and has a compatible layout.
+ */
+bool IngestProducer::open(const std::string& name) {
+    int fd = shm_open(name.c_str(), O_RDWR, 0);
+    if (fd < 0) {
+        std::cerr << "Failed to open ingest ring: " << name << std::endl;
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0 || static_cast<size_t>(st.st_size) < sizeof(IngestRingHeader)) {
+        ::close(fd);
+        return false;
+    }
+    void* p = mapShared(fd, static_cast<size_t>(st.st_size));
+    ::close(fd);
+    if (p == nullptr) {
+        return false;
+    }
+    IngestRingHeader* h = static_cast<IngestRingHeader*>(p);
+    size_t expected = sizeof(IngestRingHeader) + h->capacity * sizeof(IngestSlot);
+    if (h->magic != kIngestMagic || h->version != kIngestVersion ||
+        h->recordSize != sizeof(IngestRecord) || h->slotSize != sizeof(IngestSlot) ||
+        expected != static_cast<size_t>(st.st_size)) {
+        std::cerr << "Incompatible ingest ring layout: " << name << std::endl;
+        munmap(p, static_cast<size_t>(st.st_size));
+        return false;
+    }
+    header = h;
+    slots = reinterpret_cast<IngestSlot*>(h + 1);
+    mappedBytes = static_cast<size_t>(st.st_size);
+    return true;
+}
+
+/**
+ * @brief Publishes one record.
+ *
+ * Claims the slot at the tail with a compare-and-swap, copies the record and
+ * releases it by advancing the slot's sequence number. The consumer is only
+ * woken through the futex if it announced that it is going to sleep.
+ *
+ * @param record The record to publish.
+ * @return False if the ring is full (the record is not published).
+ */
+bool IngestProducer::push(const IngestRecord& record) {
+    const uint64_t mask = header->capacity - 1;
+    uint64_t pos = header->tail.load(std::memory_order_relaxed);
+    IngestSlot* slot;
+    for (;;) {
+        slot = &slots[pos & mask];
+        uint64_t seq = slot->sequence.load(std::memory_order_acquire);
+        int64_t diff = static_cast<int64_t>(seq) - static_cast<int64_t>(pos);
+        if (diff == 0) {
+            if (header->tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            return false; // the consumer has not freed this slot yet
+        } else {
+            pos = header->tail.load(std::memory_order_relaxed);
+        }
+    }
+    slot->record = record;
+    slot->sequence.store(pos + 1, std::memory_order_seq_cst);
+
+    if (header->consumerIdle.load(std::memory_order_seq_cst) != 0) {
+        header->wakeSequence.fetch_add(1, std::memory_order_seq_cst);
+        futex(&header->wakeSequence, FUTEX_WAKE, 1, nullptr);
+    }
+    return true;
+}
+
+/**
+ * @brief Detaches from the ring.
+ */
+void IngestProducer::close() {
+    if (header != nullptr) {
+        munmap(header, mappedBytes);
+        header = nullptr;
+        slots = nullptr;
+    }
+}
+
+IngestConsumer::IngestConsumer() {}
+
+IngestConsumer::~IngestConsumer() {
+    close();
+}
+
+/**
+ * @brief Creates (or recreates) the shared-memory ring.
+ * @param ringName The shared-memory object name (e.g. "/lb_ingest").
+ * @param capacity Requested slot count, rounded up to a power of two.
+ * @return True on success.
+ */
+bool IngestConsumer::create(const std::string& ringName, size_t capacity) {
+    size_t slotsWanted = 2;
+    while (slotsWanted < capacity) {
+        slotsWanted <<= 1;
+    }
+    size_t bytes = sizeof(IngestRingHeader) + slotsWanted * sizeof(IngestSlot);
+
+    shm_unlink(ringName.c_str());
+    int fd = shm_open(ringName.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd < 0 || ftruncate(fd, static_cast<off_t>(bytes)) < 0) {
+        std::cerr << "Failed to create ingest ring: " << ringName << std::endl;
+        if (fd >= 0) {
+            ::close(fd);
+        }
+        return false;
+    }
+    void* p = mapShared(fd, bytes);
+    ::close(fd);
+    if (p == nullptr) {
+        return false;
+    }
+
+    IngestRingHeader* h = new (p) IngestRingHeader();
+    h->version = kIngestVersion;
+    h->recordSize = sizeof(IngestRecord);
+    h->slotSize = sizeof(IngestSlot);
+    h->capacity = slotsWanted;
+    h->tail.store(0, std::memory_order_relaxed);
+    h->head.store(0, std::memory_order_relaxed);
+    h->consumerIdle.store(0, std::memory_order_relaxed);
+    h->wakeSequence.store(0, std::memory_order_relaxed);
+    IngestSlot* s = reinterpret_cast<IngestSlot*>(h + 1);
+    for (size_t i = 0; i < slotsWanted; ++i) {
+        new (&s[i]) IngestSlot();
+        s[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    std::atomic_thread_fence(std::memory_order_release);
+    h->magic = kIngestMagic;
+
+    name = ringName;
+    header = h;
+    slots = s;
+    mappedBytes = bytes;
+    return true;
+}
+
+/**
+ * @brief Reads up to max records without blocking.
+ * @param out Array receiving the records.
+ * @param max Capacity of out.
+ * @return The number of records read.
+ */
+size_t IngestConsumer::poll(IngestRecord* out, size_t max) {
+    if (header == nullptr) {
+        return 0;
+    }
+    const uint64_t capacity = header->capacity;
+    uint64_t pos = header->head.load(std::memory_order_relaxed);
+    size_t n = 0;
+    while (n < max) {
+        IngestSlot& slot = slots[pos & (capacity - 1)];
+        if (slot.sequence.load(std::memory_order_acquire) != pos + 1) {
+            break;
+        }
+        out[n++] = slot.record;
+        slot.sequence.store(pos + capacity, std::memory_order_release);
+        ++pos;
+    }
+    header->head.store(pos, std::memory_order_relaxed);
+    return n;
+}
+
+/**
+ * @brief Checks whether a record is ready to be read.
+ * @return True if poll() would return at least one record.
+ */
+bool IngestConsumer::hasPending() const {
+    if (header == nullptr) {
+        return false;
+    }
+    uint64_t pos = header->head.load(std::memory_order_relaxed);
+    const IngestSlot& slot = slots[pos & (header->capacity - 1)];
+    return slot.sequence.load(std::memory_order_seq_cst) == pos + 1;
+}
+
+/**
+ * @brief Sleeps on the futex until a producer publishes or the timeout expires.
+ *
+ * The consumer first announces that it is idle and then re-checks the ring,
+ * so a producer that published in between either is seen here or sees the
+ * idle flag and bumps the futex word, which makes FUTEX_WAIT return at once.
+ *
+ * @param timeoutMs Maximum time to sleep in milliseconds.
+ */
+void IngestConsumer::wait(int timeoutMs) {
+    if (header == nullptr) {
+        return;
+    }
+    uint32_t seq = header->wakeSequence.load(std::memory_order_seq_cst);
+    header->consumerIdle.store(1, std::memory_order_seq_cst);
+    if (!hasPending()) {
+        timespec timeout;
+        timeout.tv_sec = timeoutMs / 1000;
+        timeout.tv_nsec = static_cast<long>(timeoutMs % 1000) * 1000000L;
+        futex(&header->wakeSequence, FUTEX_WAIT, seq, &timeout);
+    }
+    header->consumerIdle.store(0, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Unmaps and unlinks the ring.
+ */
+void IngestConsumer::close() {
+    if (header != nullptr) {
+        munmap(header, mappedBytes);
+        shm_unlink(name.c_str());
+        header = nullptr;
+        slots = nullptr;
+    }
+}
@@ -0,0 +1,178 @@
+/**
+ * @file ingestring.h
+ *
+ * This file contains the shared-memory ingest channel: a fixed-size record
+ * layout, the ring that lives in a POSIX shared-memory object, a producer
+ * library for external processes and the consumer used by the load balancer.
+ *
+ * Shared-memory layout (all offsets in bytes, little-endian host):
+ *
+ *     0    IngestRingHeader  (256 bytes, see below)
+ *     256  IngestSlot[capacity]  (24 bytes each, capacity is a power of two)
+ *
+ * IngestRecord (16 bytes):
+ *
+ *     0   uint32  ipIn         source address, host order (a.b.c.d = a<<24|b<<16|c<<8|d)
+ *     4   uint32  ipOut        destination address, host order
+ *     8   uint32  processTime  service time in clock cycles, 1 to kMaxIngestProcessTime
+ *     12  uint8   jobType      'P' (processing) or 'S' (streaming)
+ *     13  uint8   reserved[3]  must be zero
+ *
+ * The ring is a bounded multi-producer/single-consumer queue: producers
+ * claim a slot with one compare-and-swap on the tail and publish it by storing
+ * the slot's sequence number, so pushing a record costs no system call. The
+ * consumer only sleeps on a futex when the ring is empty, and producers only
+ * issue FUTEX_WAKE while it is sleeping. The consumer checks every record with
+ * isValidIngestRecord() and drops those that break these rules.
+ */
+
+#ifndef INGESTRING_H
+#define INGESTRING_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+ //all doxygen comments are generated with AI assistance
+
+/**
+ * @brief One request as written by an external producer.
+ */
+struct IngestRecord {
+    uint32_t ipIn;          ///< Source address in host byte order.
+    uint32_t ipOut;         ///< Destination address in host byte order.
+    uint32_t processTime;   ///< Service time in clock cycles.
+    uint8_t jobType;        ///< 'P' for processing, 'S' for streaming.
+    uint8_t reserved[3];    ///< Padding, must be zero.
+};
+
+/**
+ * @brief A ring slot: a sequence number followed by the record it guards.
+ */
+struct IngestSlot {
+    std::atomic<uint64_t> sequence; ///< Equals the slot's position when free, position + 1 when full.
+    IngestRecord record;            ///< The published record.
+};
+
+/**
+ * @brief Header at the start of the shared-memory object.
+ *
+ * Producer- and consumer-owned fields sit on separate cache lines so the two
+ * sides do not false-share.
+ */
+struct IngestRingHeader {
+    uint32_t magic;            ///< kIngestMagic once the consumer finished initialising.
+    uint32_t version;          ///< kIngestVersion.
+    uint32_t recordSize;       ///< sizeof(IngestRecord), checked by producers.
+    uint32_t slotSize;         ///< sizeof(IngestSlot), checked by producers.
+    uint64_t capacity;         ///< Number of slots, a power of two.
+    char pad0[40];
+    alignas(64) std::atomic<uint64_t> tail;      ///< Next position producers claim.
+    char pad1[56];
+    alignas(64) std::atomic<uint64_t> head;      ///< Next position the consumer reads.
+    char pad2[56];
+    alignas(64) std::atomic<uint32_t> consumerIdle; ///< 1 while the consumer is (about to be) asleep.
+    std::atomic<uint32_t> wakeSequence;          ///< Futex word producers bump to wake the consumer.
+    char pad3[56];
+};
+
+const uint32_t kIngestMagic = 0x4C42494E;   ///< "LBIN"
+const uint32_t kIngestVersion = 1;          ///< Layout version of this header.
+const uint32_t kMaxIngestProcessTime = 1u << 24; ///< Longest service time a record may ask for.
+
+/**
+ * @brief Checks a record against the layout rules: job type 'P' or 'S',
+ *        process time 1 to kMaxIngestProcessTime, reserved bytes zero.
+ * @param rec The record as read from the ring.
+ * @return True if the record may become a Request.
+ */
+bool isValidIngestRecord(const IngestRecord& rec);
+
+/**
+ * @class IngestProducer
+ * @brief Producer library used by external processes to push requests.
+ *
+ * Any number of producers, in any number of processes, may attach to the same
+ * ring. push() is wait-free apart from the tail compare-and-swap retry.
+ */
+class IngestProducer {
+public:
+    IngestProducer();
+    ~IngestProducer();
+
+    /**
+     * @brief Attaches to a ring created by an IngestConsumer.
+     * @param name The shared-memory object name (e.g. "/lb_ingest").
+     * @return True if the ring exists and has a compatible layout.
+     */
+    bool open(const std::string& name);
+
+    /**
+     * @brief Publishes one record.
+     * @param record The record to publish.
+     * @return False if the ring is full (the record is not published).
+     */
+    bool push(const IngestRecord& record);
+
+    /**
+     * @brief Detaches from the ring.
+     */
+    void close();
+
+private:
+    IngestRingHeader* header = nullptr; ///< Mapped header.
+    IngestSlot* slots = nullptr;        ///< Mapped slot array.
+    size_t mappedBytes = 0;             ///< Size of the mapping.
+};
+
+/**
+ * @class IngestConsumer
+ * @brief Owner and single reader of a shared-memory ingest ring.
+ */
+class IngestConsumer {
+public:
+    IngestConsumer();
+    ~IngestConsumer();
+
+    /**
+     * @brief Creates (or recreates) the shared-memory ring.
+     * @param name The shared-memory object name (e.g. "/lb_ingest").
+     * @param capacity Requested slot count, rounded up to a power of two.
+     * @return True on success.
+     */
+    bool create(const std::string& name, size_t capacity);
+
+    /**
+     * @brief Reads up to max records without blocking.
+     * @param out Array receiving the records.
+     * @param max Capacity of out.
+     * @return The number of records read.
+     */
+    size_t poll(IngestRecord* out, size_t max);
+
+    /**
+     * @brief Checks whether a record is ready to be read.
+     * @return True if poll() would return at least one record.
+     */
+    bool hasPending() const;
+
+    /**
+     * @brief Sleeps on the futex until a producer publishes or the timeout expires.
+     * @param timeoutMs Maximum time to sleep in milliseconds.
+     */
+    void wait(int timeoutMs);
+
+    /**
+     * @brief Unmaps and unlinks the ring.
+     */
+    void close();
+
+private:
+    std::string name;                   ///< Shared-memory object name.
+    IngestRingHeader* header = nullptr; ///< Mapped header.
+    IngestSlot* slots = nullptr;        ///< Mapped slot array.
+    size_t mappedBytes = 0;             ///< Size of the mapping.
+};
+
+#endif
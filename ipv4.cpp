@@ -0,0 +1,267 @@
+#include "ipv4.h"
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define IPV4_HAVE_SSE41_PATH 1
+#endif
+
+namespace {
+
+/**
+ * @brief Formatting table: the decimal text of every octet followed by a dot.
+ *
+ * Each entry holds four bytes ("d.", "dd.", "ddd." padded) and the length of
+ * the text including the dot, so formatting an octet is one 4-byte copy and
+ * one add with no branches on the octet's value.
+ */
+struct OctetText {
+    char text[4];      ///< Digits followed by '.', unused bytes are '.'.
+    uint8_t length;    ///< Number of digits plus one for the dot.
+};
+
+struct OctetTable {
+    OctetText entries[256];
+
+    OctetTable() {
+        for (int v = 0; v < 256; ++v) {
+            OctetText& e = entries[v];
+            std::memset(e.text, '.', sizeof(e.text));
+            int n = 0;
+            if (v >= 100) {
+                e.text[n++] = static_cast<char>('0' + v / 100);
+            }
+            if (v >= 10) {
+                e.text[n++] = static_cast<char>('0' + v / 10 % 10);
+            }
+            e.text[n++] = static_cast<char>('0' + v % 10);
+            e.length = static_cast<uint8_t>(n + 1);
+        }
+    }
+};
+
+const OctetTable octetTable; ///< Built once at start-up.
+
+/**
+ * @brief Portable parser used when SSE4.1 is unavailable or the input length
+ * rules out a valid address. It applies the same validation rules.
+ */
+bool parseIpv4Scalar(const char* text, size_t length, uint32_t& out) {
+    uint32_t addr = 0;
+    size_t pos = 0;
+    for (int field = 0; field < 4; ++field) {
+        if (field > 0) {
+            if (pos >= length || text[pos] != '.') {
+                return false;
+            }
+            ++pos;
+        }
+        size_t start = pos;
+        uint32_t value = 0;
+        while (pos < length && pos - start < 3 && text[pos] >= '0' && text[pos] <= '9') {
+            value = value * 10 + static_cast<uint32_t>(text[pos] - '0');
+            ++pos;
+        }
+        size_t digits = pos - start;
+        if (digits == 0 || value > 255 || (digits > 1 && text[start] == '0')) {
+            return false;
+        }
+        addr = (addr << 8) | value;
+    }
+    if (pos != length) {
+        return false;
+    }
+    out = addr;
+    return true;
+}
+
+#ifdef IPV4_HAVE_SSE41_PATH
+
+/**
+ * @brief Shuffle masks for every combination of four field lengths (3^4 = 81).
+ *
+ * Mask k right-aligns each field's digits in its own 32-bit lane as
+ * [hundreds, tens, ones, 0]; missing leading digits and the padding byte
+ * select zero (0x80).
+ */
+struct ShuffleTable {
+    alignas(16) int8_t masks[81][16];
+
+    ShuffleTable() {
+        for (int key = 0; key < 81; ++key) {
+            int lengths[4] = {key / 27 + 1, key / 9 % 3 + 1, key / 3 % 3 + 1, key % 3 + 1};
+            std::memset(masks[key], 0x80, sizeof(masks[key]));
+            int start = 0;
+            for (int field = 0; field < 4; ++field) {
+                int len = lengths[field];
+                for (int d = 0; d < len; ++d) {
+                    masks[key][field * 4 + 3 - len + d] = static_cast<int8_t>(start + d);
+                }
+                start += len + 1;
+            }
+        }
+    }
+};
+
+const ShuffleTable shuffleTable; ///< Built once at start-up.
+
+/**
+ * @brief SSE4.1 parser.
+ *
+ * Classifies all 16 bytes at once (digit / dot / out of range), derives the
+ * four field lengths from the dot bitmask, then uses one shuffle and two
+ * multiply-adds to turn the digits of all four fields into integers.
+ *
+ * @pre 7 <= length <= 15.
+ */
+__attribute__((target("sse4.1")))
+bool parseIpv4Sse41(const char* text, size_t length, uint32_t& out) {
+    __m128i raw;
+    // A 16-byte load is safe unless it would cross into the next page.
+    if ((reinterpret_cast<uintptr_t>(text) & 4095) <= 4096 - 16) {
+        raw = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text));
+    } else {
+        alignas(16) char copy[16] = {};
+        std::memcpy(copy, text, length);
+        raw = _mm_load_si128(reinterpret_cast<const __m128i*>(copy));
+    }
+
+    const __m128i values = _mm_sub_epi8(raw, _mm_set1_epi8('0'));
+    const __m128i isDigit = _mm_cmpeq_epi8(_mm_min_epu8(values, _mm_set1_epi8(9)), values);
+    const __m128i isDot = _mm_cmpeq_epi8(raw, _mm_set1_epi8('.'));
+
+    const unsigned rangeBits = (1u << length) - 1; // bytes past the text are ignored
+    const unsigned digitBits = static_cast<unsigned>(_mm_movemask_epi8(isDigit)) & rangeBits;
+    const unsigned dotBits = static_cast<unsigned>(_mm_movemask_epi8(isDot)) & rangeBits;
+    if ((digitBits | dotBits) != rangeBits || __builtin_popcount(dotBits) != 3) {
+        return false;
+    }
+
+    const int p0 = __builtin_ctz(dotBits);
+    const int p1 = __builtin_ctz(dotBits & (dotBits - 1));
+    const int p2 = 31 - __builtin_clz(dotBits);
+    const int l0 = p0;
+    const int l1 = p1 - p0 - 1;
+    const int l2 = p2 - p1 - 1;
+    const int l3 = static_cast<int>(length) - p2 - 1;
+    if (l0 < 1 || l0 > 3 || l1 < 1 || l1 > 3 || l2 < 1 || l2 > 3 || l3 < 1 || l3 > 3) {
+        return false;
+    }
+
+    // Reject leading zeros: a multi-digit field may not start with '0'.
+    const unsigned zeroBits = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(raw, _mm_set1_epi8('0'))));
+    const unsigned multiDigitStarts = (l0 > 1 ? 1u : 0u) | (l1 > 1 ? 1u << (p0 + 1) : 0u) |
+                                      (l2 > 1 ? 1u << (p1 + 1) : 0u) | (l3 > 1 ? 1u << (p2 + 1) : 0u);
+    if (zeroBits & multiDigitStarts) {
+        return false;
+    }
+
+    const int key = (l0 - 1) * 27 + (l1 - 1) * 9 + (l2 - 1) * 3 + (l3 - 1);
+    const __m128i mask = _mm_load_si128(reinterpret_cast<const __m128i*>(shuffleTable.masks[key]));
+    const __m128i lanes = _mm_shuffle_epi8(values, mask);
+    const __m128i weights = _mm_setr_epi8(100, 10, 1, 0, 100, 10, 1, 0, 100, 10, 1, 0, 100, 10, 1, 0);
+    const __m128i pairs = _mm_maddubs_epi16(lanes, weights);
+    const __m128i octets = _mm_madd_epi16(pairs, _mm_set1_epi16(1));
+    if (_mm_movemask_epi8(_mm_cmpgt_epi32(octets, _mm_set1_epi32(255))) != 0) {
+        return false;
+    }
+    const __m128i packed = _mm_packus_epi16(_mm_packus_epi32(octets, octets), _mm_setzero_si128());
+    out = __builtin_bswap32(static_cast<uint32_t>(_mm_cvtsi128_si32(packed)));
+    return true;
+}
+
+/**
+ * @brief Whether the running CPU supports SSE4.1 (checked once).
+ */
+#ifdef __SSE4_1__
+const bool haveSse41 = true;
+#else
+const bool haveSse41 = []() {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("sse4.1") != 0;
+}();
+#endif
+
+#endif // IPV4_HAVE_SSE41_PATH
+
+} // namespace
+
+/**
+ * @brief Parses a dotted-quad IPv4 address.
+ *
+ * Uses the SSE4.1 path when the CPU supports it and falls back to the scalar
+ * parser otherwise. Both apply identical validation.
+ *
+ * @param text Pointer to the address text (need not be null-terminated).
+ * @param length Number of characters in text.
+ * @param out Receives the address in host byte order on success.
+ * @return True if the text was a valid address, false otherwise.
+ */
+bool parseIpv4(const char* text, size_t length, uint32_t& out) {
+    if (length < 7 || length > kIpv4MaxTextLength) {
+        return false;
+    }
+#ifdef IPV4_HAVE_SSE41_PATH
+    if (haveSse41) {
+        return parseIpv4Sse41(text, length, out);
+    }
+#endif
+    return parseIpv4Scalar(text, length, out);
+}
+
+/**
+ * @brief Parses a dotted-quad IPv4 address held in a string.
+ * @param text The address text.
+ * @param out Receives the address in host byte order on success.
+ * @return True if the text was a valid address, false otherwise.
+ */
+bool parseIpv4(const std::string& text, uint32_t& out) {
+    return parseIpv4(text.data(), text.size(), out);
+}
+
+/**
+ * @brief Formats an address into a caller-provided buffer.
+ *
+ * Every octet is a fixed 4-byte copy from the octet table followed by an
+ * advance of its length, so the only data-dependent work is the table lookup.
+ *
+ * @param addr The address in host byte order.
+ * @param out Buffer with room for at least kIpv4BufferSize characters.
+ * @return The number of characters written (no terminator is added).
+ */
+size_t formatIpv4(uint32_t addr, char* out) {
+    const OctetText& a = octetTable.entries[addr >> 24];
+    const OctetText& b = octetTable.entries[(addr >> 16) & 0xFF];
+    const OctetText& c = octetTable.entries[(addr >> 8) & 0xFF];
+    const OctetText& d = octetTable.entries[addr & 0xFF];
+    size_t len = 0;
+    std::memcpy(out + len, a.text, 4);
+    len += a.length;
+    std::memcpy(out + len, b.text, 4);
+    len += b.length;
+    std::memcpy(out + len, c.text, 4);
+    len += c.length;
+    std::memcpy(out + len, d.text, 4);
+    len += d.length - 1u; // no dot after the last octet
+    return len;
+}
+
+/**
+ * @brief Formats an address as a string.
+ * @param addr The address in host byte order.
+ * @return The dotted-quad text.
+ */
+std::string formatIpv4(uint32_t addr) {
+    char buf[kIpv4BufferSize];
+    return std::string(buf, formatIpv4(addr, buf));
+}
+
+/**
+ * @brief Appends an address to a string without a temporary.
+ * @param out String to append to.
+ * @param addr The address in host byte order.
+ */
+void appendIpv4(std::string& out, uint32_t addr) {
+    char buf[kIpv4BufferSize];
+    out.append(buf, formatIpv4(addr, buf));
+}
@@ -0,0 +1,75 @@
+/**
+ * @file ipv4.h
+ *
+ * This file contains the IPv4 codec shared by ingest, the blocklist, snapshots
+ * and logging. It converts dotted-quad addresses between their text form and a
+ * host-order 32-bit integer (a.b.c.d is a<<24|b<<16|c<<8|d).
+ *
+ * Parsing uses SSE4.1 when the CPU supports it (checked once at start-up)
+ * and a scalar fallback otherwise; formatting is table-driven and writes into
+ * caller-provided buffers.
+ */
+
+#ifndef IPV4_H
+#define IPV4_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+ //all doxygen comments are generated with AI assistance
+
+/**
+ * @brief Longest dotted-quad text, "255.255.255.255", without a terminator.
+ */
+const size_t kIpv4MaxTextLength = 15;
+
+/**
+ * @brief Size of the buffer formatIpv4() needs; it may write one byte past the text.
+ */
+const size_t kIpv4BufferSize = 16;
+
+/**
+ * @brief Parses a dotted-quad IPv4 address.
+ *
+ * Exactly four decimal fields of one to three digits, each at most 255 and
+ * without leading zeros, separated by single dots. Nothing else may follow.
+ *
+ * @param text Pointer to the address text (need not be null-terminated).
+ * @param length Number of characters in text.
+ * @param out Receives the address in host byte order on success.
+ * @return True if the text was a valid address, false otherwise.
+ */
+bool parseIpv4(const char* text, size_t length, uint32_t& out);
+
+/**
+ * @brief Parses a dotted-quad IPv4 address held in a string.
+ * @param text The address text.
+ * @param out Receives the address in host byte order on success.
+ * @return True if the text was a valid address, false otherwise.
+ */
+bool parseIpv4(const std::string& text, uint32_t& out);
+
+/**
+ * @brief Formats an address into a caller-provided buffer.
+ * @param addr The address in host byte order.
+ * @param out Buffer with room for at least kIpv4BufferSize characters.
+ * @return The number of characters written (no terminator is added).
+ */
+size_t formatIpv4(uint32_t addr, char* out);
+
+/**
+ * @brief Formats an address as a string.
+ * @param addr The address in host byte order.
+ * @return The dotted-quad text.
+ */
+std::string formatIpv4(uint32_t addr);
+
+/**
+ * @brief Appends an address to a string without a temporary.
+ * @param out String to append to.
+ * @param addr The address in host byte order.
+ */
+void appendIpv4(std::string& out, uint32_t addr);
+
+#endif
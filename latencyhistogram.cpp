@@ -0,0 +1,145 @@
+#include "latencyhistogram.h"
+#include <algorithm>
+#include <climits>
+
+namespace {
+
+const int kSubBits = 7;                           ///< log2 of the buckets per power of two.
+const std::size_t kSubBuckets = 1u << kSubBits;   ///< Buckets per power of two above the exact range.
+const int kExactBelow = 2 << kSubBits;            ///< Latencies below this get a bucket each.
+
+} // namespace
+
+/**
+ * @brief Records one latency.
+ * 
+ * @param cycles The latency in clock cycles (negative values count as 0).
+ */
+void LatencyHistogram::record(int cycles) {
+    const std::size_t bucket = bucketOf(cycles);
+    if (bucket >= buckets.size()) {
+        buckets.resize(std::min(kLatencyBuckets, bucket + 1 + bucket / 2), 0);
+    }
+    buckets[bucket]++;
+    samples++;
+}
+
+/**
+ * @brief Gets the number of recorded latencies.
+ * 
+ * @return The sample count.
+ */
+uint64_t LatencyHistogram::count() const {
+    return samples;
+}
+
+/**
+ * @brief Gets the bytes held by the buckets.
+ * 
+ * @return The bucket storage size.
+ */
+std::size_t LatencyHistogram::getMemoryBytes() const {
+    return buckets.capacity() * sizeof(uint64_t);
+}
+
+/**
+ * @brief Gets the bucket counts, in latency order.
+ * 
+ * @return The buckets, possibly followed by empty ones.
+ */
+const std::vector<uint64_t>& LatencyHistogram::getBuckets() const {
+    return buckets;
+}
+
+/**
+ * @brief Replaces every sample with saved bucket counts.
+ * 
+ * Buckets beyond kLatencyBuckets cannot hold a latency and are ignored.
+ * 
+ * @param counts Samples per bucket, as returned by getBuckets().
+ * @param n Number of buckets, at most kLatencyBuckets.
+ */
+void LatencyHistogram::restoreBuckets(const uint64_t* counts, std::size_t n) {
+    buckets.assign(counts, counts + std::min(n, kLatencyBuckets));
+    samples = 0;
+    for (uint64_t c : buckets) {
+        samples += c;
+    }
+}
+
+/**
+ * @brief Gets a percentile of the recorded latencies.
+ * 
+ * Uses the nearest-rank method and reports the top of the bucket holding
+ * that rank: exact below 256 cycles, at most 1/128 high above.
+ * 
+ * @param pct The percentile, 0 to 100.
+ * @return The latency in clock cycles (the top of its bucket), 0 if nothing was recorded.
+ */
+int LatencyHistogram::percentile(double pct) const {
+    if (samples == 0) {
+        return 0;
+    }
+    uint64_t rank = static_cast<uint64_t>(pct / 100.0 * samples + 0.999999);
+    if (rank < 1) {
+        rank = 1;
+    }
+    uint64_t seen = 0;
+    for (std::size_t b = 0; b < buckets.size(); ++b) {
+        seen += buckets[b];
+        if (seen >= rank) {
+            return bucketTop(b);
+        }
+    }
+    return bucketTop(buckets.size() - 1);
+}
+
+/**
+ * @brief Adds every sample of another histogram.
+ * 
+ * @param other The histogram to add.
+ */
+void LatencyHistogram::merge(const LatencyHistogram& other) {
+    if (other.buckets.size() > buckets.size()) {
+        buckets.resize(other.buckets.size(), 0);
+    }
+    for (std::size_t b = 0; b < other.buckets.size(); ++b) {
+        buckets[b] += other.buckets[b];
+    }
+    samples += other.samples;
+}
+
+/**
+ * @brief Gets the bucket a latency falls in.
+ * 
+ * Below kExactBelow the bucket is the latency itself. Above, the bucket is
+ * the latency's power of two followed by its top kSubBits bits after the
+ * leading one, so consecutive buckets stay in latency order.
+ * 
+ * @param cycles The latency in clock cycles (negative values count as 0).
+ * @return The bucket index, below kLatencyBuckets.
+ */
+std::size_t LatencyHistogram::bucketOf(int cycles) {
+    if (cycles < kExactBelow) {
+        return cycles > 0 ? static_cast<std::size_t>(cycles) : 0;
+    }
+    const unsigned v = static_cast<unsigned>(cycles);
+    const int shift = (31 - __builtin_clz(v)) - kSubBits;
+    return static_cast<std::size_t>(shift) * kSubBuckets + (v >> shift);
+}
+
+/**
+ * @brief Gets the largest latency that falls in a bucket.
+ * 
+ * @param bucket The bucket index.
+ * @return The latency in clock cycles.
+ */
+int LatencyHistogram::bucketTop(std::size_t bucket) {
+    if (bucket < static_cast<std::size_t>(kExactBelow)) {
+        return static_cast<int>(bucket);
+    }
+    const std::size_t shift = bucket / kSubBuckets - 1;
+    const uint64_t mantissa = bucket - shift * kSubBuckets;
+    const uint64_t top = ((mantissa + 1) << shift) - 1;
+    return static_cast<int>(std::min<uint64_t>(top, INT_MAX));
+}
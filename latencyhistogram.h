@@ -0,0 +1,91 @@
+/**
+ * @file latencyhistogram.h
+ *
+ * This file contains the LatencyHistogram class, which records request
+ * latencies in whole clock cycles and answers percentile queries in fixed
+ * memory.
+ */
+
+#ifndef LATENCYHISTOGRAM_H
+#define LATENCYHISTOGRAM_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+ //all doxygen comments are generated with AI assistance
+
+const std::size_t kLatencyBuckets = 3200; ///< Most buckets a LatencyHistogram holds; every int latency fits.
+
+/**
+ * @class LatencyHistogram
+ * @brief Log-linear histogram of latencies.
+ *
+ * Latencies below 256 cycles get a bucket each; above that every power of two
+ * is split into 128 buckets, so a percentile is exact below 256 cycles and
+ * within 1/128 of the true value above. The buckets only grow as far as the
+ * largest latency seen and never beyond kLatencyBuckets, so a long overload
+ * run cannot make the histogram grow with its latencies.
+ */
+class LatencyHistogram {
+public:
+    /**
+     * @brief Records one latency.
+     * @param cycles The latency in clock cycles (negative values count as 0).
+     */
+    void record(int cycles);
+
+    /**
+     * @brief Gets the number of recorded latencies.
+     * @return The sample count.
+     */
+    uint64_t count() const;
+
+    /**
+     * @brief Gets a percentile of the recorded latencies.
+     * @param pct The percentile, 0 to 100.
+     * @return The latency in clock cycles (the top of its bucket), 0 if nothing was recorded.
+     */
+    int percentile(double pct) const;
+
+    /**
+     * @brief Adds every sample of another histogram.
+     * @param other The histogram to add.
+     */
+    void merge(const LatencyHistogram& other);
+
+    /**
+     * @brief Gets the bytes held by the buckets.
+     * @return The bucket storage size.
+     */
+    std::size_t getMemoryBytes() const;
+
+    /**
+     * @brief Gets the bucket counts, in latency order.
+     * @return The buckets, possibly followed by empty ones.
+     */
+    const std::vector<uint64_t>& getBuckets() const;
+
+    /**
+     * @brief Replaces every sample with saved bucket counts.
+     * @param counts Samples per latency, as returned by getBuckets().
+     * @param n Number of buckets, at most kLatencyBuckets.
+     */
+    void restoreBuckets(const uint64_t* counts, std::size_t n);
+
+private:
+    /**
+     * @brief Gets the bucket a latency falls in.
+     */
+    static std::size_t bucketOf(int cycles);
+
+    /**
+     * @brief Gets the largest latency that falls in a bucket.
+     */
+    static int bucketTop(std::size_t bucket);
+
+    std::vector<uint64_t> buckets; ///< Number of samples per bucket.
+    uint64_t samples = 0;          ///< Total samples.
+};
+
+#endif
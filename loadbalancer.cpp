@@ -1,5 +1,11 @@
 #include "loadbalancer.h"
+#include "ipv4.h"
+#include "profiler.h"
 #include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
 
 /**
  * @brief Constructs a LoadBalancer with a specified LogManager for logging.
@@ -7,7 +13,7 @@
  * @param logger Reference to a LogManager object used for logging activities.
  */
 LoadBalancer::LoadBalancer(LogManager& logger)
-    : logger(logger) {  
+    : logger(logger), blockedIpRanges(CountingAllocator<IpRange>(&blocklistMemory)) {  
     initializeBlockedIpRanges();
 }
 
@@ -36,6 +42,19 @@ Request LoadBalancer::getRequest() {
     return requestQueue.getRequest();
 }
 
+/**
+ * @brief Gets the next request without removing it.
+ * 
+ * Lets the caller check whether a server can take the request before
+ * dequeuing it.
+ * 
+ * @pre The request queue is not empty.
+ * @return The request at the head of the queue.
+ */
+const Request& LoadBalancer::peekRequest() const {
+    return requestQueue.front();
+}
+
 /**
  * @brief Checks if the request queue is empty.
  * 
@@ -88,14 +107,70 @@ WebServer& LoadBalancer::getNextServer() {
  * @return True if the IP address is blocked, false otherwise.
  */
 bool LoadBalancer::isIpBlocked(const std::string& ip) const {
+    uint32_t addr;
+    return parseIpv4(ip, addr) && isIpBlocked(addr);
+}
+
+/**
+ * @brief Checks if a numeric IP address is blocked.
+ * 
+ * @param ip The IP address in host byte order.
+ * @return True if the IP address falls in a blocked range, false otherwise.
+ */
+bool LoadBalancer::isIpBlocked(uint32_t ip) const {
     for (const auto& range : blockedIpRanges) {
-        if (ip.substr(0, range.length()) == range) {
+        if ((ip & range.mask) == range.prefix) {
             return true;
         }
     }
     return false;
 }
 
+/**
+ * @brief Replaces the blocked IP ranges with the ones listed in a file.
+ * 
+ * Each line is an address with an optional "/bits" prefix length of one or
+ * two digits, 0 to 32. Any malformed line rejects the whole file, since a
+ * typo silently read as /0 would block every address.
+ * 
+ * @param path The blocklist file.
+ * @return True if the file was read and every line was valid, false otherwise.
+ */
+bool LoadBalancer::loadBlockedIpRanges(const std::string& path) {
+    std::ifstream in(path.c_str());
+    if (!in.is_open()) {
+        std::cerr << "Failed to open blocklist: " << path << std::endl;
+        return false;
+    }
+    std::vector<IpRange> ranges;
+    std::string line;
+    while (std::getline(in, line)) {
+        line.erase(line.find_last_not_of(" \t\r") + 1);
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        size_t slash = line.find('/');
+        int bits = 32;
+        bool prefixValid = true;
+        if (slash != std::string::npos) {
+            //one or two digits and nothing after them: "10.0.0.0/" or "/8junk" must not pass as /0 or /8
+            const std::string prefix = line.substr(slash + 1);
+            prefixValid = !prefix.empty() && prefix.size() <= 2 && prefix.find_first_not_of("0123456789") == std::string::npos;
+            bits = prefixValid ? std::atoi(prefix.c_str()) : -1;
+        }
+        uint32_t addr;
+        if (!parseIpv4(line.data(), std::min(slash, line.size()), addr) || !prefixValid || bits < 0 || bits > 32) {
+            std::cerr << "Invalid blocklist entry: " << line << std::endl;
+            return false;
+        }
+        uint32_t mask = bits == 0 ? 0 : ~0u << (32 - bits);
+        IpRange range = {addr & mask, mask};
+        ranges.push_back(range);
+    }
+    blockedIpRanges.assign(ranges.begin(), ranges.end());
+    return true;
+}
+
 /**
  * @brief Gets the total number of rejected requests.
  * 
@@ -132,11 +207,635 @@ void LoadBalancer::setTotalServers(int total) {
     totalServers = total;
 }
 
+/**
+ * @brief Gets the request queue for checkpointing.
+ * 
+ * @return A read-only reference to the request queue.
+ */
+const RequestQueue& LoadBalancer::getRequestQueue() const {
+    return requestQueue;
+}
+
+/**
+ * @brief Bounds the in-memory part of the request queue and spills the rest to disk.
+ * 
+ * @param memoryRequests Requests kept in memory, 0 to keep every request in memory.
+ * @param directory Directory for the spill segment files.
+ */
+void LoadBalancer::setQueueSpill(size_t memoryRequests, const std::string& directory) {
+    requestQueue.setSpill(memoryRequests, directory);
+}
+
+/**
+ * @brief Gets the servers allocated by the autoscaler.
+ * 
+ * @return A read-only reference to the server list.
+ */
+const std::vector<WebServer>& LoadBalancer::getServers() const {
+    return servers;
+}
+
+/**
+ * @brief Gets the servers allocated by the autoscaler, for serving them.
+ * 
+ * @return The server list.
+ */
+std::vector<WebServer>& LoadBalancer::getServers() {
+    return servers;
+}
+
+/**
+ * @brief Gets the round-robin position used by getNextServer().
+ * 
+ * @return The index of the next server.
+ */
+int LoadBalancer::getCurrentServerIndex() const {
+    return currentServerIndex;
+}
+
+/**
+ * @brief Replaces the LoadBalancer's state with values from a snapshot.
+ * 
+ * Queued requests are re-inserted directly rather than through addRequest(),
+ * so they are neither re-checked against the blocklist nor counted twice.
+ * 
+ * @param time The simulation clock.
+ * @param processed The processed request count.
+ * @param rejected The rejected request count.
+ * @param serverIndex The round-robin position.
+ * @param queued The queued requests in FIFO order.
+ * @param fleet The servers allocated by the autoscaler.
+ */
+void LoadBalancer::restoreState(int time, int processed, int rejected, int serverIndex,
+                                const std::vector<Request>& queued, const std::vector<WebServer>& fleet) {
+    currentTime = time;
+    processedRequests = processed;
+    rejectedRequests = rejected;
+    currentServerIndex = serverIndex;
+    requestQueue.clear();
+    for (const auto& r : queued) {
+        requestQueue.addRequest(r);
+        nextRequestId = std::max(nextRequestId, r.getId() + 1);
+    }
+    servers = fleet;
+}
+
+/**
+ * @brief Gets the resilience counters and latencies of the whole run, for a snapshot.
+ * 
+ * @return A copy of the counters and both latency histograms.
+ */
+ResilienceStats LoadBalancer::getResilienceStats() const {
+    ResilienceStats stats;
+    stats.ejections = ejections;
+    stats.requeued = requeued;
+    stats.failedRequests = failedRequests;
+    stats.hedges = hedges;
+    stats.hedgeWins = hedgeWins;
+    stats.cancelledWork = cancelledWork;
+    stats.latency = latency;
+    stats.latencyWithoutHedging = latencyWithoutHedging;
+    return stats;
+}
+
+/**
+ * @brief Replaces the resilience counters and latencies with values from a snapshot.
+ * 
+ * With these restored, a run branched from a snapshot reports its whole
+ * history, like the processed and rejected counters.
+ * 
+ * @param stats The saved counters and histograms.
+ */
+void LoadBalancer::restoreResilienceStats(const ResilienceStats& stats) {
+    ejections = stats.ejections;
+    requeued = stats.requeued;
+    failedRequests = stats.failedRequests;
+    hedges = stats.hedges;
+    hedgeWins = stats.hedgeWins;
+    cancelledWork = stats.cancelledWork;
+    latency = stats.latency;
+    latencyWithoutHedging = stats.latencyWithoutHedging;
+}
+
+/**
+ * @brief Sets the health-check, retry and hedging policy.
+ * 
+ * @param config The policy.
+ */
+void LoadBalancer::setResilience(const ResilienceConfig& config) {
+    resilience = config;
+}
+
+/**
+ * @brief Runs one clock cycle of the servers.
+ * 
+ * Every server first completes whatever has finished; then one
+ * dispatchBatch() hands queued requests to the servers in order, each taking
+ * from the head while it can (one at a time, or several S streams with
+ * stream slots). Ejected servers get no new work. Requests a crashed server
+ * was holding come back when it restarts, or earlier at a health check, and
+ * are requeued before the batch is taken. Health checks run every
+ * healthCheckInterval cycles before any server is visited, and hedging runs
+ * after the batch, so hedge copies only use capacity the queue left over.
+ * 
+ * @param pool The servers requests are dispatched to.
+ */
+void LoadBalancer::processServers(std::vector<WebServer>& pool) {
+    if (resilience.healthCheckInterval > 0 && currentTime % resilience.healthCheckInterval == 0) {
+        PROFILE_ZONE("health");
+        runHealthChecks(pool);
+    }
+
+    if (completedAt.size() < pool.size()) {
+        completedAt.resize(pool.size(), -1);
+    }
+    for (size_t i = 0; i < pool.size(); ++i) {
+        WebServer& server = pool[i];
+        if (server.checkHealth() && !server.getFaultState().lost.empty()) {
+            scratch.clear(); // the server restarted and reset the hung connections
+            server.takeLostRequests(scratch);
+            for (const auto& req : scratch) {
+                handleLostRequest(i, req, server.getName());
+            }
+        }
+        if (!server.isIdle()) {
+            PROFILE_ZONE("completion");
+            scratch.clear();
+            if (server.completeRequests(currentTime, scratch) > 0) {
+                completedAt[i] = currentTime;
+            }
+            for (const auto& req : scratch) {
+                incrementProcessedRequests();
+                server.incrementProcessedRequestCount();
+                logger.event(LogEventKind::Completed, currentTime, server.getName());
+                finishRequest(pool, i, req);
+            }
+        }
+    }
+
+    {
+        PROFILE_ZONE("dispatch");
+        dispatchBatch(pool, requestQueue.size());
+    }
+
+    if (resilience.hedgeAfter > 0) {
+        PROFILE_ZONE("hedging");
+        hedgeSlowRequests(pool);
+    }
+
+    if (currentTime % 1024 == 0 || pool.size() != sampledFleetSize) {
+        sampleMemory(pool);
+    }
+}
+
+/**
+ * @brief Hands up to maxN queued requests to the servers that can take them.
+ * 
+ * Nothing is taken when no server can start the head request. Otherwise the
+ * batch is sized by the servers' free slots, so in the one-request model
+ * every request taken is placed; with stream slots an exclusive request that
+ * no idle server is left for goes back to the head with everything behind it.
+ * Servers that completed a request this cycle log "handling new request".
+ * 
+ * @param pool The servers requests are dispatched to.
+ * @param maxN Most requests to dispatch.
+ * @return The number of requests dispatched.
+ */
+size_t LoadBalancer::dispatchBatch(std::vector<WebServer>& pool, size_t maxN) {
+    if (maxN == 0 || requestQueue.isEmpty()) {
+        return 0;
+    }
+    const Request& head = requestQueue.front();
+    size_t capacity = 0;
+    bool headFits = false;
+    for (const auto& server : pool) {
+        if (!server.isEjected()) {
+            capacity += static_cast<size_t>(server.getFreeSlots());
+            headFits = headFits || server.canAccept(head);
+        }
+    }
+    if (!headFits) {
+        return 0;
+    }
+    batch.clear();
+    requestQueue.takeRequests(batch, std::min(maxN, capacity));
+
+    batchLog.clear();
+    size_t next = 0;
+    for (size_t i = 0; i < pool.size() && next < batch.size(); ++i) {
+        if (pool[i].isEjected()) {
+            continue;
+        }
+        const bool afterCompletion = i < completedAt.size() && completedAt[i] == currentTime;
+        while (next < batch.size() && pool[i].canAccept(batch[next])) {
+            dispatch(pool, i, batch[next++], afterCompletion);
+        }
+    }
+    if (next < batch.size()) {
+        requestQueue.returnRequests(batch.data() + next, batch.size() - next);
+    }
+    logger.events(batchLog.data(), batchLog.size());
+    return next;
+}
+
+/**
+ * @brief Hands a request to a server and adds it to the batch log.
+ * 
+ * @param pool The servers.
+ * @param index Pool index of the receiving server.
+ * @param req The request; its dispatch time is set here.
+ * @param afterCompletion Whether the server just completed a request (changes the log wording).
+ */
+void LoadBalancer::dispatch(std::vector<WebServer>& pool, size_t index, Request req, bool afterCompletion) {
+    WebServer& server = pool[index];
+    req.setDispatchTime(currentTime);
+    server.addRequest(req, currentTime);
+    batchLog.push_back(LogManager::record(afterCompletion ? LogEventKind::HandlingNew : LogEventKind::Handling,
+                                          currentTime, server.getName(), req));
+
+    if (resilience.hedgeAfter > 0) {
+        InFlight& entry = inFlight[req.getId()];
+        entry = InFlight();
+        entry.request = req;
+        entry.copies = 1;
+        entry.server[0] = static_cast<int>(index);
+        hedgeCandidates.push_back(std::make_pair(currentTime, req.getId()));
+    }
+}
+
+/**
+ * @brief Records a completed request and cancels its other copy, if any.
+ * 
+ * When the hedge copy wins, the latency the request would have had without
+ * hedging is estimated from the original copy's remaining work at its
+ * server's current speed (or from the retry it would have needed, if its
+ * server crashed). Both latencies go into their own histogram.
+ * 
+ * @param pool The servers.
+ * @param index Pool index of the server that completed the request.
+ * @param req The completed copy.
+ */
+void LoadBalancer::finishRequest(std::vector<WebServer>& pool, size_t index, const Request& req) {
+    const int observed = currentTime - req.getArrivalTime();
+    double withoutHedge = observed;
+    auto it = resilience.hedgeAfter > 0 ? inFlight.find(req.getId()) : inFlight.end();
+    if (it != inFlight.end()) {
+        InFlight& entry = it->second;
+        if (req.isHedgeCopy()) {
+            hedgeWins++;
+        }
+        if (entry.copies > 1) {
+            int other = entry.server[0] == static_cast<int>(index) ? entry.server[1] : entry.server[0];
+            WebServer& loser = pool[static_cast<size_t>(other)];
+            if (req.isHedgeCopy()) {
+                entry.withoutHedge = loser.projectedFinish(req.getId(), currentTime);
+            }
+            Request cancelled;
+            if (loser.cancelRequest(req.getId(), currentTime, cancelled)) {
+                cancelledWork += currentTime - cancelled.getDispatchTime();
+                logger.event(LogEventKind::Cancelled, currentTime, loser.getName());
+            }
+        }
+        if (req.isHedgeCopy() && entry.withoutHedge >= 0) {
+            withoutHedge = entry.withoutHedge - req.getArrivalTime();
+        }
+        inFlight.erase(it);
+    }
+    latency.record(observed);
+    latencyWithoutHedging.record(static_cast<int>(withoutHedge + 0.5));
+}
+
+/**
+ * @brief Probes every server, ejects or readmits it and collects requests lost to crashes.
+ * 
+ * A server is ejected after ejectAfter consecutive failed checks and
+ * readmitted by the first check it passes. Requests lost in a crash are
+ * noticed at the first check after it (the connection was reset), whether
+ * or not the server has been ejected yet.
+ * 
+ * @param pool The servers.
+ */
+void LoadBalancer::runHealthChecks(std::vector<WebServer>& pool) {
+    for (size_t i = 0; i < pool.size(); ++i) {
+        WebServer& server = pool[i];
+        bool passed = server.checkHealth();
+        int failures = server.recordHealthCheck(passed);
+        if (!passed && failures >= resilience.ejectAfter && !server.isEjected()) {
+            server.setEjected(true);
+            ejections++;
+            logger.event(LogEventKind::Ejected, currentTime, server.getName(), static_cast<uint32_t>(failures));
+        } else if (passed && server.isEjected()) {
+            server.setEjected(false);
+            logger.event(LogEventKind::Readmitted, currentTime, server.getName());
+        }
+
+        scratch.clear();
+        server.takeLostRequests(scratch);
+        for (const auto& req : scratch) {
+            handleLostRequest(i, req, server.getName());
+        }
+    }
+}
+
+/**
+ * @brief Requeues a lost request within its retry budget, unless another copy is still running.
+ * 
+ * Requeued requests go to the head of the queue. If the lost copy was the
+ * original of a hedged request whose hedge is still running, nothing is
+ * requeued; the estimate without hedging becomes "requeued now and served
+ * at once".
+ * 
+ * @param index Pool index of the server that lost the request.
+ * @param req The lost copy.
+ * @param serverName Name of that server, for the log.
+ */
+void LoadBalancer::handleLostRequest(size_t index, Request req, char serverName) {
+    auto it = resilience.hedgeAfter > 0 ? inFlight.find(req.getId()) : inFlight.end();
+    if (it != inFlight.end()) {
+        InFlight& entry = it->second;
+        if (entry.copies > 1) {
+            entry.copies--;
+            if (entry.server[0] == static_cast<int>(index)) {
+                entry.server[0] = entry.server[1];
+                entry.withoutHedge = currentTime + req.getProcessTime();
+            }
+            entry.server[1] = -1;
+            logger.event(LogEventKind::LostCovered, currentTime, serverName, req);
+            return;
+        }
+        inFlight.erase(it);
+    }
+
+    if (req.getRetries() < resilience.retryBudget) {
+        req.setRetries(req.getRetries() + 1);
+        req.setHedgeCopy(false);
+        requestQueue.addRequestFront(req);
+        requeued++;
+        logger.event(LogEventKind::LostRequeued, currentTime, serverName, req, static_cast<uint32_t>(req.getRetries()));
+    } else {
+        failedRequests++;
+        logger.event(LogEventKind::LostDropped, currentTime, serverName, req, static_cast<uint32_t>(req.getRetries()));
+    }
+}
+
+/**
+ * @brief Sends a second copy of every request that has been in service longer than the hedge threshold.
+ * 
+ * Candidates are kept in dispatch order, so only the expired prefix is
+ * examined each cycle. The copy goes to the first server after the
+ * original's (in pool order) that is in rotation and can take it; if none
+ * can, hedging resumes on the next cycle with the same candidate.
+ * 
+ * @param pool The servers.
+ */
+void LoadBalancer::hedgeSlowRequests(std::vector<WebServer>& pool) {
+    while (!hedgeCandidates.empty() && hedgeCandidates.front().first + resilience.hedgeAfter <= currentTime) {
+        auto it = inFlight.find(hedgeCandidates.front().second);
+        if (it == inFlight.end() || it->second.hedged || it->second.copies != 1 ||
+            it->second.request.getDispatchTime() != hedgeCandidates.front().first) {
+            hedgeCandidates.pop_front(); // completed, lost or redispatched since
+            continue;
+        }
+        InFlight& entry = it->second;
+        Request copy = entry.request;
+        copy.setHedgeCopy(true);
+        size_t target = pool.size();
+        for (size_t k = 1; k < pool.size() && target == pool.size(); ++k) {
+            size_t j = (static_cast<size_t>(entry.server[0]) + k) % pool.size();
+            if (!pool[j].isEjected() && pool[j].canAccept(copy)) {
+                target = j;
+            }
+        }
+        if (target == pool.size()) {
+            return;
+        }
+        copy.setDispatchTime(currentTime);
+        pool[target].addRequest(copy, currentTime);
+        logger.event(LogEventKind::Hedging, currentTime, pool[target].getName(), copy);
+        entry.copies = 2;
+        entry.hedged = true;
+        entry.server[1] = static_cast<int>(target);
+        hedges++;
+        hedgeCandidates.pop_front();
+    }
+}
+
+/**
+ * @brief Rebuilds the in-flight bookkeeping after the servers were restored from a snapshot.
+ * 
+ * Every in-flight copy carries its id, dispatch time and hedge flag, so the
+ * table and the hedge candidates can be reconstructed from the servers alone.
+ * 
+ * @param pool The restored servers.
+ */
+void LoadBalancer::trackInFlight(const std::vector<WebServer>& pool) {
+    inFlight.clear();
+    hedgeCandidates.clear();
+    std::vector<Request> requests;
+    for (size_t i = 0; i < pool.size(); ++i) {
+        requests.clear();
+        pool[i].inFlightRequests(requests);
+        for (const auto& req : requests) {
+            nextRequestId = std::max(nextRequestId, req.getId() + 1);
+            if (resilience.hedgeAfter <= 0) {
+                continue;
+            }
+            InFlight& entry = inFlight[req.getId()];
+            if (req.isHedgeCopy()) {
+                entry.server[1] = static_cast<int>(i);
+                entry.hedged = true;
+            } else {
+                entry.request = req;
+                entry.server[0] = static_cast<int>(i);
+            }
+            entry.copies++;
+        }
+        requests.clear();
+        WebServer copy = pool[i];
+        copy.takeLostRequests(requests);
+        for (const auto& req : requests) {
+            nextRequestId = std::max(nextRequestId, req.getId() + 1);
+        }
+    }
+    for (auto& entry : inFlight) {
+        if (entry.second.server[0] < 0) { // only the hedge copy survived
+            entry.second.server[0] = entry.second.server[1];
+            entry.second.server[1] = -1;
+        }
+        if (!entry.second.hedged) {
+            hedgeCandidates.push_back(std::make_pair(entry.second.request.getDispatchTime(), entry.first));
+        }
+    }
+    std::sort(hedgeCandidates.begin(), hedgeCandidates.end());
+}
+
+/**
+ * @brief Describes latency, retries and the cost and benefit of hedging.
+ * 
+ * The hedging cost is the server time spent on copies that were cancelled,
+ * as a share of all busy server time; the benefit is the p99 latency against
+ * the estimated p99 without hedging. Running the same seed with and without
+ * --hedge-after gives the exact counterfactual.
+ * 
+ * @param pool The servers, for their busy time.
+ * @return Report lines for the final status.
+ */
+std::string LoadBalancer::describeResilience(const std::vector<WebServer>& pool) const {
+    double busy = 0;
+    for (const auto& server : pool) {
+        busy += server.getConcurrencyCycles();
+    }
+    std::ostringstream ss;
+    ss << "  Health checks: " << (resilience.healthCheckInterval > 0 ? "every " + std::to_string(resilience.healthCheckInterval) + " cycles" : std::string("off"))
+       << ", ejections: " << ejections << std::endl
+       << "  Requests requeued: " << requeued << ", dropped after " << resilience.retryBudget << " retries: " << failedRequests << std::endl
+       << "  Latency p50/p99/p99.9: " << latency.percentile(50) << " / " << latency.percentile(99) << " / " << latency.percentile(99.9) << " cycles";
+    if (resilience.hedgeAfter > 0) {
+        uint64_t completed = latency.count();
+        ss << std::endl << std::fixed << std::setprecision(1)
+           << "  Hedges after " << resilience.hedgeAfter << " cycles: " << hedges << " (" << (completed ? 100.0 * hedges / completed : 0.0)
+           << "% of completed requests), won by the hedge: " << hedgeWins << std::endl
+           << "  Extra load: " << cancelledWork << " server-cycles on cancelled copies (" << (busy > 0 ? 100.0 * cancelledWork / busy : 0.0) << "% of busy time)" << std::endl
+           << "  p99 with hedging: " << latency.percentile(99) << " cycles, without (estimated): " << latencyWithoutHedging.percentile(99) << " cycles";
+    }
+    return ss.str();
+}
+
+/**
+ * @brief Describes the memory held by the queue, the fleet, the bookkeeping, the blocklist and the log.
+ * 
+ * The queue and the blocklist are counted exactly. The fleet and the
+ * bookkeeping are capacity-based estimates of the serving pool, sampled by
+ * processServers() every 1024 cycles and whenever the pool's size changes,
+ * so their peaks can miss a short spike.
+ * 
+ * @param pool The servers.
+ * @return Report lines for the final status.
+ */
+std::string LoadBalancer::describeMemory(const std::vector<WebServer>& pool) const {
+    const MemoryAccount& queueMemory = requestQueue.getMemory();
+    const size_t peakLength = requestQueue.getPeakLength();
+    uint64_t fleetBytes = 0;
+    for (const auto& server : pool) {
+        fleetBytes += server.getMemoryBytes();
+    }
+    const uint64_t bookkeeping = bookkeepingBytes();
+
+    std::ostringstream ss;
+    ss << "  Request queue: " << formatBytes(queueMemory.current) << " now, " << formatBytes(queueMemory.peak)
+       << " peak, " << queueMemory.allocations << " allocations";
+    if (peakLength > 0) {
+        ss << std::fixed << std::setprecision(1) << ", " << static_cast<double>(queueMemory.peak) / peakLength
+           << " bytes per request at the peak of " << peakLength << " queued";
+    }
+    ss << std::endl
+       << "  Server fleet: " << pool.size() << " servers, " << formatBytes(fleetBytes) << " now, "
+       << formatBytes(std::max(fleetMemory.peak, fleetBytes)) << " peak (estimated)" << std::endl
+       << "  Bookkeeping: " << formatBytes(bookkeeping) << " now, "
+       << formatBytes(std::max(bookkeepingMemory.peak, bookkeeping))
+       << " peak (estimated: in-flight table, buffers, latency histograms)" << std::endl
+       << "  Blocklist: " << blockedIpRanges.size() << " ranges, " << formatBytes(blocklistMemory.current) << ", "
+       << blocklistMemory.allocations << " allocations" << std::endl
+       << "  Log buffers: " << formatBytes(logger.getMemoryBytes());
+    return ss.str();
+}
+
+/**
+ * @brief Samples the fleet and bookkeeping memory estimates.
+ * 
+ * Only processServers() samples, always with the pool that is serving, so
+ * the fleet peak never mixes the autoscaler's own list with main's servers.
+ * 
+ * @param pool The servers that are serving requests.
+ */
+void LoadBalancer::sampleMemory(const std::vector<WebServer>& pool) {
+    uint64_t fleetBytes = 0;
+    for (const auto& server : pool) {
+        fleetBytes += server.getMemoryBytes();
+    }
+    fleetMemory.sample(fleetBytes);
+    bookkeepingMemory.sample(bookkeepingBytes());
+    sampledFleetSize = pool.size();
+}
+
+/**
+ * @brief Estimates the bytes of the in-flight table, buffers and histograms.
+ * 
+ * A hash-table node is counted as its value plus a next pointer.
+ * 
+ * @return The estimate.
+ */
+uint64_t LoadBalancer::bookkeepingBytes() const {
+    return inFlight.bucket_count() * sizeof(void*) +
+           inFlight.size() * (sizeof(std::pair<const uint32_t, InFlight>) + sizeof(void*)) +
+           hedgeCandidates.size() * sizeof(std::pair<int, uint32_t>) +
+           (scratch.capacity() + batch.capacity()) * sizeof(Request) + batchLog.capacity() * sizeof(LogRecord) +
+           completedAt.capacity() * sizeof(int) + latency.getMemoryBytes() + latencyWithoutHedging.getMemoryBytes();
+}
+
+/**
+ * @brief Gets the arrival-to-completion latency of every completed request.
+ * 
+ * @return The latency histogram.
+ */
+const LatencyHistogram& LoadBalancer::getLatency() const {
+    return latency;
+}
+
+/**
+ * @brief Sets the stream slots of servers created by this LoadBalancer.
+ * 
+ * Applies to servers added later by provisionServers() and allocateServer().
+ * 
+ * @param slots Stream slots per server, 0 for one request at a time.
+ */
+void LoadBalancer::setStreamSlots(int slots) {
+    streamSlots = std::max(0, slots);
+}
+
+/**
+ * @brief Adds servers to the autoscaled fleet.
+ * 
+ * @param count Number of servers to add.
+ */
+void LoadBalancer::provisionServers(int count) {
+    for (int i = 0; i < count && servers.size() < static_cast<size_t>(maxServers); ++i) {
+        servers.emplace_back(static_cast<char>('A' + servers.size()));
+        servers.back().setStreamSlots(streamSlots);
+    }
+}
+
+/**
+ * @brief Removes the newest queued request so it can be moved to another balancer.
+ * 
+ * The newest request has waited least, so moving it costs the least latency.
+ * 
+ * @return The request at the back of the queue.
+ */
+Request LoadBalancer::takeNewestRequest() {
+    return requestQueue.getNewestRequest();
+}
+
+/**
+ * @brief Queues a request moved here from another balancer.
+ * 
+ * The request passed the blocklist and was counted where it arrived, so it
+ * is only queued here.
+ * 
+ * @param r The request.
+ */
+void LoadBalancer::receiveTransfer(const Request& r) {
+    requestQueue.addRequest(r);
+}
+
 /**
  * @brief Initializes the list of blocked IP ranges.
  */
 void LoadBalancer::initializeBlockedIpRanges() {
-    blockedIpRanges = {"192.168.0.", "10.0.0."};
+    blockedIpRanges = {
+        {0xC0A80000u, 0xFFFFFF00u},   // 192.168.0.0/24
+        {0x0A000000u, 0xFFFFFF00u}    // 10.0.0.0/24
+    };
 }
 
 /**
@@ -145,21 +844,28 @@ void LoadBalancer::initializeBlockedIpRanges() {
  * @param r The Request object that was rejected.
  */
 void LoadBalancer::logRejectedRequest(const Request& r) {
-    logger.log("Rejected request from IP: " + r.getIpIn());
+    logger.event(LogEventKind::Rejected, currentTime, 0, r.getIpInAddr());
 }
 
 /**
  * @brief Adds a request to the request queue.
  * 
  * This function checks if the IP of the request is blocked. If it is not blocked,
- * the request is added to the queue, and the processed request count is updated.
+ * the request is given an id (unless it has one), added to the queue, and the
+ * processed request count is updated.
  * If the IP is blocked, the request is rejected, and the rejection is logged.
  * 
  * @param r The Request object to be added to the queue.
  */
 void LoadBalancer::addRequest(const Request& r) {
-    if (!isIpBlocked(r.getIpIn())) {
-        requestQueue.addRequest(r);
+    if (!isIpBlocked(r.getIpInAddr())) {
+        if (r.getId() == 0) {
+            Request accepted = r;
+            accepted.setId(nextRequestId++);
+            requestQueue.addRequest(accepted);
+        } else {
+            requestQueue.addRequest(r);
+        }
         incrementProcessedRequests(); 
     } else {
         rejectedRequests++;
@@ -167,6 +873,41 @@ void LoadBalancer::addRequest(const Request& r) {
     }
 }
 
+/**
+ * @brief Adds several requests to the request queue in one call.
+ * 
+ * Each arrival's New Request line is logged here, preceded by its Rejected
+ * line if its source is blocked, so the log reads as if the requests had been
+ * added one at a time; the records are written together after the accepted
+ * requests are queued.
+ * 
+ * @param requests The requests.
+ * @param count Number of requests.
+ * @return The number of requests accepted.
+ */
+size_t LoadBalancer::addRequests(const Request* requests, size_t count) {
+    batch.clear();
+    batchLog.clear();
+    for (size_t i = 0; i < count; ++i) {
+        const Request& r = requests[i];
+        if (isIpBlocked(r.getIpInAddr())) {
+            rejectedRequests++;
+            batchLog.push_back(LogManager::record(LogEventKind::Rejected, currentTime, 0, r.getIpInAddr()));
+        } else {
+            batch.push_back(r);
+            if (r.getId() == 0) {
+                batch.back().setId(nextRequestId++);
+            }
+        }
+        batchLog.push_back(LogManager::record(LogEventKind::NewRequest, currentTime, 0, r,
+                                              static_cast<uint32_t>(r.getProcessTime())));
+    }
+    requestQueue.addRequests(batch.data(), batch.size());
+    processedRequests += static_cast<int>(batch.size());
+    logger.events(batchLog.data(), batchLog.size());
+    return batch.size();
+}
+
 /**
  * @brief Allocates additional servers if needed based on the current request queue size.
  * 
@@ -178,10 +919,9 @@ void LoadBalancer::allocateServer() {
         servers.size() < static_cast<size_t>(maxServers)) {
         char newServerId = static_cast<char>('A' + servers.size());
         servers.emplace_back(newServerId);
+        servers.back().setStreamSlots(streamSlots);
 
-        logger.log("Cycle: " + std::to_string(currentTime) + 
-                   ", Server " + std::string(1, newServerId) + 
-                   " allocated, Current Queue Size: " + std::to_string(requestQueue.size()));
+        logger.event(LogEventKind::Allocated, currentTime, newServerId, static_cast<uint32_t>(requestQueue.size()));
     }
 }
 
@@ -189,16 +929,16 @@ void LoadBalancer::allocateServer() {
  * @brief Deallocates servers that are no longer active based on the current request queue size.
  * 
  * A server is deallocated if the queue size is less than two times the number of servers
- * and the total number of servers is above the minimum required.
+ * and the total number of servers is above the minimum required. Only an idle server
+ * holding no lost requests is removed, so no work disappears with it.
  */
 void LoadBalancer::deallocateServer() {
     if (requestQueue.size() < static_cast<size_t>(servers.size()) * 2 && 
-        servers.size() > static_cast<size_t>(minServers)) {
+        servers.size() > static_cast<size_t>(minServers) &&
+        servers.back().isIdle() && servers.back().getFaultState().lost.empty()) {
         char removedServerId = servers.back().getName();
         servers.pop_back();
 
-        logger.log("Cycle: " + std::to_string(currentTime) + 
-                   ", Server " + std::string(1, removedServerId) + 
-                   " deallocated, Current Queue Size: " + std::to_string(requestQueue.size()));
+        logger.event(LogEventKind::Deallocated, currentTime, removedServerId, static_cast<uint32_t>(requestQueue.size()));
     }
 }
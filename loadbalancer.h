@@ -5,10 +5,38 @@
 #include "requestqueue.h"
 #include "webserver.h"
 #include "logmanager.h"
+#include "latencyhistogram.h"
+#include "memoryaccount.h"
+#include <deque>
+#include <unordered_map>
 #include <vector>
 #include <string>
 
  //all doxygen comments are generated with AI assistance
+
+/**
+ * @brief How the LoadBalancer reacts to failing and slow servers.
+ */
+struct ResilienceConfig {
+    int healthCheckInterval = 0; ///< Cycles between health checks, 0 to disable them.
+    int ejectAfter = 2;          ///< Consecutive failed checks before a server is ejected.
+    int retryBudget = 2;         ///< Requeues allowed per request after server failures.
+    int hedgeAfter = 0;          ///< Cycles in service before a request is hedged, 0 to disable hedging.
+};
+
+/**
+ * @brief Run-wide resilience counters and latencies, saved in snapshots.
+ */
+struct ResilienceStats {
+    int ejections = 0;        ///< Servers ejected by health checks.
+    int requeued = 0;         ///< Requests requeued after a server failure.
+    int failedRequests = 0;   ///< Requests dropped after exhausting the retry budget.
+    int hedges = 0;           ///< Hedge copies sent.
+    int hedgeWins = 0;        ///< Hedged requests completed first by the hedge copy.
+    double cancelledWork = 0; ///< Server-cycles spent on cancelled copies.
+    LatencyHistogram latency;               ///< Arrival-to-completion latency.
+    LatencyHistogram latencyWithoutHedging; ///< Same, with hedge wins replaced by the original's estimate.
+};
 /**
  * @class LoadBalancer
  * @brief Manages incoming requests and distributes them among a set of web servers.
@@ -45,6 +73,20 @@ public:
      */
     void addRequest(const Request& r);
 
+    /**
+     * @brief Adds several requests to the request queue in one call.
+     * 
+     * Same admission as addRequest(): blocked sources are rejected, the others
+     * get ids and are queued in order with one bulk insert. Every arrival's New
+     * Request line is logged here, a rejected one's right after its Rejected
+     * line, in the order addRequest() and the caller would write them.
+     * 
+     * @param requests The requests.
+     * @param count Number of requests.
+     * @return The number of requests accepted.
+     */
+    size_t addRequests(const Request* requests, size_t count);
+
     /**
      * @brief Retrieves and removes the next request from the request queue.
      * 
@@ -52,6 +94,14 @@ public:
      */
     Request getRequest();
 
+    /**
+     * @brief Gets the next request without removing it.
+     * 
+     * @pre The request queue is not empty.
+     * @return The request at the head of the queue.
+     */
+    const Request& peekRequest() const;
+
     /**
      * @brief Checks if the request queue is empty.
      * 
@@ -107,6 +157,25 @@ public:
      */
     bool isIpBlocked(const std::string& ip) const;   //implemented with the assistance of AI
 
+    /**
+     * @brief Checks if a numeric IP address is blocked.
+     * 
+     * @param ip The IP address in host byte order.
+     * @return True if the IP address falls in a blocked range, false otherwise.
+     */
+    bool isIpBlocked(uint32_t ip) const;
+
+    /**
+     * @brief Replaces the blocked IP ranges with the ones listed in a file.
+     * 
+     * Each non-empty line holds one range in CIDR notation ("10.0.0.0/24");
+     * a bare address blocks just that address. Lines starting with '#' are ignored.
+     * 
+     * @param path The blocklist file.
+     * @return True if the file was read and every line was valid, false otherwise.
+     */
+    bool loadBlockedIpRanges(const std::string& path);
+
 
     /**
      * @brief Gets the total number of rejected requests.
@@ -136,6 +205,162 @@ public:
      */
     void setTotalServers(int total);
 
+    /**
+     * @brief Gets the request queue for checkpointing.
+     * 
+     * @return A read-only reference to the request queue.
+     */
+    const RequestQueue& getRequestQueue() const;
+
+    /**
+     * @brief Bounds the in-memory part of the request queue and spills the rest to disk.
+     * 
+     * @param memoryRequests Requests kept in memory, 0 to keep every request in memory.
+     * @param directory Directory for the spill segment files.
+     */
+    void setQueueSpill(size_t memoryRequests, const std::string& directory);
+
+    /**
+     * @brief Gets the servers allocated by the autoscaler.
+     * 
+     * @return A read-only reference to the server list.
+     */
+    const std::vector<WebServer>& getServers() const;
+
+    /**
+     * @brief Gets the servers allocated by the autoscaler, for serving them.
+     * 
+     * @return The server list.
+     */
+    std::vector<WebServer>& getServers();
+
+    /**
+     * @brief Gets the round-robin position used by getNextServer().
+     * 
+     * @return The index of the next server.
+     */
+    int getCurrentServerIndex() const;
+
+    /**
+     * @brief Replaces the LoadBalancer's state with values from a snapshot.
+     * 
+     * @param time The simulation clock.
+     * @param processed The processed request count.
+     * @param rejected The rejected request count.
+     * @param serverIndex The round-robin position.
+     * @param queued The queued requests in FIFO order.
+     * @param fleet The servers allocated by the autoscaler.
+     */
+    void restoreState(int time, int processed, int rejected, int serverIndex,
+                      const std::vector<Request>& queued, const std::vector<WebServer>& fleet);
+
+    /**
+     * @brief Gets the resilience counters and latencies of the whole run, for a snapshot.
+     * 
+     * @return A copy of the counters and both latency histograms.
+     */
+    ResilienceStats getResilienceStats() const;
+
+    /**
+     * @brief Replaces the resilience counters and latencies with values from a snapshot.
+     * 
+     * @param stats The saved counters and histograms.
+     */
+    void restoreResilienceStats(const ResilienceStats& stats);
+
+    // Serving, health checks, retries and hedging
+
+    /**
+     * @brief Sets the health-check, retry and hedging policy.
+     * 
+     * @param config The policy.
+     */
+    void setResilience(const ResilienceConfig& config);
+
+    /**
+     * @brief Runs one clock cycle of the servers.
+     * 
+     * Completes finished requests, runs the health checks that are due,
+     * hedges requests that have been in service too long and hands queued
+     * requests to servers that can take them.
+     * 
+     * @param pool The servers requests are dispatched to.
+     */
+    void processServers(std::vector<WebServer>& pool);
+
+    /**
+     * @brief Hands up to maxN queued requests to the servers that can take them.
+     * 
+     * Takes the requests from the queue in one call, assigns them in server
+     * order (each server takes the head while it can, as before), puts back
+     * any it could not place and logs the whole batch at once.
+     * 
+     * @param pool The servers requests are dispatched to.
+     * @param maxN Most requests to dispatch.
+     * @return The number of requests dispatched.
+     */
+    size_t dispatchBatch(std::vector<WebServer>& pool, size_t maxN);
+
+    /**
+     * @brief Rebuilds the in-flight bookkeeping after the servers were restored from a snapshot.
+     * 
+     * @param pool The restored servers.
+     */
+    void trackInFlight(const std::vector<WebServer>& pool);
+
+    /**
+     * @brief Describes latency, retries and the cost and benefit of hedging.
+     * 
+     * @param pool The servers, for their busy time.
+     * @return Report lines for the final status.
+     */
+    std::string describeResilience(const std::vector<WebServer>& pool) const;
+
+    /**
+     * @brief Gets the arrival-to-completion latency of every completed request.
+     * 
+     * @return The latency histogram.
+     */
+    const LatencyHistogram& getLatency() const;
+
+    /**
+     * @brief Describes the memory held by the queue, the fleet, the bookkeeping, the blocklist and the log.
+     * 
+     * @param pool The servers.
+     * @return Report lines for the final status.
+     */
+    std::string describeMemory(const std::vector<WebServer>& pool) const;
+
+    // Regional balancer behind a FrontTier
+
+    /**
+     * @brief Sets the stream slots of servers created by this LoadBalancer.
+     * 
+     * @param slots Stream slots per server, 0 for one request at a time.
+     */
+    void setStreamSlots(int slots);
+
+    /**
+     * @brief Adds servers to the autoscaled fleet.
+     * 
+     * @param count Number of servers to add.
+     */
+    void provisionServers(int count);
+
+    /**
+     * @brief Removes the newest queued request so it can be moved to another balancer.
+     * 
+     * @return The request at the back of the queue.
+     */
+    Request takeNewestRequest();
+
+    /**
+     * @brief Queues a request moved here from another balancer.
+     * 
+     * @param r The request, already admitted by the balancer it came from.
+     */
+    void receiveTransfer(const Request& r);
+
 private:
     LogManager& logger;  /**< Reference to the LogManager used for logging. */
     int currentTime = 0; /**< Current simulation time. */
@@ -150,9 +375,50 @@ private:
     const int minServers = 10; /**< Minimum number of servers required. */
 
    
-    std::vector<std::string> blockedIpRanges; /**< List of blocked IP ranges. */
+    /**
+     * @brief A blocked address range: every IP with (ip & mask) == prefix.
+     */
+    struct IpRange {
+        uint32_t prefix; /**< Network address in host byte order. */
+        uint32_t mask;   /**< Network mask in host byte order. */
+    };
+
+    MemoryAccount blocklistMemory; /**< Storage of the blocked ranges; declared before them. */
+    std::vector<IpRange, CountingAllocator<IpRange> > blockedIpRanges; /**< List of blocked IP ranges. */
     std::vector<WebServer> servers; /**< List of web servers managed by the LoadBalancer. */
 
+    /**
+     * @brief A request being served, possibly by two servers at once after hedging.
+     */
+    struct InFlight {
+        Request request;           /**< The original copy. */
+        int copies = 0;            /**< Copies currently on servers (1 or 2). */
+        int server[2] = {-1, -1};  /**< Pool indexes of the original and the hedge copy. */
+        bool hedged = false;       /**< Whether a hedge copy was sent. */
+        double withoutHedge = -1;  /**< Estimated completion without the hedge, once known. */
+    };
+
+    ResilienceConfig resilience; /**< Health-check, retry and hedging policy. */
+    uint32_t nextRequestId = 1; /**< Id given to the next accepted request. */
+    std::unordered_map<uint32_t, InFlight> inFlight; /**< Requests on servers, tracked while hedging. */
+    std::deque<std::pair<int, uint32_t> > hedgeCandidates; /**< (dispatch time, id) in dispatch order. */
+    std::vector<Request> scratch; /**< Reused buffer for completed and lost requests. */
+    std::vector<Request> batch; /**< Reused buffer for batched dispatch and admission. */
+    std::vector<LogRecord> batchLog; /**< Log records of the current batch. */
+    std::vector<int> completedAt; /**< Last cycle each server completed a request, by pool index. */
+    MemoryAccount fleetMemory; /**< Sampled estimate of the servers' memory. */
+    MemoryAccount bookkeepingMemory; /**< Sampled estimate of the in-flight table, buffers and histograms. */
+    size_t sampledFleetSize = 0; /**< Size of the serving pool at the last memory sample. */
+    LatencyHistogram latency; /**< Arrival-to-completion latency of every request. */
+    LatencyHistogram latencyWithoutHedging; /**< Same, with hedge wins replaced by the original's estimate. */
+    int ejections = 0; /**< Servers ejected by health checks. */
+    int requeued = 0; /**< Requests requeued after a server failure. */
+    int failedRequests = 0; /**< Requests dropped after exhausting the retry budget. */
+    int hedges = 0; /**< Hedge copies sent. */
+    int hedgeWins = 0; /**< Hedged requests completed first by the hedge copy. */
+    double cancelledWork = 0; /**< Server-cycles spent on cancelled copies. */
+    int streamSlots = 0; /**< Stream slots of servers this LoadBalancer creates. */
+
     /**
      * @brief Initializes the list of blocked IP ranges.
      */
@@ -164,6 +430,42 @@ private:
      * @param r The Request object that was rejected.
      */
     void logRejectedRequest(const Request& r);         //implemented with the assistance of AI
+
+    /**
+     * @brief Samples the fleet and bookkeeping memory estimates.
+     * @param pool The servers that are serving requests, as passed to processServers().
+     */
+    void sampleMemory(const std::vector<WebServer>& pool);
+
+    /**
+     * @brief Estimates the bytes of the in-flight table, buffers and histograms.
+     */
+    uint64_t bookkeepingBytes() const;
+
+    /**
+     * @brief Hands a request to a server and adds it to the batch log.
+     */
+    void dispatch(std::vector<WebServer>& pool, size_t index, Request req, bool afterCompletion);
+
+    /**
+     * @brief Records a completed request and cancels its other copy, if any.
+     */
+    void finishRequest(std::vector<WebServer>& pool, size_t index, const Request& req);
+
+    /**
+     * @brief Probes every server, ejects or readmits it and collects requests lost to crashes.
+     */
+    void runHealthChecks(std::vector<WebServer>& pool);
+
+    /**
+     * @brief Requeues a lost request within its retry budget, unless another copy is still running.
+     */
+    void handleLostRequest(size_t index, Request req, char serverName);
+
+    /**
+     * @brief Sends a second copy of every request that has been in service longer than the hedge threshold.
+     */
+    void hedgeSlowRequests(std::vector<WebServer>& pool);
 };
 
 #endif // LOADBALANCER_H
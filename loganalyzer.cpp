@@ -0,0 +1,506 @@
+#include "loganalyzer.h"
+#include "ipv4.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+
+namespace {
+
+const size_t kMinChunkBytes = 1 << 20; ///< Smaller logs are not worth splitting further.
+
+/**
+ * @brief Consumes a literal if the text at p starts with it.
+ */
+template <size_t N>
+inline bool consume(const char*& p, const char* end, const char (&literal)[N]) {
+    if (static_cast<size_t>(end - p) < N - 1 || std::memcmp(p, literal, N - 1) != 0) {
+        return false;
+    }
+    p += N - 1;
+    return true;
+}
+
+/**
+ * @brief Consumes a non-negative decimal number.
+ */
+inline bool readNumber(const char*& p, const char* end, int64_t& value) {
+    const char* start = p;
+    int64_t v = 0;
+    while (p < end && *p >= '0' && *p <= '9') {
+        v = v * 10 + (*p - '0');
+        ++p;
+    }
+    value = v;
+    return p != start;
+}
+
+/**
+ * @brief Returns the start of the line containing offset, moved forward so a
+ * chunk never starts between a rejection and the request line it belongs to.
+ */
+const char* chunkStart(const char* base, const char* end, const char* at) {
+    const char* p = static_cast<const char*>(std::memchr(at, '\n', static_cast<size_t>(end - at)));
+    if (p == nullptr) {
+        return end;
+    }
+    const char* lineStart = at;
+    while (lineStart > base && lineStart[-1] != '\n') {
+        --lineStart;
+    }
+    ++p;
+    const char* line = lineStart;
+    if (consume(line, p, "Rejected request from IP: ") && p < end) {
+        const char* next = static_cast<const char*>(std::memchr(p, '\n', static_cast<size_t>(end - p)));
+        return next ? next + 1 : end;
+    }
+    return p;
+}
+
+} // namespace
+
+/**
+ * @brief Maps and analyzes a log file.
+ *
+ * The mapping is split into one chunk per thread (at least 1 MB each) on line
+ * boundaries; each thread fills its own ChunkResult and the results are merged
+ * once all threads have joined, so parsing needs no locks.
+ *
+ * @param path Log file to read.
+ * @param threads Number of worker threads (0 means one per core).
+ * @return True on success, false if the file could not be mapped.
+ */
+bool LogAnalyzer::analyze(const std::string& path, int threads) {
+    auto begin = std::chrono::steady_clock::now();
+    this->path = path;
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cerr << "Failed to open log file: " << path << std::endl;
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        close(fd);
+        std::cerr << "Failed to read log file: " << path << std::endl;
+        return false;
+    }
+    bytes = static_cast<uint64_t>(st.st_size);
+    if (bytes == 0) {
+        close(fd);
+        std::vector<ChunkResult> none;
+        merge(none);
+        return true;
+    }
+    void* map = mmap(nullptr, bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        std::cerr << "Failed to map log file: " << path << std::endl;
+        return false;
+    }
+    madvise(map, bytes, MADV_SEQUENTIAL);
+    madvise(map, bytes, MADV_WILLNEED);
+
+    if (threads <= 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    const char* base = static_cast<const char*>(map);
+    const char* end = base + bytes;
+    size_t chunks = std::min<size_t>(static_cast<size_t>(threads), std::max<size_t>(1, bytes / kMinChunkBytes));
+    std::vector<const char*> bounds(1, base);
+    for (size_t i = 1; i < chunks; ++i) {
+        const char* at = chunkStart(base, end, base + bytes * i / chunks);
+        if (at > bounds.back() && at < end) {
+            bounds.push_back(at);
+        }
+    }
+    bounds.push_back(end);
+    chunkCount = static_cast<int>(bounds.size() - 1);
+
+    std::vector<ChunkResult> results(static_cast<size_t>(chunkCount));
+    std::vector<std::thread> workers;
+    for (int i = 1; i < chunkCount; ++i) {
+        workers.emplace_back(parseChunk, bounds[static_cast<size_t>(i)], bounds[static_cast<size_t>(i) + 1],
+                             std::ref(results[static_cast<size_t>(i)]));
+    }
+    parseChunk(bounds[0], bounds[1], results[0]);
+    for (auto& w : workers) {
+        w.join();
+    }
+    munmap(map, bytes);
+
+    merge(results);
+    seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    return true;
+}
+
+/**
+ * @brief Parses the lines in [begin, end) into a partial result.
+ *
+ * Queue changes are +1 per logged request (0 if the line before it rejected
+ * the request) and -1 per dispatch. Server dispatches and completions are
+ * only collected here, because how many requests a server had in flight at
+ * the start of the chunk is not known until the earlier chunks are merged.
+ *
+ * @param begin First byte of the chunk (start of a line).
+ * @param end One past the last byte of the chunk.
+ * @param r Receives the partial result.
+ */
+void LogAnalyzer::parseChunk(const char* begin, const char* end, ChunkResult& r) {
+    bool rejectedPrevious = false;
+    auto addDelta = [&r](int64_t cycle, int64_t delta) {
+        if (!r.queue.empty() && r.queue.back().cycle == cycle) {
+            r.queue.back().delta += delta;
+        } else {
+            QueueDelta q = {cycle, delta};
+            r.queue.push_back(q);
+        }
+        if (!r.hasStartingQueue) {
+            r.deltaBeforeStartingQueue += delta;
+        }
+    };
+    auto seeCycle = [&r](int64_t cycle) {
+        if (r.firstCycle < 0) {
+            r.firstCycle = cycle;
+        }
+        r.lastCycle = cycle;
+    };
+
+    const char* line = begin;
+    while (line < end) {
+        const char* eol = static_cast<const char*>(std::memchr(line, '\n', static_cast<size_t>(end - line)));
+        if (eol == nullptr) {
+            eol = end;
+        }
+        const char* lineEnd = (eol > line && eol[-1] == '\r') ? eol - 1 : eol;
+        const char* const text = line;
+        const char* p = text;
+        line = eol + 1;
+        r.lines++;
+        bool rejectedHere = false;
+        int64_t cycle;
+
+        if (consume(p, lineEnd, "Clock Cycle: ") && readNumber(p, lineEnd, cycle) && consume(p, lineEnd, ", ")) {
+            if (consume(p, lineEnd, "Initial Request: ") || consume(p, lineEnd, "New Request: ")) {
+                seeCycle(cycle);
+                r.arrivals++;
+                addDelta(cycle, rejectedPrevious ? 0 : 1);
+            } else if (consume(p, lineEnd, "Shed request") || consume(p, lineEnd, "Stolen request")) {
+                seeCycle(cycle);
+                r.movedOut++;
+                addDelta(cycle, -1);
+            } else if (consume(p, lineEnd, "Received request")) {
+                seeCycle(cycle);
+                r.movedIn++;
+                addDelta(cycle, 1);
+            } else if (consume(p, lineEnd, "Server ") && p + 1 < lineEnd) {
+                seeCycle(cycle);
+                ChunkResult::ServerPart& s = r.servers[static_cast<unsigned char>(*p)];
+                p += 2;
+                if (consume(p, lineEnd, "handling")) {
+                    s.dispatched++;
+                    ServerEvent e = {cycle, 1};
+                    s.events.push_back(e);
+                    addDelta(cycle, -1);
+                } else if (consume(p, lineEnd, "completed")) {
+                    s.completed++;
+                    ServerEvent e = {cycle, -1};
+                    s.events.push_back(e);
+                } else if (consume(p, lineEnd, "hedging")) {
+                    s.dispatched++;
+                    r.hedges++;
+                    ServerEvent e = {cycle, 1};
+                    s.events.push_back(e);
+                } else if (consume(p, lineEnd, "cancelled")) {
+                    r.cancelled++;
+                    ServerEvent e = {cycle, -1};
+                    s.events.push_back(e);
+                } else if (consume(p, lineEnd, "lost")) {
+                    r.lost++;
+                    ServerEvent e = {cycle, -1};
+                    s.events.push_back(e);
+                    const char* tail = static_cast<const char*>(std::memchr(p, ',', static_cast<size_t>(lineEnd - p)));
+                    if (tail != nullptr && (p = tail, consume(p, lineEnd, ", requeued"))) {
+                        r.requeued++;
+                        addDelta(cycle, 1);
+                    }
+                } else if (consume(p, lineEnd, "crashed")) {
+                    r.crashes++;
+                } else if (consume(p, lineEnd, "slowed")) {
+                    r.slowdowns++;
+                }
+            } else {
+                seeCycle(cycle);
+            }
+        } else if ((p = text), consume(p, lineEnd, "Cycle: ")) {
+            int64_t queueSize = 0;
+            if (readNumber(p, lineEnd, cycle) && consume(p, lineEnd, ", Server ") && p + 1 < lineEnd) {
+                seeCycle(cycle);
+                ScaleEvent e = {cycle, *p, false, 0};
+                p += 2;
+                e.allocated = consume(p, lineEnd, "allocated");
+                if (e.allocated || consume(p, lineEnd, "deallocated")) {
+                    if (consume(p, lineEnd, ", Current Queue Size: ") && readNumber(p, lineEnd, queueSize)) {
+                        e.queueSize = queueSize;
+                    }
+                    r.scaleEvents.push_back(e);
+                }
+            }
+        } else if (consume(p, lineEnd, "Rejected request from IP: ")) {
+            r.rejected++;
+            rejectedHere = true;
+            uint32_t addr;
+            if (parseIpv4(p, static_cast<size_t>(lineEnd - p), addr)) {
+                r.rejectedBySubnet[addr >> 8]++;
+            }
+        } else if (consume(p, lineEnd, "Starting Queue Size: ")) {
+            int64_t size;
+            if (!r.hasStartingQueue && readNumber(p, lineEnd, size)) {
+                r.hasStartingQueue = true;
+                r.startingQueue = size;
+            }
+        }
+        rejectedPrevious = rejectedHere;
+    }
+}
+
+/**
+ * @brief Stitches partial results together in log order.
+ *
+ * Each server's events are replayed across chunks with a running count of
+ * requests in flight; a busy interval spans the time that count is above
+ * zero. Completions of requests dispatched before the log starts (a run
+ * restored from a snapshot) extend the first interval back to the first
+ * cycle. The queue curve is a
+ * running sum of the per-cycle deltas, offset so that it matches the logged
+ * "Starting Queue Size" (which also covers runs restored from a snapshot,
+ * whose queued requests were never logged as arrivals).
+ *
+ * @param chunks Partial results in log order; their buffers are consumed.
+ */
+void LogAnalyzer::merge(std::vector<ChunkResult>& chunks) {
+    lines = arrivals = rejected = 0;
+    crashes = slowdowns = hedges = cancelled = lost = requeued = movedOut = movedIn = 0;
+    firstCycle = lastCycle = -1;
+    queueBase = 0;
+    queueCurve.clear();
+    scaleEvents.clear();
+    rejectedBySubnet.clear();
+    for (int k = 0; k < 256; ++k) {
+        busy[k].clear();
+        dispatched[k] = completed[k] = 0;
+        stillBusySince[k] = -1;
+        inFlight[k] = peakConcurrency[k] = 0;
+        concurrencyCycles[k] = 0.0;
+    }
+    int64_t lastEvent[256] = {};
+
+    int64_t logged = 0;
+    bool anchored = false;
+    for (const auto& c : chunks) {
+        if (c.hasStartingQueue && !anchored) {
+            queueBase = c.startingQueue - (logged + c.deltaBeforeStartingQueue);
+            anchored = true;
+        }
+        for (const auto& q : c.queue) {
+            logged += q.delta;
+        }
+        if (firstCycle < 0) {
+            firstCycle = c.firstCycle;
+        }
+        if (c.lastCycle >= 0) {
+            lastCycle = c.lastCycle;
+        }
+    }
+
+    int64_t depth = queueBase;
+    for (auto& c : chunks) {
+        lines += c.lines;
+        arrivals += c.arrivals;
+        rejected += c.rejected;
+        crashes += c.crashes;
+        slowdowns += c.slowdowns;
+        hedges += c.hedges;
+        cancelled += c.cancelled;
+        lost += c.lost;
+        requeued += c.requeued;
+        movedOut += c.movedOut;
+        movedIn += c.movedIn;
+        for (const auto& q : c.queue) {
+            depth += q.delta;
+            if (!queueCurve.empty() && queueCurve.back().first == q.cycle) {
+                queueCurve.back().second = depth;
+            } else {
+                queueCurve.push_back(std::make_pair(q.cycle, depth));
+            }
+        }
+        scaleEvents.insert(scaleEvents.end(), c.scaleEvents.begin(), c.scaleEvents.end());
+        for (const auto& entry : c.rejectedBySubnet) {
+            rejectedBySubnet[entry.first] += entry.second;
+        }
+        for (int k = 0; k < 256; ++k) {
+            ChunkResult::ServerPart& s = c.servers[k];
+            dispatched[k] += s.dispatched;
+            completed[k] += s.completed;
+            for (const auto& e : s.events) {
+                concurrencyCycles[k] += static_cast<double>(inFlight[k]) * (e.cycle - lastEvent[k]);
+                lastEvent[k] = e.cycle;
+                if (e.delta > 0) {
+                    if (inFlight[k]++ == 0) {
+                        stillBusySince[k] = e.cycle;
+                    }
+                    peakConcurrency[k] = std::max(peakConcurrency[k], inFlight[k]);
+                } else if (inFlight[k] > 0) {
+                    if (--inFlight[k] == 0) {
+                        BusyInterval b = {stillBusySince[k], e.cycle};
+                        busy[k].push_back(b);
+                        stillBusySince[k] = -1;
+                    }
+                } else if (busy[k].empty()) {
+                    // dispatched before the log starts (restored run): busy from the first cycle
+                    BusyInterval b = {firstCycle, e.cycle};
+                    busy[k].push_back(b);
+                    concurrencyCycles[k] += static_cast<double>(e.cycle - firstCycle);
+                    peakConcurrency[k] = std::max<int64_t>(peakConcurrency[k], 1);
+                }
+            }
+            std::vector<ServerEvent>().swap(s.events);
+        }
+    }
+    for (int k = 0; k < 256; ++k) {
+        concurrencyCycles[k] += static_cast<double>(inFlight[k]) * (lastCycle + 1 - lastEvent[k]);
+    }
+}
+
+/**
+ * @brief Prints a summary of the merged results.
+ * @param out Stream to write to.
+ */
+void LogAnalyzer::report(std::ostream& out) const {
+    const double mb = bytes / 1e6;
+    out << "Log analysis of " << path << std::endl
+        << std::fixed << std::setprecision(1)
+        << "  Size: " << mb << " MB, " << lines << " lines, " << chunkCount << " chunks, "
+        << seconds * 1000.0 << " ms (" << (seconds > 0 ? mb / seconds : 0.0) << " MB/s)" << std::endl;
+    if (firstCycle < 0) {
+        out << "  No clock cycles found." << std::endl;
+        out.unsetf(std::ios::floatfield);
+        return;
+    }
+    const int64_t span = lastCycle - firstCycle + 1;
+    out << "  Clock cycles: " << firstCycle << " to " << lastCycle << std::endl;
+
+    uint64_t totalDispatched = 0;
+    uint64_t totalCompleted = 0;
+    for (int k = 0; k < 256; ++k) {
+        totalDispatched += dispatched[k];
+        totalCompleted += completed[k];
+    }
+    out << "  Requests: " << arrivals << " arrived, " << rejected << " rejected, "
+        << totalDispatched << " dispatched, " << totalCompleted << " completed" << std::endl;
+
+    // time-weighted mean: each depth holds until the next cycle with a change
+    int64_t peak = queueBase;
+    int64_t peakCycle = firstCycle;
+    double weighted = 0.0;
+    int64_t prevCycle = firstCycle;
+    int64_t prevDepth = queueBase;
+    for (const auto& point : queueCurve) {
+        weighted += static_cast<double>(prevDepth) * (point.first - prevCycle);
+        prevCycle = point.first;
+        prevDepth = point.second;
+        if (point.second > peak) {
+            peak = point.second;
+            peakCycle = point.first;
+        }
+    }
+    weighted += static_cast<double>(prevDepth) * (lastCycle + 1 - prevCycle);
+    out << "  Queue depth: start " << queueBase << ", peak " << peak << " at cycle " << peakCycle
+        << ", mean " << weighted / span << ", final " << prevDepth << std::endl;
+
+    size_t allocations = 0;
+    for (const auto& e : scaleEvents) {
+        allocations += e.allocated ? 1 : 0;
+    }
+    out << "  Scale events: " << allocations << " allocations, "
+        << scaleEvents.size() - allocations << " deallocations" << std::endl;
+    if (crashes + slowdowns + hedges > 0) {
+        out << "  Faults: " << crashes << " crashes, " << slowdowns << " slowdowns, " << lost << " requests lost ("
+            << requeued << " requeued), " << hedges << " hedges, " << cancelled << " cancelled copies" << std::endl;
+    }
+    if (movedOut + movedIn > 0) {
+        out << "  Transfers: " << movedOut << " requests moved to other balancers, " << movedIn << " received" << std::endl;
+    }
+
+    if (!rejectedBySubnet.empty()) {
+        std::vector<std::pair<uint64_t, uint32_t> > subnets;
+        for (const auto& entry : rejectedBySubnet) {
+            subnets.push_back(std::make_pair(entry.second, entry.first));
+        }
+        std::sort(subnets.rbegin(), subnets.rend());
+        out << "  Most rejected /24 networks:" << std::endl;
+        for (size_t i = 0; i < subnets.size() && i < 5; ++i) {
+            out << "    " << formatIpv4(subnets[i].second << 8) << "/24: " << subnets[i].first << std::endl;
+        }
+    }
+
+    out << "  Server  Dispatched  Completed  Busy cycles  Utilization  Avg conc  Peak conc" << std::endl;
+    for (int k = 0; k < 256; ++k) {
+        if (dispatched[k] == 0 && completed[k] == 0) {
+            continue;
+        }
+        int64_t busyCycles = 0;
+        for (const auto& b : busy[k]) {
+            busyCycles += b.end - b.start;
+        }
+        if (stillBusySince[k] >= 0) {
+            busyCycles += lastCycle + 1 - stillBusySince[k];
+        }
+        out << "  " << std::left << std::setw(6) << static_cast<char>(k) << std::right
+            << std::setw(12) << dispatched[k] << std::setw(11) << completed[k]
+            << std::setw(13) << busyCycles << std::setw(12) << 100.0 * busyCycles / span << "%"
+            << std::setw(10) << std::setprecision(2) << concurrencyCycles[k] / span << std::setw(11) << peakConcurrency[k]
+            << std::setprecision(1) << std::endl;
+    }
+    out.unsetf(std::ios::floatfield);
+}
+
+/**
+ * @brief Writes the busy timelines, queue curve and scale events as CSV.
+ * @param prefix Files are named <prefix>_busy.csv, <prefix>_queue.csv and <prefix>_scale.csv.
+ * @return True if all files were written.
+ */
+bool LogAnalyzer::writeCsv(const std::string& prefix) const {
+    std::ofstream busyFile((prefix + "_busy.csv").c_str());
+    std::ofstream queueFile((prefix + "_queue.csv").c_str());
+    std::ofstream scaleFile((prefix + "_scale.csv").c_str());
+    if (!busyFile.is_open() || !queueFile.is_open() || !scaleFile.is_open()) {
+        std::cerr << "Failed to open CSV files with prefix: " << prefix << std::endl;
+        return false;
+    }
+    busyFile << "server,start,end\n";
+    for (int k = 0; k < 256; ++k) {
+        for (const auto& b : busy[k]) {
+            busyFile << static_cast<char>(k) << ',' << b.start << ',' << b.end << '\n';
+        }
+        if (stillBusySince[k] >= 0) {
+            busyFile << static_cast<char>(k) << ',' << stillBusySince[k] << ",\n";
+        }
+    }
+    queueFile << "cycle,depth\n";
+    for (const auto& point : queueCurve) {
+        queueFile << point.first << ',' << point.second << '\n';
+    }
+    scaleFile << "cycle,server,event,queue_size\n";
+    for (const auto& e : scaleEvents) {
+        scaleFile << e.cycle << ',' << e.server << ',' << (e.allocated ? "allocated" : "deallocated")
+                  << ',' << e.queueSize << '\n';
+    }
+    return busyFile.good() && queueFile.good() && scaleFile.good();
+}
@@ -0,0 +1,167 @@
+/**
+ * @file loganalyzer.h
+ *
+ * This file contains the LogAnalyzer class, which rebuilds the history of a
+ * run from load_balancer_log.txt: per-server busy timelines, the queue-depth
+ * curve, autoscaling events and rejection counts.
+ *
+ * The log is memory-mapped and split into chunks on line boundaries. Every
+ * chunk is parsed on its own thread into a partial result that only knows
+ * about its own lines (a server may finish a request started in an earlier
+ * chunk, queue changes are relative); the partial results are then stitched
+ * together in log order. Servers may run several requests at once (stream
+ * slots), so a server is busy while it has at least one request in flight.
+ * Hedge copies count as dispatches; a copy that is cancelled or lost in a
+ * crash leaves the server when the balancer logs it. Logs of regional
+ * balancers (--balancers) also record requests moved between regions.
+ */
+
+#ifndef LOGANALYZER_H
+#define LOGANALYZER_H
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+ //all doxygen comments are generated with AI assistance
+
+/**
+ * @brief A period during which a server was processing a request.
+ */
+struct BusyInterval {
+    int64_t start;  ///< Cycle the request was handed to the server.
+    int64_t end;    ///< Cycle the server reported completion.
+};
+
+/**
+ * @brief A request starting (+1) or completing (-1) on a server.
+ */
+struct ServerEvent {
+    int64_t cycle;  ///< Cycle of the event.
+    int64_t delta;  ///< +1 for a dispatch, -1 for a completion.
+};
+
+/**
+ * @brief An autoscaling event logged by the LoadBalancer.
+ */
+struct ScaleEvent {
+    int64_t cycle;      ///< Cycle of the event.
+    char server;        ///< Server allocated or deallocated.
+    bool allocated;     ///< True for allocation, false for deallocation.
+    int64_t queueSize;  ///< Queue size reported with the event.
+};
+
+/**
+ * @brief Queue-size change accumulated over one cycle.
+ */
+struct QueueDelta {
+    int64_t cycle;   ///< Cycle the changes happened in.
+    int64_t delta;   ///< Arrivals minus dispatches minus rejections.
+};
+
+/**
+ * @brief What one chunk of the log contributed, before merging.
+ */
+struct ChunkResult {
+    /**
+     * @brief Per-server state of a chunk.
+     */
+    struct ServerPart {
+        std::vector<ServerEvent> events;  ///< Dispatches and completions in log order.
+        uint64_t dispatched = 0;          ///< Requests handed to the server.
+        uint64_t completed = 0;           ///< Requests the server completed.
+    };
+
+    uint64_t lines = 0;                   ///< Lines in the chunk.
+    uint64_t arrivals = 0;                ///< Initial and new requests.
+    uint64_t rejected = 0;                ///< Requests rejected by the blocklist.
+    int64_t firstCycle = -1;              ///< First cycle seen, -1 if none.
+    int64_t lastCycle = -1;               ///< Last cycle seen, -1 if none.
+    bool hasStartingQueue = false;        ///< Whether "Starting Queue Size" is in this chunk.
+    int64_t startingQueue = 0;            ///< The logged starting queue size.
+    int64_t deltaBeforeStartingQueue = 0; ///< Queue delta of the lines before it.
+    std::vector<QueueDelta> queue;        ///< Queue deltas by cycle, in log order.
+    std::vector<ScaleEvent> scaleEvents;  ///< Autoscaling events in log order.
+    std::unordered_map<uint32_t, uint64_t> rejectedBySubnet; ///< Rejections per /24 prefix.
+    uint64_t crashes = 0;                 ///< Server crashes.
+    uint64_t slowdowns = 0;               ///< Server slowdowns.
+    uint64_t hedges = 0;                  ///< Hedge copies dispatched.
+    uint64_t cancelled = 0;               ///< Copies cancelled because the other copy finished.
+    uint64_t lost = 0;                    ///< Requests lost to crashes.
+    uint64_t requeued = 0;                ///< Lost requests put back in the queue.
+    uint64_t movedOut = 0;                ///< Requests shed to or stolen by other balancers.
+    uint64_t movedIn = 0;                 ///< Requests received from other balancers.
+    ServerPart servers[256];              ///< Indexed by server name.
+};
+
+/**
+ * @class LogAnalyzer
+ * @brief Parallel analyzer for the simulator's text log.
+ */
+class LogAnalyzer {
+public:
+    /**
+     * @brief Maps and analyzes a log file.
+     * @param path Log file to read.
+     * @param threads Number of worker threads (0 means one per core).
+     * @return True on success, false if the file could not be mapped.
+     */
+    bool analyze(const std::string& path, int threads);
+
+    /**
+     * @brief Prints a summary of the merged results.
+     * @param out Stream to write to.
+     */
+    void report(std::ostream& out) const;
+
+    /**
+     * @brief Writes the busy timelines, queue curve and scale events as CSV.
+     * @param prefix Files are named <prefix>_busy.csv, <prefix>_queue.csv and <prefix>_scale.csv.
+     * @return True if all files were written.
+     */
+    bool writeCsv(const std::string& prefix) const;
+
+private:
+    /**
+     * @brief Parses the lines in [begin, end) into a partial result.
+     */
+    static void parseChunk(const char* begin, const char* end, ChunkResult& result);
+
+    /**
+     * @brief Stitches partial results together in log order.
+     */
+    void merge(std::vector<ChunkResult>& chunks);
+
+    std::string path;                          ///< Analyzed file.
+    uint64_t bytes = 0;                        ///< File size.
+    int chunkCount = 0;                        ///< Chunks parsed in parallel.
+    double seconds = 0.0;                      ///< Time spent mapping, parsing and merging.
+    uint64_t lines = 0;                        ///< Total lines.
+    uint64_t arrivals = 0;                     ///< Total arrivals.
+    uint64_t rejected = 0;                     ///< Total rejections.
+    int64_t firstCycle = -1;                   ///< First cycle in the log.
+    int64_t lastCycle = -1;                    ///< Last cycle in the log.
+    int64_t queueBase = 0;                     ///< Queue size before the first logged change.
+    std::vector<std::pair<int64_t, int64_t> > queueCurve; ///< (cycle, depth at end of cycle).
+    std::vector<ScaleEvent> scaleEvents;       ///< All autoscaling events.
+    std::unordered_map<uint32_t, uint64_t> rejectedBySubnet; ///< Rejections per /24 prefix.
+    uint64_t crashes = 0;                      ///< Server crashes.
+    uint64_t slowdowns = 0;                    ///< Server slowdowns.
+    uint64_t hedges = 0;                       ///< Hedge copies dispatched.
+    uint64_t cancelled = 0;                    ///< Copies cancelled because the other copy finished.
+    uint64_t lost = 0;                         ///< Requests lost to crashes.
+    uint64_t requeued = 0;                     ///< Lost requests put back in the queue.
+    uint64_t movedOut = 0;                     ///< Requests shed to or stolen by other balancers.
+    uint64_t movedIn = 0;                      ///< Requests received from other balancers.
+    std::vector<BusyInterval> busy[256];       ///< Busy timeline per server name.
+    uint64_t dispatched[256] = {};             ///< Requests handed to each server.
+    uint64_t completed[256] = {};              ///< Requests completed by each server.
+    int64_t stillBusySince[256];               ///< Start of the busy period open at the end of the log, -1 if idle.
+    int64_t inFlight[256] = {};                ///< Requests still in flight at the end of the log.
+    int64_t peakConcurrency[256] = {};         ///< Most requests in flight at once.
+    double concurrencyCycles[256] = {};        ///< Integral of requests in flight over time.
+};
+
+#endif
@@ -0,0 +1,300 @@
+#include "logevent.h"
+#include "ipv4.h"
+#include <cstring>
+#include <iostream>
+
+static_assert(sizeof(LogRecord) == 16, "LogRecord layout changed");
+static_assert(sizeof(EventLogHeader) == 64, "EventLogHeader layout changed");
+
+namespace {
+
+/**
+ * @brief Name and fields of every kind, indexed by LogEventKind.
+ */
+const char* const kKindSchema[] = {
+    "Text           ipIn=length, text follows padded to 16 bytes",
+    "Wide           ipIn=value of the next request event",
+    "InitialRequest cycle ipIn ipOut jobType value=processTime",
+    "NewRequest     cycle ipIn ipOut jobType value=processTime",
+    "Handling       cycle server ipIn ipOut jobType",
+    "HandlingNew    cycle server ipIn ipOut jobType",
+    "Completed      cycle server",
+    "Cancelled      cycle server",
+    "Hedging        cycle server ipIn ipOut jobType",
+    "LostCovered    cycle server ipIn ipOut",
+    "LostRequeued   cycle server ipIn ipOut value=retry",
+    "LostDropped    cycle server ipIn ipOut value=retries",
+    "Crashed        cycle server",
+    "SlowedDown     cycle server ipIn=factor",
+    "Recovered      cycle server",
+    "Ejected        cycle server ipIn=failedChecks",
+    "Readmitted     cycle server",
+    "Allocated      cycle server ipIn=queueSize",
+    "Deallocated    cycle server ipIn=queueSize",
+    "Rejected       ipIn",
+    "Shed           cycle ipIn ipOut value=balancer",
+    "Stolen         cycle ipIn ipOut value=balancer",
+    "Received       cycle ipIn ipOut value=balancer",
+};
+
+static_assert(sizeof(kKindSchema) / sizeof(kKindSchema[0]) == static_cast<size_t>(LogEventKind::Count),
+              "every LogEventKind needs a schema line");
+
+/**
+ * @brief Appends "Clock Cycle: C, ".
+ */
+void appendClock(std::string& out, uint32_t cycle) {
+    out += "Clock Cycle: ";
+    out += std::to_string(cycle);
+    out += ", ";
+}
+
+/**
+ * @brief Appends "Clock Cycle: C, Server X ".
+ */
+void appendServer(std::string& out, const LogRecord& rec) {
+    appendClock(out, rec.cycle);
+    out += "Server ";
+    out += static_cast<char>(rec.server);
+    out += ' ';
+}
+
+/**
+ * @brief Appends "a to b" (or "a -> b").
+ */
+void appendRoute(std::string& out, const LogRecord& rec, const char* separator) {
+    appendIpv4(out, rec.ipIn);
+    out += separator;
+    appendIpv4(out, rec.ipOut);
+}
+
+} // namespace
+
+/**
+ * @brief Checks whether a kind carries request addresses.
+ *
+ * @param kind The event kind.
+ * @return True for request events.
+ */
+bool isRequestEvent(LogEventKind kind) {
+    switch (kind) {
+    case LogEventKind::InitialRequest:
+    case LogEventKind::NewRequest:
+    case LogEventKind::Handling:
+    case LogEventKind::HandlingNew:
+    case LogEventKind::Hedging:
+    case LogEventKind::LostCovered:
+    case LogEventKind::LostRequeued:
+    case LogEventKind::LostDropped:
+    case LogEventKind::Shed:
+    case LogEventKind::Stolen:
+    case LogEventKind::Received:
+        return true;
+    default:
+        return false;
+    }
+}
+
+/**
+ * @brief Gets the schema text written after the header.
+ *
+ * @return One line per kind: id, name and fields.
+ */
+std::string eventLogSchema() {
+    std::string schema = "record 16: cycle:u32 ipIn:u32 ipOut:u32 kind:u8 server:u8 jobType:u8 value:u8\n";
+    for (size_t i = 0; i < static_cast<size_t>(LogEventKind::Count); ++i) {
+        schema += std::to_string(i);
+        schema += ' ';
+        schema += kKindSchema[i];
+        schema += '\n';
+    }
+    return schema;
+}
+
+/**
+ * @brief Appends the text log line of an event (without the newline).
+ *
+ * These are the exact lines the simulator has always written; Text and Wide
+ * records are handled by the caller.
+ *
+ * @param rec The event.
+ * @param value The event's value, already widened from a Wide record if there was one.
+ * @param out String to append to.
+ */
+void formatLogRecord(const LogRecord& rec, uint32_t value, std::string& out) {
+    const LogEventKind kind = static_cast<LogEventKind>(rec.kind);
+    switch (kind) {
+    case LogEventKind::InitialRequest:
+    case LogEventKind::NewRequest:
+        appendClock(out, rec.cycle);
+        out += kind == LogEventKind::InitialRequest ? "Initial Request: " : "New Request: ";
+        appendRoute(out, rec, " -> ");
+        out += ", Process Time: ";
+        out += std::to_string(value);
+        out += ", Job Type: ";
+        out += static_cast<char>(rec.jobType);
+        break;
+    case LogEventKind::Handling:
+    case LogEventKind::HandlingNew:
+    case LogEventKind::Hedging:
+        appendServer(out, rec);
+        out += kind == LogEventKind::Handling ? "handling request from "
+             : kind == LogEventKind::HandlingNew ? "handling new request from " : "hedging request from ";
+        appendRoute(out, rec, " to ");
+        out += ", Job Type: ";
+        out += static_cast<char>(rec.jobType);
+        break;
+    case LogEventKind::Completed:
+        appendServer(out, rec);
+        out += "completed request.";
+        break;
+    case LogEventKind::Cancelled:
+        appendServer(out, rec);
+        out += "cancelled request.";
+        break;
+    case LogEventKind::LostCovered:
+    case LogEventKind::LostRequeued:
+    case LogEventKind::LostDropped:
+        appendServer(out, rec);
+        out += "lost request from ";
+        appendRoute(out, rec, " to ");
+        if (kind == LogEventKind::LostCovered) {
+            out += ", covered by its hedge";
+        } else if (kind == LogEventKind::LostRequeued) {
+            out += ", requeued (retry " + std::to_string(value) + ")";
+        } else {
+            out += ", dropped after " + std::to_string(value) + " retries";
+        }
+        break;
+    case LogEventKind::Crashed:
+        appendServer(out, rec);
+        out += "crashed.";
+        break;
+    case LogEventKind::SlowedDown:
+        appendServer(out, rec);
+        out += "slowed down by a factor of " + std::to_string(value) + ".";
+        break;
+    case LogEventKind::Recovered:
+        appendServer(out, rec);
+        out += "recovered.";
+        break;
+    case LogEventKind::Ejected:
+        appendServer(out, rec);
+        out += "ejected after " + std::to_string(value) + " failed health checks.";
+        break;
+    case LogEventKind::Readmitted:
+        appendServer(out, rec);
+        out += "readmitted.";
+        break;
+    case LogEventKind::Allocated:
+    case LogEventKind::Deallocated:
+        out += "Cycle: " + std::to_string(rec.cycle) + ", Server ";
+        out += static_cast<char>(rec.server);
+        out += kind == LogEventKind::Allocated ? " allocated" : " deallocated";
+        out += ", Current Queue Size: " + std::to_string(value);
+        break;
+    case LogEventKind::Rejected:
+        out += "Rejected request from IP: ";
+        appendIpv4(out, rec.ipIn);
+        break;
+    case LogEventKind::Shed:
+    case LogEventKind::Stolen:
+        appendClock(out, rec.cycle);
+        out += kind == LogEventKind::Shed ? "Shed request from " : "Stolen request from ";
+        appendRoute(out, rec, " to ");
+        out += ", moved to balancer " + std::to_string(value);
+        break;
+    case LogEventKind::Received:
+        appendClock(out, rec.cycle);
+        out += "Received request from ";
+        appendRoute(out, rec, " to ");
+        out += ", moved from balancer " + std::to_string(value);
+        break;
+    default:
+        break;
+    }
+}
+
+/**
+ * @brief Decodes a binary event log into the text log of the same run.
+ *
+ * Lines are built in a reused buffer and written in large chunks, so decoding
+ * runs at close to the speed of the output device.
+ *
+ * @param data The whole file.
+ * @param size File size in bytes.
+ * @param out Stream the text lines are written to.
+ * @return True on success, false if the file is not a valid event log.
+ */
+bool decodeEventLog(const char* data, size_t size, std::ostream& out) {
+    EventLogHeader header;
+    if (size < sizeof(header)) {
+        std::cerr << "Not an event log: file is too short" << std::endl;
+        return false;
+    }
+    std::memcpy(&header, data, sizeof(header));
+    if (std::memcmp(header.magic, kEventLogMagic, sizeof(header.magic)) != 0) {
+        std::cerr << "Not an event log: bad signature" << std::endl;
+        return false;
+    }
+    if (header.version != kEventLogVersion || header.recordSize != sizeof(LogRecord)) {
+        std::cerr << "Unsupported event log version " << header.version << " (record size "
+                  << header.recordSize << ")" << std::endl;
+        return false;
+    }
+    if (header.kindCount > static_cast<uint32_t>(LogEventKind::Count)) {
+        std::cerr << "Event log has " << header.kindCount << " event kinds, this decoder knows "
+                  << static_cast<unsigned>(LogEventKind::Count) << std::endl;
+        return false;
+    }
+    const size_t schemaPadded = (static_cast<size_t>(header.schemaBytes) + 15) / 16 * 16;
+    if (schemaPadded > size - sizeof(header)) {
+        std::cerr << "Truncated event log schema" << std::endl;
+        return false;
+    }
+
+    size_t pos = sizeof(header) + schemaPadded;
+    std::string buffer;
+    buffer.reserve(1 << 17);
+    uint32_t wide = 0;
+    bool haveWide = false;
+    while (pos + sizeof(LogRecord) <= size) {
+        LogRecord rec;
+        std::memcpy(&rec, data + pos, sizeof(rec));
+        pos += sizeof(rec);
+        const LogEventKind kind = static_cast<LogEventKind>(rec.kind);
+        if (kind == LogEventKind::Wide) {
+            wide = rec.ipIn;
+            haveWide = true;
+            continue;
+        }
+        if (kind == LogEventKind::Text) {
+            const size_t padded = (static_cast<size_t>(rec.ipIn) + 15) / 16 * 16;
+            if (padded > size - pos) {
+                std::cerr << "Truncated text record at offset " << pos - sizeof(rec) << std::endl;
+                return false;
+            }
+            buffer.append(data + pos, rec.ipIn);
+            pos += padded;
+        } else if (rec.kind >= header.kindCount) {
+            std::cerr << "Unknown event kind " << static_cast<unsigned>(rec.kind) << " at offset "
+                      << pos - sizeof(rec) << std::endl;
+            return false;
+        } else {
+            const uint32_t value = !isRequestEvent(kind) ? rec.ipIn : haveWide ? wide : rec.value;
+            formatLogRecord(rec, value, buffer);
+        }
+        haveWide = false;
+        buffer += '\n';
+        if (buffer.size() >= (1 << 16)) {
+            out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+            buffer.clear();
+        }
+    }
+    out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    if (pos != size) {
+        std::cerr << "Event log ends with a partial record" << std::endl;
+        return false;
+    }
+    return static_cast<bool>(out);
+}
@@ -0,0 +1,133 @@
+/**
+ * @file logevent.h
+ *
+ * This file contains the typed simulation events written by LogManager and
+ * the binary event-log format, together with the one formatter that turns
+ * an event into its text log line. The text log and the offline decoder both
+ * use that formatter, so a decoded binary log is byte-identical to the text
+ * log of the same run.
+ *
+ * Binary event-log layout (host byte order):
+ *
+ *     0   EventLogHeader  (64 bytes, see below)
+ *     64  schema text     (schemaBytes, padded with zeros to a multiple of 16)
+ *         LogRecord...    (16 bytes each, written in 64 KB blocks)
+ *
+ * LogRecord (16 bytes):
+ *
+ *     0   uint32  cycle    clock cycle
+ *     4   uint32  ipIn     source address, or the event's value (see below)
+ *     8   uint32  ipOut    destination address
+ *     12  uint8   kind     LogEventKind
+ *     13  uint8   server   server name, 0 if none
+ *     14  uint8   jobType  'P', 'S', or 0 if none
+ *     15  uint8   value    small value of a request event
+ *
+ * Request events (those with addresses) keep their value (process time,
+ * retry count or balancer) in the last byte; a larger value is carried by a
+ * Wide record written just before the event. Other events keep their value
+ * (queue size, slowdown factor, failed checks) in ipIn. Free text lines are a
+ * Text record whose ipIn holds the length, followed by the text padded to a
+ * multiple of 16 bytes. The schema text lists every kind with its fields so
+ * the file can be read without this header.
+ */
+
+#ifndef LOGEVENT_H
+#define LOGEVENT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+ //all doxygen comments are generated with AI assistance
+
+/**
+ * @brief Kinds of logged events; the values are part of the file format.
+ */
+enum class LogEventKind : uint8_t {
+    Text = 0,         ///< Free text line (headers, summaries).
+    Wide = 1,         ///< Carries a 32-bit value for the next request event.
+    InitialRequest,   ///< Request queued before the first cycle.
+    NewRequest,       ///< Request arrived.
+    Handling,         ///< Request dispatched to a server.
+    HandlingNew,      ///< Request dispatched to a server that just completed one.
+    Completed,        ///< Server completed a request.
+    Cancelled,        ///< Server cancelled the losing copy of a hedged request.
+    Hedging,          ///< Hedge copy dispatched to a server.
+    LostCovered,      ///< Request lost in a crash, its hedge is still running.
+    LostRequeued,     ///< Request lost in a crash and requeued (value: retry).
+    LostDropped,      ///< Request lost in a crash and dropped (value: retries).
+    Crashed,          ///< Server crashed.
+    SlowedDown,       ///< Server slowed down (value: factor).
+    Recovered,        ///< Server recovered.
+    Ejected,          ///< Server ejected (value: failed checks).
+    Readmitted,       ///< Server readmitted.
+    Allocated,        ///< Autoscaler added a server (value: queue size).
+    Deallocated,      ///< Autoscaler removed a server (value: queue size).
+    Rejected,         ///< Request from a blocked address.
+    Shed,             ///< Request shed to another balancer (value: balancer).
+    Stolen,           ///< Request stolen by another balancer (value: balancer).
+    Received,         ///< Request received from another balancer (value: balancer).
+    Count             ///< Number of kinds.
+};
+
+/**
+ * @brief One event as stored in a binary event log.
+ */
+struct LogRecord {
+    uint32_t cycle;    ///< Clock cycle.
+    uint32_t ipIn;     ///< Source address, the value of a non-request event, or a text length.
+    uint32_t ipOut;    ///< Destination address.
+    uint8_t kind;      ///< LogEventKind.
+    uint8_t server;    ///< Server name, 0 if none.
+    uint8_t jobType;   ///< Job type, 0 if none.
+    uint8_t value;     ///< Small value of a request event.
+};
+
+/**
+ * @brief Header at the start of a binary event log.
+ */
+struct EventLogHeader {
+    char magic[8];         ///< kEventLogMagic.
+    uint32_t version;      ///< kEventLogVersion.
+    uint32_t recordSize;   ///< sizeof(LogRecord).
+    uint32_t kindCount;    ///< Number of event kinds the writer knew.
+    uint32_t schemaBytes;  ///< Length of the schema text after the header.
+    uint8_t reserved[40];  ///< Zero.
+};
+
+const char kEventLogMagic[8] = {'L', 'B', 'E', 'V', 'L', 'O', 'G', '\0'}; ///< File signature.
+const uint32_t kEventLogVersion = 1; ///< Bump when the layout changes.
+
+/**
+ * @brief Checks whether a kind carries request addresses.
+ * @param kind The event kind.
+ * @return True for request events.
+ */
+bool isRequestEvent(LogEventKind kind);
+
+/**
+ * @brief Gets the schema text written after the header.
+ * @return One line per kind: id, name and fields.
+ */
+std::string eventLogSchema();
+
+/**
+ * @brief Appends the text log line of an event (without the newline).
+ * @param rec The event.
+ * @param value The event's value, already widened from a Wide record if there was one.
+ * @param out String to append to.
+ */
+void formatLogRecord(const LogRecord& rec, uint32_t value, std::string& out);
+
+/**
+ * @brief Decodes a binary event log into the text log of the same run.
+ * @param data The whole file.
+ * @param size File size in bytes.
+ * @param out Stream the text lines are written to.
+ * @return True on success, false if the file is not a valid event log.
+ */
+bool decodeEventLog(const char* data, size_t size, std::ostream& out);
+
+#endif
@@ -1,23 +1,215 @@
 // logmanager.cpp
 #include "logmanager.h"
+#include "profiler.h"
+#include <cstring>
 #include <iostream>
 
-LogManager::LogManager(const std::string& filename) {
-    logFile.open(filename);
+LogManager::LogManager(const std::string& filename, LogFormat format)
+    : format(format) {
+    if (format == LogFormat::Binary) {
+        logFile.open(filename, std::ios::binary);
+    } else {
+        logFile.open(filename);
+    }
     if (!logFile.is_open()) {
         std::cerr << "Failed to open log file: " << filename << std::endl;
+        return;
+    }
+    if (format == LogFormat::Binary) {
+        block = new char[kBlockSize];
+        const std::string schema = eventLogSchema();
+        EventLogHeader header;
+        std::memset(&header, 0, sizeof(header));
+        std::memcpy(header.magic, kEventLogMagic, sizeof(header.magic));
+        header.version = kEventLogVersion;
+        header.recordSize = sizeof(LogRecord);
+        header.kindCount = static_cast<uint32_t>(LogEventKind::Count);
+        header.schemaBytes = static_cast<uint32_t>(schema.size());
+        append(&header, sizeof(header));
+        append(schema.data(), schema.size());
+        static const char zeros[16] = {};
+        append(zeros, (16 - schema.size() % 16) % 16);
     }
 }
 
 LogManager::~LogManager() {
     if (logFile.is_open()) {
+        flushBlock();
         logFile.close();
     }
+    delete[] block;
 }
 
 void LogManager::log(const std::string& message) {
-    if (logFile.is_open()) {
+    PROFILE_ZONE("logging");
+    if (!logFile.is_open()) {
+        return;
+    }
+    if (format == LogFormat::Text) {
         logFile << message << std::endl;
+        return;
+    }
+    LogRecord rec;
+    std::memset(&rec, 0, sizeof(rec));
+    rec.kind = static_cast<uint8_t>(LogEventKind::Text);
+    rec.ipIn = static_cast<uint32_t>(message.size());
+    append(&rec, sizeof(rec));
+    append(message.data(), message.size());
+    static const char zeros[16] = {};
+    append(zeros, (16 - message.size() % 16) % 16);
+}
+
+/**
+ * @brief Logs an event without request addresses.
+ *
+ * @param kind The event kind.
+ * @param cycle Clock cycle.
+ * @param server Server name, 0 if none.
+ * @param value Queue size, slowdown factor, failed checks or rejected address.
+ */
+void LogManager::event(LogEventKind kind, int cycle, char server, uint32_t value) {
+    write(record(kind, cycle, server, value), value);
+}
+
+/**
+ * @brief Logs an event about a request.
+ *
+ * @param kind The event kind.
+ * @param cycle Clock cycle.
+ * @param server Server name, 0 if none.
+ * @param r The request.
+ * @param value Process time, retry count or balancer.
+ */
+void LogManager::event(LogEventKind kind, int cycle, char server, const Request& r, uint32_t value) {
+    write(record(kind, cycle, server, r, value), value);
+}
+
+/**
+ * @brief Logs a batch of events built with record().
+ *
+ * @param records The events, in log order.
+ * @param count Number of events.
+ */
+void LogManager::events(const LogRecord* records, size_t count) {
+    if (format == LogFormat::Binary) {
+        PROFILE_ZONE("logging");
+        if (logFile.is_open()) {
+            append(records, count * sizeof(LogRecord));
+        }
+        return;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        const LogRecord& rec = records[i];
+        write(rec, isRequestEvent(static_cast<LogEventKind>(rec.kind)) ? rec.value : rec.ipIn);
+    }
+}
+
+/**
+ * @brief Builds the record of an event without request addresses.
+ *
+ * @param kind The event kind.
+ * @param cycle Clock cycle.
+ * @param server Server name, 0 if none.
+ * @param value Queue size, slowdown factor, failed checks or rejected address.
+ * @return The record.
+ */
+LogRecord LogManager::record(LogEventKind kind, int cycle, char server, uint32_t value) {
+    LogRecord rec;
+    rec.cycle = static_cast<uint32_t>(cycle);
+    rec.ipIn = value;
+    rec.ipOut = 0;
+    rec.kind = static_cast<uint8_t>(kind);
+    rec.server = static_cast<uint8_t>(server);
+    rec.jobType = 0;
+    rec.value = 0;
+    return rec;
+}
+
+/**
+ * @brief Builds the record of an event about a request.
+ *
+ * @param kind The event kind.
+ * @param cycle Clock cycle.
+ * @param server Server name, 0 if none.
+ * @param r The request.
+ * @param value Process time, retry count or balancer (only the low byte is stored).
+ * @return The record.
+ */
+LogRecord LogManager::record(LogEventKind kind, int cycle, char server, const Request& r, uint32_t value) {
+    LogRecord rec;
+    rec.cycle = static_cast<uint32_t>(cycle);
+    rec.ipIn = r.getIpInAddr();
+    rec.ipOut = r.getIpOutAddr();
+    rec.kind = static_cast<uint8_t>(kind);
+    rec.server = static_cast<uint8_t>(server);
+    rec.jobType = static_cast<uint8_t>(r.getJobType());
+    rec.value = static_cast<uint8_t>(value);
+    return rec;
+}
+
+/**
+ * @brief Formats or buffers one record.
+ *
+ * In binary mode this is a copy into the block buffer; a request event whose
+ * value does not fit in a byte is preceded by a Wide record carrying it.
+ *
+ * @param rec The record.
+ * @param value The full value of the event.
+ */
+void LogManager::write(const LogRecord& rec, uint32_t value) {
+    PROFILE_ZONE("logging");
+    if (!logFile.is_open()) {
+        return;
+    }
+    if (format == LogFormat::Text) {
+        line.clear();
+        formatLogRecord(rec, value, line);
+        logFile << line << std::endl;
+        return;
+    }
+    if (value > 0xFF && isRequestEvent(static_cast<LogEventKind>(rec.kind))) {
+        LogRecord wide;
+        std::memset(&wide, 0, sizeof(wide));
+        wide.kind = static_cast<uint8_t>(LogEventKind::Wide);
+        wide.ipIn = value;
+        append(&wide, sizeof(wide));
     }
+    append(&rec, sizeof(rec));
 }
 
+/**
+ * @brief Copies bytes into the block buffer, flushing it first if they do not fit.
+ *
+ * @param data The bytes.
+ * @param size Number of bytes.
+ */
+void LogManager::append(const void* data, size_t size) {
+    if (blockUsed + size > kBlockSize) {
+        flushBlock();
+        if (size > kBlockSize) {
+            logFile.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+            return;
+        }
+    }
+    std::memcpy(block + blockUsed, data, size);
+    blockUsed += size;
+}
+
+/**
+ * @brief Gets the bytes of the buffers the LogManager owns.
+ *
+ * @return The binary block buffer plus the reused text line (the stream's own buffer is not counted).
+ */
+size_t LogManager::getMemoryBytes() const {
+    return (block != nullptr ? kBlockSize : 0) + line.capacity();
+}
+
+/**
+ * @brief Writes the block buffer to the file.
+ */
+void LogManager::flushBlock() {
+    if (blockUsed > 0) {
+        logFile.write(block, static_cast<std::streamsize>(blockUsed));
+        blockUsed = 0;
+    }
+}
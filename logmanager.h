@@ -2,19 +2,111 @@
 #ifndef LOGMANAGER_H
 #define LOGMANAGER_H
 
+#include "logevent.h"
+#include "request.h"
+#include <cstdint>
 #include <fstream>
 #include <string>
 
+/**
+ * @brief How a LogManager writes its file.
+ */
+enum class LogFormat {
+    Text,   ///< One formatted line per event.
+    Binary  ///< Fixed-size LogRecords in 64 KB blocks, decoded offline by log_decoder.
+};
 
 class LogManager {
 public:
-    LogManager(const std::string& filename);
+    LogManager(const std::string& filename, LogFormat format = LogFormat::Text);
     ~LogManager();
 
+    LogManager(const LogManager&) = delete;
+    LogManager& operator=(const LogManager&) = delete;
+
     void log(const std::string& message);
 
+    /**
+     * @brief Logs an event without request addresses.
+     * @param kind The event kind.
+     * @param cycle Clock cycle.
+     * @param server Server name, 0 if none.
+     * @param value Queue size, slowdown factor, failed checks or rejected address.
+     */
+    void event(LogEventKind kind, int cycle, char server, uint32_t value = 0);
+
+    /**
+     * @brief Logs an event about a request.
+     * @param kind The event kind.
+     * @param cycle Clock cycle.
+     * @param server Server name, 0 if none.
+     * @param r The request.
+     * @param value Process time, retry count or balancer.
+     */
+    void event(LogEventKind kind, int cycle, char server, const Request& r, uint32_t value = 0);
+
+    /**
+     * @brief Logs a batch of events built with record().
+     *
+     * In binary mode the whole batch is one copy into the block buffer.
+     * Request events carry their value in the record's value byte, so it
+     * must be below 256 (larger values need event()).
+     *
+     * @param records The events, in log order.
+     * @param count Number of events.
+     */
+    void events(const LogRecord* records, size_t count);
+
+    /**
+     * @brief Builds the record of an event without request addresses.
+     * @param kind The event kind.
+     * @param cycle Clock cycle.
+     * @param server Server name, 0 if none.
+     * @param value Queue size, slowdown factor, failed checks or rejected address.
+     * @return The record.
+     */
+    static LogRecord record(LogEventKind kind, int cycle, char server, uint32_t value = 0);
+
+    /**
+     * @brief Builds the record of an event about a request.
+     * @param kind The event kind.
+     * @param cycle Clock cycle.
+     * @param server Server name, 0 if none.
+     * @param r The request.
+     * @param value Process time, retry count or balancer (only the low byte is stored).
+     * @return The record.
+     */
+    static LogRecord record(LogEventKind kind, int cycle, char server, const Request& r, uint32_t value = 0);
+
+    /**
+     * @brief Gets the bytes of the buffers the LogManager owns.
+     * @return The binary block buffer plus the reused text line (the stream's own buffer is not counted).
+     */
+    size_t getMemoryBytes() const;
+
 private:
+    /**
+     * @brief Formats or buffers one record.
+     */
+    void write(const LogRecord& rec, uint32_t value);
+
+    /**
+     * @brief Copies bytes into the block buffer, flushing it first if they do not fit.
+     */
+    void append(const void* data, size_t size);
+
+    /**
+     * @brief Writes the block buffer to the file.
+     */
+    void flushBlock();
+
+    static const size_t kBlockSize = 64 * 1024; ///< Binary block size.
+
     std::ofstream logFile;
+    LogFormat format;
+    std::string line;          ///< Reused text line.
+    char* block = nullptr;     ///< Binary block buffer.
+    size_t blockUsed = 0;      ///< Bytes in the block buffer.
 };
 
-#endif
\ No newline at end of file
+#endif
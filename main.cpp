@@ -5,8 +5,18 @@
 #include "loadbalancer.h"
 #include "webserver.h"
 #include "logmanager.h"
+#include "ingestring.h"
+#include "ipv4.h"
+#include "snapshot.h"
+#include "profiler.h"
+#include "faultinjector.h"
+#include "fronttier.h"
+#include "pipeline.h"
+#include "memoryaccount.h"
 #include <sstream>
 #include <iomanip>
+#include <climits>
+#include <algorithm>
 
  //all doxygen comments are generated with AI assistance
 
@@ -14,20 +24,19 @@
 /**
  * @brief Generates a random IP address.
  * 
- * This function generates a random IP address in the format of
- * x.x.x.x where x is a number between 0 and 255.
+ * This function generates a random IP address x.x.x.x where every x is
+ * a number between 0 and 255, drawn as one 32-bit value.
  * 
- * @return A string representing a randomly generated IP address.
+ * @param gen The simulation's random number generator.
+ * @return The address in host byte order.
  */
 
-std::string generateRandomIP() {
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_int_distribution<> dis(0, 255);
-    return std::to_string(dis(gen)) + "." + std::to_string(dis(gen)) + "." +
-           std::to_string(dis(gen)) + "." + std::to_string(dis(gen));
+uint32_t generateRandomIP(std::mt19937& gen) {
+    return static_cast<uint32_t>(gen());
 }
 
+const int kIngestBatchesPerCycle = 16; ///< Ingest batches of 256 records drained per clock cycle at most
+
 /**
  * @brief Main function for the load balancer simulation.
  * 
@@ -36,50 +45,263 @@ std::string generateRandomIP() {
  * and runs the simulation for the specified clock cycles.
  * It logs the status of the load balancer, servers, and requests
  * during the simulation.
+ *
+ * With --ingest NAME the simulation additionally drains requests that
+ * external processes push into a shared-memory IngestConsumer ring.
+ * All randomness comes from one generator seeded with --seed; --snapshot-at
+ * checkpoints the whole simulation at a given cycle and --restore resumes
+ * from such a checkpoint (optionally reseeded to branch a new experiment).
+ * In a profiling build (make PROFILE=1) each phase of the cycle is timed and
+ * a per-phase report is printed at the end; --profile-trace also writes a
+ * Chrome trace-event file. --stream-slots K lets every server stream up to
+ * K S requests at once under processor sharing. --crash-rate and --slow-rate
+ * inject faults; --health-check, --retry-budget and --hedge-after set how the
+ * LoadBalancer reacts, and the final status then reports latency, retries and
+ * the cost and benefit of hedging. --balancers N instead runs N regional
+ * LoadBalancers, each on its own thread with its own fleet and log, behind
+ * a FrontTier that routes arrivals and sheds or steals work between them.
+ * --queue-memory N keeps at most N queued requests in memory and spills the
+ * rest to segment files in --spill-dir, so long overload runs use fixed memory.
+ * --binary-log writes compact fixed-size event records to load_balancer_log.bin
+ * instead of text; log_decoder turns such a file back into the text log.
+ * The final status ends with a memory report: heap totals and the bytes held
+ * by the queue, the fleet, the bookkeeping, the blocklist and the log.
+ * --pipeline SPEC instead runs requests through stages served by separate
+ * pools (e.g. auth -> compute -> stream) and reports per-stage queueing, the
+ * end-to-end latency and the stage that limits throughput.
  * 
+ * @param argc Number of command-line arguments.
+ * @param argv Command-line arguments.
  * @return int Status code of the program (0 for success).
  */
 
-int main() {
-    int numServers, runTime;
-    std::cout << "Enter the number of initial servers: ";
-    std::cin >> numServers;
+int main(int argc, char* argv[]) {
+    std::string ingestName;          ///< Shared-memory ring name, empty if ingest is disabled
+    size_t ingestCapacity = 1 << 16; ///< Slots in the ingest ring
+    unsigned seed = std::random_device()(); ///< Seed of the simulation's random number generator
+    bool seedGiven = false;          ///< Whether --seed was passed
+    int snapshotAt = -1;             ///< Cycle to checkpoint at, -1 for never
+    std::string snapshotFile = "load_balancer.snap"; ///< Where --snapshot-at writes
+    std::string restoreFile;         ///< Snapshot to resume from, empty to start fresh
+    std::string traceFile;           ///< Chrome trace output, empty to skip
+    std::string blocklistFile;       ///< CIDR blocklist replacing the built-in ranges
+    int streamSlots = 0;             ///< Concurrent S streams per server, 0 for one request at a time
+    FaultConfig faults;              ///< Crash and slowdown model, off by default
+    ResilienceConfig resilience;     ///< Health checks, retries and hedging, off by default
+    TierConfig tier;                 ///< Multi-balancer topology, off by default
+    size_t queueMemory = 0;          ///< Queued requests kept in memory, 0 for no limit
+    std::string spillDir = "/tmp";   ///< Where the rest of the queue is spilled
+    bool binaryLog = false;          ///< Write a binary event log instead of text
+    uint64_t malformedIngest = 0;    ///< Ingest records dropped by isValidIngestRecord()
+    PipelineConfig pipeline;         ///< Stage pipeline, off when it has no stages
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--ingest" && i + 1 < argc) {
+            ingestName = argv[++i];
+        } else if (arg == "--ingest-capacity" && i + 1 < argc) {
+            ingestCapacity = static_cast<size_t>(std::atol(argv[++i]));
+        } else if (arg == "--seed" && i + 1 < argc) {
+            seed = static_cast<unsigned>(std::atol(argv[++i]));
+            seedGiven = true;
+        } else if (arg == "--snapshot-at" && i + 1 < argc) {
+            snapshotAt = std::atoi(argv[++i]);
+        } else if (arg == "--snapshot-file" && i + 1 < argc) {
+            snapshotFile = argv[++i];
+        } else if (arg == "--restore" && i + 1 < argc) {
+            restoreFile = argv[++i];
+        } else if (arg == "--profile-trace" && i + 1 < argc) {
+            traceFile = argv[++i];
+        } else if (arg == "--blocklist" && i + 1 < argc) {
+            blocklistFile = argv[++i];
+        } else if (arg == "--stream-slots" && i + 1 < argc) {
+            streamSlots = std::max(0, std::atoi(argv[++i]));
+        } else if (arg == "--crash-rate" && i + 1 < argc) {
+            faults.crashRate = std::atof(argv[++i]);
+        } else if (arg == "--slow-rate" && i + 1 < argc) {
+            faults.slowRate = std::atof(argv[++i]);
+        } else if (arg == "--slow-factor" && i + 1 < argc) {
+            faults.slowFactor = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--recovery-time" && i + 1 < argc) {
+            faults.recoveryTime = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--health-check" && i + 1 < argc) {
+            resilience.healthCheckInterval = std::max(0, std::atoi(argv[++i]));
+        } else if (arg == "--eject-after" && i + 1 < argc) {
+            resilience.ejectAfter = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--retry-budget" && i + 1 < argc) {
+            resilience.retryBudget = std::max(0, std::atoi(argv[++i]));
+        } else if (arg == "--hedge-after" && i + 1 < argc) {
+            resilience.hedgeAfter = std::max(0, std::atoi(argv[++i]));
+        } else if (arg == "--queue-memory" && i + 1 < argc) {
+            queueMemory = static_cast<size_t>(std::max(0L, std::atol(argv[++i])));
+        } else if (arg == "--spill-dir" && i + 1 < argc) {
+            spillDir = argv[++i];
+        } else if (arg == "--binary-log") {
+            binaryLog = true;
+        } else if (arg == "--balancers" && i + 1 < argc) {
+            tier.balancers = std::max(0, std::atoi(argv[++i]));
+        } else if (arg == "--routing" && i + 1 < argc) {
+            if (!parseRoutingPolicy(argv[++i], tier.routing)) {
+                std::cerr << "Unknown routing policy: " << argv[i] << std::endl;
+                return 1;
+            }
+        } else if (arg == "--tier-balance" && i + 1 < argc) {
+            if (!parseTierBalancing(argv[++i], tier.balancing)) {
+                std::cerr << "Unknown balancing mode: " << argv[i] << std::endl;
+                return 1;
+            }
+        } else if (arg == "--shed-above" && i + 1 < argc) {
+            tier.shedAbove = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--transfer-delay" && i + 1 < argc) {
+            tier.transferDelay = std::max(0, std::atoi(argv[++i]));
+        } else if (arg == "--arrival-rate" && i + 1 < argc) {
+            tier.arrivalRate = std::max(0.0, std::atof(argv[++i]));
+        } else if (arg == "--pipeline" && i + 1 < argc) {
+            if (!parsePipeline(argv[++i], pipeline)) {
+                return 1;
+            }
+        } else {
+            std::cerr << "Usage: load_balancer [--ingest NAME] [--ingest-capacity SLOTS] [--seed N]\n"
+                      << "                     [--snapshot-at CYCLE] [--snapshot-file PATH] [--restore PATH]\n"
+                      << "                     [--profile-trace PATH] [--blocklist PATH] [--stream-slots K]\n"
+                      << "                     [--crash-rate P] [--slow-rate P] [--slow-factor F] [--recovery-time CYCLES]\n"
+                      << "                     [--health-check CYCLES] [--eject-after N] [--retry-budget N] [--hedge-after CYCLES]\n"
+                      << "                     [--balancers N] [--routing round-robin|least-queue|source-hash]\n"
+                      << "                     [--tier-balance none|shed|steal] [--shed-above N] [--transfer-delay CYCLES]\n"
+                      << "                     [--arrival-rate R] [--queue-memory REQUESTS] [--spill-dir PATH]\n"
+                      << "                     [--binary-log] [--pipeline NAME:SERVERS:MIN-MAX[:JOBTYPES],...]" << std::endl;
+            return 1;
+        }
+    }
+
+    if (!traceFile.empty()) {
+        if (!Profiler::enabled()) {
+            std::cerr << "--profile-trace needs a profiling build (make PROFILE=1)" << std::endl;
+            return 1;
+        }
+        Profiler::enableTrace(4000000);
+    }
+
+    if (tier.balancers > 0 && (!ingestName.empty() || snapshotAt >= 0 || !restoreFile.empty())) {
+        std::cerr << "--balancers cannot be combined with --ingest, --snapshot-at or --restore" << std::endl;
+        return 1;
+    }
+
+    if (!pipeline.stages.empty() && (tier.balancers > 0 || !ingestName.empty() || snapshotAt >= 0 || !restoreFile.empty())) {
+        std::cerr << "--pipeline cannot be combined with --balancers, --ingest, --snapshot-at or --restore" << std::endl;
+        return 1;
+    }
+
+    IngestConsumer ingest; ///< Ring external producers push requests into
+    if (!ingestName.empty() && !ingest.create(ingestName, ingestCapacity)) {
+        return 1;
+    }
+
+    int numServers = 0, runTime;
+    if (restoreFile.empty() && pipeline.stages.empty()) {
+        std::cout << "Enter the number of initial servers: ";
+        std::cin >> numServers;
+    }
     std::cout << "Enter the time to run the load balancer (in clock cycles): ";
     std::cin >> runTime;
 
-    LogManager logger("load_balancer_log.txt"); ///< Logger instance for recording simulation events
+    LogManager logger(binaryLog ? "load_balancer_log.bin" : "load_balancer_log.txt",
+                      binaryLog ? LogFormat::Binary : LogFormat::Text); ///< Logger instance for recording simulation events
+
+    if (!pipeline.stages.empty()) {
+        if (tier.arrivalRate >= 0) {
+            pipeline.arrivalRate = tier.arrivalRate;
+        }
+        Pipeline stagePipeline(pipeline, logger, seed);
+        stagePipeline.run(runTime);
+        std::string report = stagePipeline.describe() + "\nMemory:";
+        const std::string heap = describeHeapUsage();
+        if (!heap.empty()) {
+            report += "\n" + heap;
+        }
+        logger.log(report + "\n" + stagePipeline.describeMemory());
+        if (Profiler::enabled()) {
+            Profiler::report(std::cout);
+            if (!traceFile.empty() && !Profiler::writeTrace(traceFile)) {
+                std::cerr << "Failed to write trace file: " << traceFile << std::endl;
+            }
+        }
+        return 0;
+    }
+
+    if (tier.balancers > 0) {
+        tier.serversPerBalancer = numServers;
+        tier.streamSlots = streamSlots;
+        tier.blocklistFile = blocklistFile;
+        tier.faults = faults;
+        tier.resilience = resilience;
+        tier.queueMemory = queueMemory;
+        tier.spillDir = spillDir;
+        tier.binaryLog = binaryLog;
+        FrontTier frontTier(tier, logger, seed);
+        if (!frontTier.start()) {
+            return 1;
+        }
+        frontTier.run(runTime);
+        logger.log(frontTier.describe());
+        if (Profiler::enabled()) {
+            Profiler::report(std::cout);
+            if (!traceFile.empty() && !Profiler::writeTrace(traceFile)) {
+                std::cerr << "Failed to write trace file: " << traceFile << std::endl;
+            }
+        }
+        return 0;
+    }
+
     LoadBalancer loadBalancer(logger);           ///< LoadBalancer instance to manage request handling
     std::vector<WebServer> servers;               ///< Vector to hold the web servers
+    std::mt19937 rng(seed);                       ///< Single source of randomness, checkpointed with the state
+    if (!blocklistFile.empty() && !loadBalancer.loadBlockedIpRanges(blocklistFile)) {
+        return 1;
+    }
+    SimulationStats stats = {INT_MAX, INT_MIN};   ///< Process time range seen so far
+    FaultInjector faultInjector(faults, logger);  ///< Crashes and slows servers down
+    loadBalancer.setResilience(resilience);
+    loadBalancer.setQueueSpill(queueMemory, spillDir);
 
     logger.log("");
     logger.log("-------------------Simulation Starts-----------------------------");
     logger.log("");
 
-    for (int i = 0; i < numServers; ++i) {
-        servers.emplace_back(static_cast<char>('A' + i));
-    }
+    if (!restoreFile.empty()) {
+        if (!Snapshot::restore(restoreFile, loadBalancer, servers, rng, stats, faultInjector)) {
+            return 1;
+        }
+        if (seedGiven) {
+            rng.seed(seed); // branch: same warmed-up state, different future
+        }
+        loadBalancer.trackInFlight(servers);
+        logger.log("Snapshot restored from " + restoreFile + ", Clock Cycle: " + std::to_string(loadBalancer.getTime()));
+    } else {
+        for (int i = 0; i < numServers; ++i) {
+            servers.emplace_back(static_cast<char>('A' + i));
+            servers.back().setStreamSlots(streamSlots);
+        }
+
+        int initialRequests = numServers * 100;
 
-    int initialRequests = numServers * 100;
-    int startingQueueSize = 0; 
-    int minProcessTime = INT_MAX; 
-    int maxProcessTime = INT_MIN; 
+        for (int i = 0; i < initialRequests; ++i) {
+            uint32_t ipIn = generateRandomIP(rng);
+            uint32_t ipOut = generateRandomIP(rng);
+            int processTime = static_cast<int>(rng() % 50) + 1; // 1 to 50 clock cycles
+            char jobType = (rng() % 2 == 0) ? 'P' : 'S';
 
-    for (int i = 0; i < initialRequests; ++i) {
-        std::string ipIn = generateRandomIP();
-        std::string ipOut = generateRandomIP();
-        int processTime = std::rand() % 50 + 1; // 1 to 50 clock cycles
-        char jobType = (std::rand() % 2 == 0) ? 'P' : 'S';
-        
-        minProcessTime = std::min(minProcessTime, processTime);
-        maxProcessTime = std::max(maxProcessTime, processTime);
-        
-        Request req(ipIn, ipOut, processTime, jobType, loadBalancer.getTime());
-        loadBalancer.addRequest(req);
-        
-        logger.log("Clock Cycle: 0, Initial Request: " + req.getIpIn() + " -> " + req.getIpOut() + ", Process Time: " + std::to_string(processTime) + ", Job Type: " + jobType);
+            stats.minProcessTime = std::min(stats.minProcessTime, processTime);
+            stats.maxProcessTime = std::max(stats.maxProcessTime, processTime);
+
+            Request req(ipIn, ipOut, processTime, jobType, loadBalancer.getTime());
+            loadBalancer.addRequest(req);
+
+            logger.event(LogEventKind::InitialRequest, 0, 0, req, static_cast<uint32_t>(processTime));
+        }
     }
 
-    startingQueueSize = loadBalancer.getRequestQueueSize();
+    int startingQueueSize = loadBalancer.getRequestQueueSize();
     logger.log("");
     logger.log("------------------------------------------------");
     logger.log("Starting Queue Size: " + std::to_string(startingQueueSize));
@@ -87,44 +309,80 @@ int main() {
     logger.log("");
 
     while (loadBalancer.getTime() < runTime) {
-        for (auto& server : servers) {
-            if (server.isIdle()) {
-                if (!loadBalancer.isRequestQueueEmpty()) {
-                    Request req = loadBalancer.getRequest();
-                    server.addRequest(req, loadBalancer.getTime());
-                    logger.log("Clock Cycle: " + std::to_string(loadBalancer.getTime()) + ", Server " + server.getName() + " handling request from " + req.getIpIn() + " to " + req.getIpOut() + ", Job Type: " + req.getJobType());
-                }
-            } else if (server.isRequestDone(loadBalancer.getTime())) {
-                loadBalancer.incrementProcessedRequests();
-                server.incrementProcessedRequestCount();
-                logger.log("Clock Cycle: " + std::to_string(loadBalancer.getTime()) + ", Server " + server.getName() + " completed request.");
-
-                if (!loadBalancer.isRequestQueueEmpty()) {
-                    Request req = loadBalancer.getRequest();
-                    server.addRequest(req, loadBalancer.getTime());
-                    logger.log("Clock Cycle: " + std::to_string(loadBalancer.getTime()) + ", Server " + server.getName() + " handling new request from " + req.getIpIn() + " to " + req.getIpOut() + ", Job Type: " + req.getJobType());
-                }
+        PROFILE_ZONE("cycle");
+
+        if (loadBalancer.getTime() == snapshotAt) {
+            PROFILE_ZONE("snapshot");
+            if (Snapshot::save(snapshotFile, loadBalancer, servers, rng, stats, faultInjector)) {
+                logger.log("Snapshot saved to " + snapshotFile + ", Clock Cycle: " + std::to_string(loadBalancer.getTime()));
             }
         }
 
+        //inject faults, then complete and dispatch requests on every server
+        {
+            PROFILE_ZONE("faults");
+            faultInjector.step(servers, loadBalancer.getTime(), rng);
+        }
+        loadBalancer.processServers(servers);
+
         //dynamic server allocation and deallocation
-        loadBalancer.allocateServer();
-        loadBalancer.deallocateServer();
+        {
+            PROFILE_ZONE("autoscale");
+            loadBalancer.allocateServer();
+            loadBalancer.deallocateServer();
+        }
 
         //generate new requests randomly
-        if (std::rand() % 10 == 0) {
-            std::string ipIn = generateRandomIP();
-            std::string ipOut = generateRandomIP();
-            int processTime = std::rand() % 50 + 1;
-            char jobType = (std::rand() % 2 == 0) ? 'P' : 'S';
+        if (rng() % 10 == 0) {
+            PROFILE_ZONE("generation");
+            uint32_t ipIn = generateRandomIP(rng);
+            uint32_t ipOut = generateRandomIP(rng);
+            int processTime = static_cast<int>(rng() % 50) + 1;
+            char jobType = (rng() % 2 == 0) ? 'P' : 'S';
 
-            minProcessTime = std::min(minProcessTime, processTime);
-            maxProcessTime = std::max(maxProcessTime, processTime);
+            stats.minProcessTime = std::min(stats.minProcessTime, processTime);
+            stats.maxProcessTime = std::max(stats.maxProcessTime, processTime);
 
             Request req(ipIn, ipOut, processTime, jobType, loadBalancer.getTime());
             loadBalancer.addRequest(req);
             
-            logger.log("Clock Cycle: " + std::to_string(loadBalancer.getTime()) + ", New Request: " + req.getIpIn() + " -> " + req.getIpOut() + ", Process Time: " + std::to_string(processTime) + ", Job Type: " + jobType);
+            logger.event(LogEventKind::NewRequest, loadBalancer.getTime(), 0, req, static_cast<uint32_t>(processTime));
+        }
+
+        //drain requests pushed by external producers
+        if (!ingestName.empty()) {
+            PROFILE_ZONE("ingest");
+            IngestRecord records[256];
+            std::vector<Request> arrivals;
+            arrivals.reserve(256);
+            size_t count;
+            int batches = 0;
+            //a bounded number of batches per cycle, so a producer that never stops cannot stall the clock
+            while (batches < kIngestBatchesPerCycle && (count = ingest.poll(records, 256)) > 0) {
+                batches++;
+                arrivals.clear();
+                for (size_t i = 0; i < count; ++i) {
+                    const IngestRecord& rec = records[i];
+                    if (!isValidIngestRecord(rec)) {
+                        malformedIngest++;
+                        continue;
+                    }
+                    int processTime = static_cast<int>(rec.processTime);
+                    char jobType = static_cast<char>(rec.jobType);
+
+                    stats.minProcessTime = std::min(stats.minProcessTime, processTime);
+                    stats.maxProcessTime = std::max(stats.maxProcessTime, processTime);
+
+                    arrivals.emplace_back(rec.ipIn, rec.ipOut, processTime, jobType, loadBalancer.getTime());
+                }
+                loadBalancer.addRequests(arrivals.data(), arrivals.size()); //logs the New Request lines
+            }
+
+            //nothing to do this cycle: sleep until a producer publishes
+            bool allIdle = std::all_of(servers.begin(), servers.end(), [](const WebServer& s) { return s.isIdle(); });
+            if (allIdle && loadBalancer.isRequestQueueEmpty() && batches < kIngestBatchesPerCycle) {
+                ingest.wait(10);
+            }
         }
 
         loadBalancer.incTime();
@@ -144,7 +402,24 @@ int main() {
        << "  Inactive servers: " << loadBalancer.getInactiveServers() << std::endl
        << "  Rejected/discarded requests: " << loadBalancer.getRejectedRequests() << std::endl
        << "  Ending Queue Size: " << loadBalancer.getRequestQueueSize() << std::endl 
-       << "  Task Time Range: " << minProcessTime << " to " << maxProcessTime; 
+       << "  Task Time Range: " << stats.minProcessTime << " to " << stats.maxProcessTime; 
+    if (faultInjector.enabled() || resilience.healthCheckInterval > 0 || resilience.hedgeAfter > 0) {
+        ss << std::endl << "Resilience:" << std::endl
+           << "  Crashes: " << faultInjector.getCrashes() << ", slowdowns: " << faultInjector.getSlowdowns() << std::endl
+           << loadBalancer.describeResilience(servers);
+    }
+    if (!ingestName.empty()) {
+        ss << std::endl << "  Malformed ingest records dropped: " << malformedIngest;
+    }
+    if (loadBalancer.getRequestQueue().isSpilling()) {
+        ss << std::endl << "  " << loadBalancer.getRequestQueue().describeSpill();
+    }
+    ss << std::endl << "Memory:";
+    const std::string heap = describeHeapUsage();
+    if (!heap.empty()) {
+        ss << std::endl << heap;
+    }
+    ss << std::endl << loadBalancer.describeMemory(servers);
 
     logger.log(ss.str());
 
@@ -159,4 +434,25 @@ int main() {
         serverStats << "  Server " << server.getName() << ": " << server.getProcessedRequestCount();
         logger.log(serverStats.str());
     }
+
+    //without stream slots every server runs one request at a time, so the block says nothing
+    if (streamSlots > 0) {
+        logger.log("");
+        logger.log("Concurrency by server (average, peak):");
+
+        for (const auto& server : servers) {
+            std::stringstream serverStats;
+            double elapsed = std::max(1, loadBalancer.getTime());
+            serverStats << "  Server " << server.getName() << ": " << std::fixed << std::setprecision(2)
+                        << server.getConcurrencyCycles() / elapsed << ", " << server.getPeakConcurrency();
+            logger.log(serverStats.str());
+        }
+    }
+
+    if (Profiler::enabled()) {
+        Profiler::report(std::cout);
+        if (!traceFile.empty() && !Profiler::writeTrace(traceFile)) {
+            std::cerr << "Failed to write trace file: " << traceFile << std::endl;
+        }
+    }
 }
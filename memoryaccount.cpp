@@ -0,0 +1,92 @@
+#include "memoryaccount.h"
+#include <atomic>
+#include <iomanip>
+#include <sstream>
+
+namespace {
+
+// Constant-initialised, so they are valid before any static constructor allocates.
+std::atomic<uint64_t> heapCurrent(0);      ///< Live heap bytes.
+std::atomic<uint64_t> heapPeak(0);         ///< Most live heap bytes.
+std::atomic<uint64_t> heapAllocations(0);  ///< Allocations made.
+std::atomic<uint64_t> heapFrees(0);        ///< Deallocations made.
+
+} // namespace
+
+/**
+ * @brief Records a heap allocation (called by the replacement operator new).
+ *
+ * Relaxed atomics: the counters are statistics, read once at the end.
+ *
+ * @param bytes Usable size of the new block.
+ */
+void recordHeapAllocation(size_t bytes) {
+    heapAllocations.fetch_add(1, std::memory_order_relaxed);
+    const uint64_t now = heapCurrent.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+    uint64_t peak = heapPeak.load(std::memory_order_relaxed);
+    while (now > peak && !heapPeak.compare_exchange_weak(peak, now, std::memory_order_relaxed)) {
+    }
+}
+
+/**
+ * @brief Records a heap deallocation (called by the replacement operator delete).
+ *
+ * @param bytes Usable size of the released block.
+ */
+void recordHeapFree(size_t bytes) {
+    heapFrees.fetch_add(1, std::memory_order_relaxed);
+    heapCurrent.fetch_sub(bytes, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Gets the process-wide heap figures.
+ *
+ * The heap counts as tracked once anything has been recorded; the C++
+ * runtime allocates before main(), so that is always the case when
+ * heaphooks.cpp is linked.
+ *
+ * @return The figures; tracked is false unless heaphooks.cpp is linked.
+ */
+HeapUsage heapUsage() {
+    HeapUsage usage;
+    usage.allocations = heapAllocations.load(std::memory_order_relaxed);
+    usage.frees = heapFrees.load(std::memory_order_relaxed);
+    usage.current = heapCurrent.load(std::memory_order_relaxed);
+    usage.peak = heapPeak.load(std::memory_order_relaxed);
+    usage.tracked = usage.allocations > 0;
+    return usage;
+}
+
+/**
+ * @brief Formats a byte count with a binary unit ("512 B", "64.0 KB", "3.25 MB").
+ *
+ * @param bytes The byte count.
+ * @return The formatted size.
+ */
+std::string formatBytes(uint64_t bytes) {
+    std::ostringstream ss;
+    if (bytes < 1024) {
+        ss << bytes << " B";
+    } else if (bytes < 1024 * 1024) {
+        ss << std::fixed << std::setprecision(1) << bytes / 1024.0 << " KB";
+    } else {
+        ss << std::fixed << std::setprecision(2) << bytes / (1024.0 * 1024.0) << " MB";
+    }
+    return ss.str();
+}
+
+/**
+ * @brief Describes the process-wide heap for the final status.
+ *
+ * @return One report line, or an empty string if the heap is not tracked.
+ */
+std::string describeHeapUsage() {
+    const HeapUsage heap = heapUsage();
+    if (!heap.tracked) {
+        return std::string();
+    }
+    std::ostringstream ss;
+    ss << "  Heap: " << formatBytes(heap.current) << " now, " << formatBytes(heap.peak) << " peak, "
+       << heap.allocations << " allocations (" << heap.allocations - heap.frees << " live)";
+    return ss.str();
+}
@@ -0,0 +1,160 @@
+/**
+ * @file memoryaccount.h
+ *
+ * This file contains the memory accounting reported in the final status.
+ *
+ * A MemoryAccount tracks the current and peak bytes of one component. The
+ * request queue and the blocklist charge their containers to an account
+ * through CountingAllocator, so their figures and allocation counts are
+ * exact; components whose memory lives in many small objects (the server
+ * fleet, the balancer's bookkeeping) sample a capacity-based estimate
+ * instead. Process-wide heap counters are fed by the replacement
+ * operator new and delete in heaphooks.cpp, which only the simulator links;
+ * in other programs heapUsage() reports that the heap is not tracked.
+ */
+
+#ifndef MEMORYACCOUNT_H
+#define MEMORYACCOUNT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <string>
+
+ //all doxygen comments are generated with AI assistance
+
+/**
+ * @brief Current and peak bytes of one component.
+ *
+ * Not thread-safe; every account belongs to one balancer, which only one
+ * thread touches at a time.
+ */
+struct MemoryAccount {
+    uint64_t current = 0;      ///< Bytes held now.
+    uint64_t peak = 0;         ///< Most bytes held at once.
+    uint64_t allocations = 0;  ///< Allocations made, 0 for sampled components.
+
+    /**
+     * @brief Charges an allocation.
+     * @param bytes Size of the allocation.
+     */
+    void allocated(size_t bytes) {
+        current += bytes;
+        allocations++;
+        if (current > peak) {
+            peak = current;
+        }
+    }
+
+    /**
+     * @brief Credits a deallocation.
+     * @param bytes Size of the allocation being released.
+     */
+    void freed(size_t bytes) {
+        current -= bytes;
+    }
+
+    /**
+     * @brief Records a sampled size for components without a counting allocator.
+     * @param bytes Estimated bytes held now.
+     */
+    void sample(uint64_t bytes) {
+        current = bytes;
+        if (bytes > peak) {
+            peak = bytes;
+        }
+    }
+};
+
+/**
+ * @class CountingAllocator
+ * @brief Standard allocator that charges a container's memory to a MemoryAccount.
+ *
+ * A default-constructed allocator charges nothing.
+ */
+template <class T>
+class CountingAllocator {
+public:
+    typedef T value_type;
+
+    CountingAllocator() noexcept {}
+
+    /**
+     * @brief Constructs an allocator charging the given account.
+     * @param account The account, which must outlive every container using it.
+     */
+    explicit CountingAllocator(MemoryAccount* account) noexcept : account(account) {}
+
+    template <class U>
+    CountingAllocator(const CountingAllocator<U>& other) noexcept : account(other.account) {}
+
+    T* allocate(size_t n) {
+        if (account != nullptr) {
+            account->allocated(n * sizeof(T));
+        }
+        return static_cast<T*>(::operator new(n * sizeof(T)));
+    }
+
+    void deallocate(T* p, size_t n) noexcept {
+        if (account != nullptr) {
+            account->freed(n * sizeof(T));
+        }
+        ::operator delete(p);
+    }
+
+    MemoryAccount* account = nullptr; ///< Charged account, null for none.
+};
+
+template <class T, class U>
+bool operator==(const CountingAllocator<T>& a, const CountingAllocator<U>& b) {
+    return a.account == b.account;
+}
+
+template <class T, class U>
+bool operator!=(const CountingAllocator<T>& a, const CountingAllocator<U>& b) {
+    return a.account != b.account;
+}
+
+/**
+ * @brief Process-wide heap figures.
+ */
+struct HeapUsage {
+    bool tracked = false;      ///< Whether operator new is counted in this program.
+    uint64_t current = 0;      ///< Live heap bytes (usable size of every live block).
+    uint64_t peak = 0;         ///< Most live heap bytes at once.
+    uint64_t allocations = 0;  ///< Allocations made.
+    uint64_t frees = 0;        ///< Deallocations made.
+};
+
+/**
+ * @brief Records a heap allocation (called by the replacement operator new).
+ * @param bytes Usable size of the new block.
+ */
+void recordHeapAllocation(size_t bytes);
+
+/**
+ * @brief Records a heap deallocation (called by the replacement operator delete).
+ * @param bytes Usable size of the released block.
+ */
+void recordHeapFree(size_t bytes);
+
+/**
+ * @brief Gets the process-wide heap figures.
+ * @return The figures; tracked is false unless heaphooks.cpp is linked.
+ */
+HeapUsage heapUsage();
+
+/**
+ * @brief Formats a byte count with a binary unit ("512 B", "64.0 KB", "3.25 MB").
+ * @param bytes The byte count.
+ * @return The formatted size.
+ */
+std::string formatBytes(uint64_t bytes);
+
+/**
+ * @brief Describes the process-wide heap for the final status.
+ * @return One report line, or an empty string if the heap is not tracked.
+ */
+std::string describeHeapUsage();
+
+#endif
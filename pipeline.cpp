@@ -0,0 +1,434 @@
+#include "pipeline.h"
+#include "memoryaccount.h"
+#include "profiler.h"
+#include <algorithm>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+namespace {
+
+const size_t kMaxSteps = 4;   ///< Steps a packed stage program holds.
+const size_t kMaxStages = 15; ///< Stage numbers a 4-bit step can name.
+const char kJobTypes[] = {'P', 'S'}; ///< Job types, in the order of Pipeline::programs.
+
+/**
+ * @brief Orders the running heap so the earliest finish is on top.
+ */
+template <class T>
+bool finishesLater(const T& a, const T& b) {
+    return a.finishAt > b.finishAt || (a.finishAt == b.finishAt && a.handle > b.handle);
+}
+
+/**
+ * @brief Parses a positive integer that must make up the whole string.
+ */
+bool parsePositive(const std::string& text, int& out) {
+    if (text.empty() || text.find_first_not_of("0123456789") != std::string::npos || text.size() > 9) {
+        return false;
+    }
+    out = std::atoi(text.c_str());
+    return out > 0;
+}
+
+/**
+ * @brief Formats a share as a percentage with one decimal.
+ */
+std::string percent(double part, double whole) {
+    std::ostringstream ss;
+    ss << std::fixed << std::setprecision(1) << (whole > 0 ? 100.0 * part / whole : 0.0) << "%";
+    return ss.str();
+}
+
+} // namespace
+
+/**
+ * @brief Parses a pipeline definition such as "auth:4:1-5,compute:12:5-30,stream:6:10-40:S".
+ *
+ * Besides the syntax this checks that every job type visits at least one
+ * stage and at most four, the most a packed stage program can hold.
+ *
+ * @param spec The definition given on the command line.
+ * @param out Receives the stages; the arrival rate is left as it is.
+ * @return True if the definition is valid.
+ */
+bool parsePipeline(const std::string& spec, PipelineConfig& out) {
+    std::vector<PipelineStage> stages;
+    std::stringstream list(spec);
+    std::string item;
+    while (std::getline(list, item, ',')) {
+        std::vector<std::string> fields;
+        std::stringstream parts(item);
+        std::string field;
+        while (std::getline(parts, field, ':')) {
+            fields.push_back(field);
+        }
+        PipelineStage stage;
+        if (fields.size() < 3 || fields.size() > 4 || fields[0].empty()) {
+            std::cerr << "Bad pipeline stage '" << item << "', expected NAME:SERVERS:MIN-MAX[:JOBTYPES]" << std::endl;
+            return false;
+        }
+        stage.name = fields[0];
+        const size_t dash = fields[2].find('-');
+        const std::string minText = fields[2].substr(0, dash);
+        const std::string maxText = dash == std::string::npos ? minText : fields[2].substr(dash + 1);
+        if (!parsePositive(fields[1], stage.servers) || !parsePositive(minText, stage.minTime) ||
+            !parsePositive(maxText, stage.maxTime) || stage.minTime > stage.maxTime) {
+            std::cerr << "Bad pipeline stage '" << item << "': servers and service times must be positive, MIN <= MAX" << std::endl;
+            return false;
+        }
+        if (fields.size() == 4) {
+            stage.jobTypes = fields[3];
+            if (stage.jobTypes.empty() || stage.jobTypes.find_first_not_of("PS") != std::string::npos) {
+                std::cerr << "Bad pipeline stage '" << item << "': job types must be P, S or PS" << std::endl;
+                return false;
+            }
+        }
+        stages.push_back(stage);
+    }
+    if (stages.empty() || stages.size() > kMaxStages) {
+        std::cerr << "A pipeline needs 1 to " << kMaxStages << " stages" << std::endl;
+        return false;
+    }
+    for (char type : kJobTypes) {
+        size_t steps = 0;
+        for (const auto& stage : stages) {
+            if (stage.jobTypes.empty() || stage.jobTypes.find(type) != std::string::npos) {
+                steps++;
+            }
+        }
+        if (steps == 0 || steps > kMaxSteps) {
+            std::cerr << "Job type " << type << " visits " << steps << " pipeline stages, it must visit 1 to "
+                      << kMaxSteps << std::endl;
+            return false;
+        }
+    }
+    out.stages = stages;
+    return true;
+}
+
+/**
+ * @brief Doubles the ring, moving the queued handles to the front.
+ *
+ * Only called when the ring is full, so a queue that has reached its peak
+ * never allocates again.
+ */
+void HandleRing::grow() {
+    std::vector<uint32_t> larger(std::max<size_t>(64, slots.size() * 2));
+    for (size_t i = 0; i < count; ++i) {
+        larger[i] = slots[(head + i) & (slots.size() - 1)];
+    }
+    slots.swap(larger);
+    head = 0;
+}
+
+/**
+ * @brief Constructs a pipeline.
+ *
+ * Packs the stage program of each job type: the stages it visits, in order,
+ * one 4-bit step each.
+ *
+ * @param config Stages and arrival rate; must have passed parsePipeline().
+ * @param logger Log for the header and the final report.
+ * @param seed Seed of the pipeline's random number generator.
+ */
+Pipeline::Pipeline(const PipelineConfig& config, LogManager& logger, unsigned seed)
+    : config(config), logger(logger), rng(seed), stages(config.stages.size()) {
+    for (size_t t = 0; t < 2; ++t) {
+        size_t step = 0;
+        for (size_t s = 0; s < config.stages.size() && step < kMaxSteps; ++s) {
+            const std::string& types = config.stages[s].jobTypes;
+            if (types.empty() || types.find(kJobTypes[t]) != std::string::npos) {
+                programs[t] |= static_cast<uint16_t>((s + 1) << (4 * step++));
+            }
+        }
+    }
+    for (size_t s = 0; s < stages.size(); ++s) {
+        stages[s].running.reserve(static_cast<size_t>(config.stages[s].servers));
+    }
+}
+
+/**
+ * @brief Takes a free task slot (growing the slab if none is left) for a new request.
+ *
+ * @param req The request, with its stage program set.
+ * @return The task's handle.
+ */
+uint32_t Pipeline::spawn(const Request& req) {
+    uint32_t handle = freeHead;
+    if (handle == UINT32_MAX) {
+        handle = static_cast<uint32_t>(tasks.size());
+        tasks.push_back(Task());
+    } else {
+        freeHead = tasks[handle].nextFree;
+    }
+    Task& task = tasks[handle];
+    task.request = req;
+    task.request.setId(handle);
+    task.longestStep = -1;
+    task.longestStage = 0;
+    inFlight++;
+    peakInFlight = std::max(peakInFlight, inFlight);
+    return handle;
+}
+
+/**
+ * @brief Continues a task at its current step: queues it at that stage or retires it.
+ *
+ * This is the whole state machine. A task that has a step left joins that
+ * stage's queue; one whose program has ended records its end-to-end latency
+ * and which stage took the longest, and its slot goes back on the free list.
+ *
+ * @param handle The task.
+ */
+void Pipeline::resume(uint32_t handle) {
+    Task& task = tasks[handle];
+    const int stage = task.request.getStage();
+    if (stage >= 0) {
+        task.state = TaskState::Queued;
+        task.enqueuedAt = time;
+        stages[static_cast<size_t>(stage)].queue.push(handle);
+        return;
+    }
+    endToEnd.record(time - task.request.getArrivalTime());
+    stages[task.longestStage].longestFor++;
+    completed++;
+    inFlight--;
+    task.state = TaskState::Free;
+    task.nextFree = freeHead;
+    freeHead = handle;
+}
+
+/**
+ * @brief Finishes every service due this cycle and resumes those tasks.
+ *
+ * Stages are completed in order, so a task finishing one stage can be
+ * dispatched by the next in the same cycle.
+ */
+void Pipeline::completeStages() {
+    PROFILE_ZONE("completion");
+    for (size_t s = 0; s < stages.size(); ++s) {
+        StageRuntime& stage = stages[s];
+        while (!stage.running.empty() && stage.running.front().finishAt <= time) {
+            const uint32_t handle = stage.running.front().handle;
+            std::pop_heap(stage.running.begin(), stage.running.end(), finishesLater<Running>);
+            stage.running.pop_back();
+
+            Task& task = tasks[handle];
+            const int service = time - task.request.getDispatchTime();
+            const int step = task.request.getDispatchTime() - task.enqueuedAt + service;
+            stage.served++;
+            stage.serviceCycles += static_cast<uint64_t>(service);
+            if (step > task.longestStep) {
+                task.longestStep = step;
+                task.longestStage = static_cast<uint8_t>(s);
+            }
+            task.request.advanceStage();
+            resume(handle);
+        }
+    }
+}
+
+/**
+ * @brief Hands queued tasks to the idle servers of every stage.
+ *
+ * The service time is drawn when a task starts, from the stage's range.
+ */
+void Pipeline::dispatchStages() {
+    PROFILE_ZONE("dispatch");
+    for (size_t s = 0; s < stages.size(); ++s) {
+        StageRuntime& stage = stages[s];
+        const PipelineStage& spec = config.stages[s];
+        const int span = spec.maxTime - spec.minTime + 1;
+        while (stage.queue.size() > 0 && stage.running.size() < static_cast<size_t>(spec.servers)) {
+            const uint32_t handle = stage.queue.pop();
+            Task& task = tasks[handle];
+            const int waited = time - task.enqueuedAt;
+            stage.wait.record(waited);
+            stage.waitCycles += static_cast<uint64_t>(waited);
+            task.state = TaskState::Running;
+            task.request.setDispatchTime(time);
+            const int service = spec.minTime + static_cast<int>(rng() % static_cast<unsigned>(span));
+            stage.running.push_back(Running{time + service, handle});
+            std::push_heap(stage.running.begin(), stage.running.end(), finishesLater<Running>);
+        }
+        stage.busyCycles += stage.running.size();
+        stage.queueCycles += stage.queue.size();
+        stage.peakQueue = std::max(stage.peakQueue, stage.queue.size());
+    }
+}
+
+/**
+ * @brief Generates this cycle's arrivals.
+ *
+ * Like the front tier, the integer part of the arrival rate arrives every
+ * cycle and the fraction with that probability. A request's program follows
+ * from its job type.
+ */
+void Pipeline::generateArrivals() {
+    PROFILE_ZONE("generation");
+    int count = static_cast<int>(config.arrivalRate);
+    if (rng() / 4294967296.0 < config.arrivalRate - count) {
+        count++;
+    }
+    for (int i = 0; i < count; ++i) {
+        const uint32_t ipIn = static_cast<uint32_t>(rng());
+        const uint32_t ipOut = static_cast<uint32_t>(rng());
+        const char jobType = (rng() % 2 == 0) ? 'P' : 'S';
+        Request req(ipIn, ipOut, 0, jobType, time);
+        req.setStageProgram(programs[jobType == 'P' ? 0 : 1]);
+        arrived++;
+        arrivedByType[jobType == 'P' ? 0 : 1]++;
+        resume(spawn(req));
+    }
+}
+
+/**
+ * @brief Runs the pipeline until the given cycle.
+ *
+ * Each cycle completes due services, dispatches to idle servers, then
+ * generates arrivals, which are dispatched from the next cycle on (the same
+ * order as the single-balancer simulation).
+ *
+ * @param runTime Clock cycle to stop at.
+ */
+void Pipeline::run(int runTime) {
+    std::ostringstream header;
+    header << "Pipeline:";
+    for (size_t s = 0; s < config.stages.size(); ++s) {
+        const PipelineStage& spec = config.stages[s];
+        header << (s == 0 ? " " : " -> ") << spec.name << " (" << spec.servers << " servers, " << spec.minTime
+               << "-" << spec.maxTime << " cycles" << (spec.jobTypes.empty() ? "" : ", " + spec.jobTypes + " only") << ")";
+    }
+    logger.log("");
+    logger.log("-------------------Simulation Starts-----------------------------");
+    logger.log("");
+    logger.log(header.str());
+
+    while (time < runTime) {
+        PROFILE_ZONE("cycle");
+        completeStages();
+        dispatchStages();
+        generateArrivals();
+        time++;
+    }
+
+    logger.log("");
+    logger.log("-------------------Simulation Completed-----------------------------");
+    logger.log("");
+}
+
+/**
+ * @brief Estimates the arrival rate a stage could keep up with.
+ *
+ * A pool of n servers with mean service time t finishes n / t requests per
+ * cycle; divided by the share of arrivals whose program visits the stage this
+ * is the arrival rate at which it saturates. The mean service time is the
+ * measured one, or the middle of the configured range before any service
+ * has finished. Unlike utilization this still tells stages apart when an
+ * overloaded pipeline keeps every pool busy.
+ *
+ * @param s The stage index.
+ * @return Arrivals per cycle, from its pool size, mean service time and the share of arrivals that visit it.
+ */
+double Pipeline::sustainableRate(size_t s) const {
+    const StageRuntime& stage = stages[s];
+    const PipelineStage& spec = config.stages[s];
+    const double meanService = stage.served > 0 ? static_cast<double>(stage.serviceCycles) / stage.served
+                                                : (spec.minTime + spec.maxTime) / 2.0;
+    uint64_t visiting = 0;
+    for (size_t t = 0; t < 2; ++t) {
+        if (spec.jobTypes.empty() || spec.jobTypes.find(kJobTypes[t]) != std::string::npos) {
+            visiting += arrivedByType[t];
+        }
+    }
+    const double share = arrived > 0 ? static_cast<double>(visiting) / arrived : 1.0;
+    return spec.servers / meanService / std::max(share, 1e-9);
+}
+
+/**
+ * @brief Finds the stage limiting throughput: the one with the lowest sustainable rate.
+ *
+ * @return The stage index, -1 without stages.
+ */
+int Pipeline::limitingStage() const {
+    int best = -1;
+    for (size_t s = 0; s < stages.size(); ++s) {
+        if (best < 0 || sustainableRate(s) < sustainableRate(static_cast<size_t>(best))) {
+            best = static_cast<int>(s);
+        }
+    }
+    return best;
+}
+
+/**
+ * @brief Describes throughput, end-to-end latency and every stage.
+ *
+ * A stage's path share is the part of all the time requests spent in the
+ * pipeline that they spent queued at or served by that stage; its longest-step
+ * share counts the completed requests whose slowest stage it was. Together
+ * they show which stage the end-to-end latency waits on.
+ *
+ * @return The report, ending with the limiting stage.
+ */
+std::string Pipeline::describe() const {
+    const double elapsed = std::max(1, time);
+    uint64_t pathCycles = 0;
+    for (const auto& stage : stages) {
+        pathCycles += stage.waitCycles + stage.serviceCycles;
+    }
+
+    std::ostringstream ss;
+    ss << "Pipeline status (" << stages.size() << " stages, " << config.arrivalRate << " arrivals per cycle):" << std::endl
+       << "  Requests arrived: " << arrived << ", completed: " << completed << ", in flight: " << inFlight
+       << " (peak " << peakInFlight << ")" << std::endl
+       << "  Throughput: " << std::fixed << std::setprecision(3) << completed / elapsed << " per cycle" << std::endl
+       << "  End-to-end latency p50/p99/p99.9: " << endToEnd.percentile(50) << " / " << endToEnd.percentile(99)
+       << " / " << endToEnd.percentile(99.9) << " cycles" << std::endl;
+    for (size_t s = 0; s < stages.size(); ++s) {
+        const StageRuntime& stage = stages[s];
+        const PipelineStage& spec = config.stages[s];
+        ss << "  Stage " << spec.name << ": " << spec.servers << " servers, " << stage.served << " served, "
+           << percent(static_cast<double>(stage.busyCycles), elapsed * spec.servers) << " busy, queue wait p50/p99 "
+           << stage.wait.percentile(50) << " / " << stage.wait.percentile(99) << " cycles, queue mean "
+           << std::setprecision(1) << stage.queueCycles / elapsed << " (peak " << stage.peakQueue << ", now "
+           << stage.queue.size() << "), sustains " << std::setprecision(2) << sustainableRate(s)
+           << " arrivals per cycle, path share " << percent(static_cast<double>(stage.waitCycles + stage.serviceCycles), static_cast<double>(pathCycles))
+           << " (queued " << percent(static_cast<double>(stage.waitCycles), static_cast<double>(pathCycles)) << "), longest step for "
+           << percent(static_cast<double>(stage.longestFor), static_cast<double>(completed)) << " of requests" << std::endl;
+    }
+    const int limit = limitingStage();
+    if (limit >= 0) {
+        const StageRuntime& stage = stages[static_cast<size_t>(limit)];
+        const PipelineStage& spec = config.stages[static_cast<size_t>(limit)];
+        ss << "  Limiting stage: " << spec.name << " (sustains " << std::setprecision(2)
+           << sustainableRate(static_cast<size_t>(limit)) << " of " << config.arrivalRate << " arrivals per cycle, "
+           << percent(static_cast<double>(stage.busyCycles), elapsed * spec.servers) << " busy, "
+           << percent(static_cast<double>(stage.waitCycles), static_cast<double>(pathCycles)) << " of path time queued for it)";
+    }
+    return ss.str();
+}
+
+/**
+ * @brief Describes the memory held by tasks, queues and statistics.
+ *
+ * @return Report lines for the final status's Memory block.
+ */
+std::string Pipeline::describeMemory() const {
+    size_t queueBytes = 0;
+    size_t runningBytes = 0;
+    size_t histogramBytes = endToEnd.getMemoryBytes();
+    for (const auto& stage : stages) {
+        queueBytes += stage.queue.getMemoryBytes();
+        runningBytes += stage.running.capacity() * sizeof(Running);
+        histogramBytes += stage.wait.getMemoryBytes();
+    }
+    std::ostringstream ss;
+    ss << "  Tasks: " << formatBytes(tasks.capacity() * sizeof(Task)) << " (" << tasks.size() << " slots of "
+       << sizeof(Task) << " B, peak " << peakInFlight << " in flight)" << std::endl
+       << "  Stage queues: " << formatBytes(queueBytes) << ", running heaps: " << formatBytes(runningBytes) << std::endl
+       << "  Latency histograms: " << formatBytes(histogramBytes) << std::endl
+       << "  Log buffers: " << formatBytes(logger.getMemoryBytes());
+    return ss.str();
+}
@@ -0,0 +1,252 @@
+/**
+ * @file pipeline.h
+ *
+ * This file contains the Pipeline class, which runs requests through a
+ * sequence of stages (for example auth, compute, stream), each served by its
+ * own pool of servers with its own queue.
+ *
+ * Every request carries a small stage program (see Request::getStageProgram),
+ * chosen by its job type when it arrives. A request in flight is a task: a
+ * fixed-size slot in one slab holding the request and its timing, addressed
+ * by a 32-bit handle. Tasks are stackless state machines; the step of the
+ * program is their whole continuation, so resuming one after a stage is a
+ * table lookup that either queues it at its next stage or retires it. Stage
+ * queues are rings of handles and each pool keeps its running tasks in a
+ * heap ordered by finish cycle. The slab, rings and heaps only grow
+ * geometrically and reuse freed slots, so millions of requests can be in
+ * flight without a heap allocation per request.
+ */
+
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include "latencyhistogram.h"
+#include "logmanager.h"
+#include "request.h"
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+ //all doxygen comments are generated with AI assistance
+
+/**
+ * @brief One stage of a pipeline and the pool that serves it.
+ */
+struct PipelineStage {
+    std::string name;      ///< Stage name used in the report.
+    int servers = 1;       ///< Servers in the stage's pool.
+    int minTime = 1;       ///< Shortest service time in clock cycles.
+    int maxTime = 1;       ///< Longest service time in clock cycles.
+    std::string jobTypes;  ///< Job types that visit the stage, empty for all.
+};
+
+/**
+ * @brief Parameters of a pipeline run.
+ */
+struct PipelineConfig {
+    std::vector<PipelineStage> stages; ///< Stages in the order requests visit them.
+    double arrivalRate = 1.0;          ///< New requests per cycle.
+};
+
+/**
+ * @brief Parses a pipeline definition such as "auth:4:1-5,compute:12:5-30,stream:6:10-40:S".
+ *
+ * Each comma-separated stage is NAME:SERVERS:MIN-MAX[:JOBTYPES]; a single
+ * number instead of MIN-MAX gives a fixed service time. A stage listing job
+ * types is only visited by those types.
+ *
+ * @param spec The definition given on the command line.
+ * @param out Receives the stages; the arrival rate is left as it is.
+ * @return True if the definition is valid.
+ */
+bool parsePipeline(const std::string& spec, PipelineConfig& out);
+
+/**
+ * @class HandleRing
+ * @brief FIFO of task handles in a ring that doubles when full.
+ */
+class HandleRing {
+public:
+    /**
+     * @brief Appends a handle.
+     * @param handle The handle.
+     */
+    void push(uint32_t handle) {
+        if (count == slots.size()) {
+            grow();
+        }
+        slots[(head + count) & (slots.size() - 1)] = handle;
+        count++;
+    }
+
+    /**
+     * @brief Removes the oldest handle; the ring must not be empty.
+     * @return The handle.
+     */
+    uint32_t pop() {
+        const uint32_t handle = slots[head];
+        head = (head + 1) & (slots.size() - 1);
+        count--;
+        return handle;
+    }
+
+    /**
+     * @brief Gets the number of queued handles.
+     * @return The queue length.
+     */
+    size_t size() const { return count; }
+
+    /**
+     * @brief Gets the bytes held by the ring.
+     * @return The slot storage size.
+     */
+    size_t getMemoryBytes() const { return slots.capacity() * sizeof(uint32_t); }
+
+private:
+    /**
+     * @brief Doubles the ring, moving the queued handles to the front.
+     */
+    void grow();
+
+    std::vector<uint32_t> slots; ///< Ring storage, a power of two in size.
+    size_t head = 0;             ///< Slot of the oldest handle.
+    size_t count = 0;            ///< Queued handles.
+};
+
+/**
+ * @class Pipeline
+ * @brief Moves requests through per-stage queues and server pools and reports where they wait.
+ */
+class Pipeline {
+public:
+    /**
+     * @brief Constructs a pipeline.
+     * @param config Stages and arrival rate; must have passed parsePipeline().
+     * @param logger Log for the header and the final report.
+     * @param seed Seed of the pipeline's random number generator.
+     */
+    Pipeline(const PipelineConfig& config, LogManager& logger, unsigned seed);
+
+    /**
+     * @brief Runs the pipeline until the given cycle.
+     * @param runTime Clock cycle to stop at.
+     */
+    void run(int runTime);
+
+    /**
+     * @brief Describes throughput, end-to-end latency and every stage.
+     * @return The report, ending with the limiting stage.
+     */
+    std::string describe() const;
+
+    /**
+     * @brief Describes the memory held by tasks, queues and statistics.
+     * @return Report lines for the final status's Memory block.
+     */
+    std::string describeMemory() const;
+
+private:
+    /**
+     * @brief Where a task is in its program.
+     */
+    enum class TaskState : uint8_t {
+        Free,     ///< Slot unused, on the free list.
+        Queued,   ///< Waiting in the queue of its current stage.
+        Running   ///< Being served by its current stage's pool.
+    };
+
+    /**
+     * @brief A request in flight and its timing.
+     */
+    struct Task {
+        Request request;           ///< The request; its stage program is the task's continuation.
+        int enqueuedAt = 0;        ///< Cycle the task joined its current stage's queue.
+        int longestStep = 0;       ///< Longest wait plus service at one stage so far.
+        uint32_t nextFree = 0;     ///< Next free slot while the task is free.
+        uint8_t longestStage = 0;  ///< Stage of the longest step.
+        TaskState state = TaskState::Free; ///< Where the task is.
+    };
+
+    /**
+     * @brief A task being served, ordered by finish cycle.
+     */
+    struct Running {
+        int finishAt;      ///< Cycle the service ends.
+        uint32_t handle;   ///< The task.
+    };
+
+    /**
+     * @brief A stage's queue, pool and statistics.
+     */
+    struct StageRuntime {
+        HandleRing queue;              ///< Tasks waiting for a server.
+        std::vector<Running> running;  ///< Tasks being served, a min-heap on finishAt.
+        LatencyHistogram wait;         ///< Cycles each task spent queued here.
+        uint64_t served = 0;           ///< Tasks that finished this stage.
+        uint64_t waitCycles = 0;       ///< Total queueing of tasks dispatched here.
+        uint64_t serviceCycles = 0;    ///< Total service of tasks that finished here.
+        uint64_t busyCycles = 0;       ///< Integral of busy servers over time.
+        uint64_t queueCycles = 0;      ///< Integral of the queue length over time.
+        size_t peakQueue = 0;          ///< Longest queue.
+        uint64_t longestFor = 0;       ///< Completed requests whose longest step was here.
+    };
+
+    /**
+     * @brief Takes a free task slot (growing the slab if none is left) for a new request.
+     * @param req The request, with its stage program set.
+     * @return The task's handle.
+     */
+    uint32_t spawn(const Request& req);
+
+    /**
+     * @brief Continues a task at its current step: queues it at that stage or retires it.
+     * @param handle The task.
+     */
+    void resume(uint32_t handle);
+
+    /**
+     * @brief Finishes every service due this cycle and resumes those tasks.
+     */
+    void completeStages();
+
+    /**
+     * @brief Hands queued tasks to the idle servers of every stage.
+     */
+    void dispatchStages();
+
+    /**
+     * @brief Generates this cycle's arrivals.
+     */
+    void generateArrivals();
+
+    /**
+     * @brief Estimates the arrival rate a stage could keep up with.
+     * @param s The stage index.
+     * @return Arrivals per cycle, from its pool size, mean service time and the share of arrivals that visit it.
+     */
+    double sustainableRate(size_t s) const;
+
+    /**
+     * @brief Finds the stage limiting throughput: the one with the lowest sustainable rate.
+     * @return The stage index, -1 without stages.
+     */
+    int limitingStage() const;
+
+    PipelineConfig config;                  ///< Stages and arrival rate.
+    LogManager& logger;                     ///< Log for the header and report.
+    std::mt19937 rng;                       ///< Arrivals and service times.
+    uint16_t programs[2] = {0, 0};          ///< Stage program of P and S requests.
+    std::vector<Task> tasks;                ///< Slab of tasks, indexed by handle.
+    uint32_t freeHead = UINT32_MAX;         ///< First free slot, UINT32_MAX for none.
+    std::vector<StageRuntime> stages;       ///< Runtime state, one per configured stage.
+    LatencyHistogram endToEnd;              ///< Arrival to last stage, per completed request.
+    int time = 0;                           ///< Current clock cycle.
+    uint64_t arrived = 0;                   ///< Requests generated.
+    uint64_t arrivedByType[2] = {0, 0};     ///< P and S requests generated.
+    uint64_t completed = 0;                 ///< Requests that finished their program.
+    size_t inFlight = 0;                    ///< Tasks queued or running.
+    size_t peakInFlight = 0;                ///< Most tasks in flight at once.
+};
+
+#endif
@@ -0,0 +1,214 @@
+#include "profiler.h"
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <mutex>
+
+namespace {
+
+std::mutex registryMutex;                    ///< Guards the registry below.
+std::vector<std::string> zoneNames;          ///< Zone names indexed by id.
+std::vector<ProfileThreadBuffer*> buffers;   ///< Every thread's buffer (never freed).
+std::atomic<bool> traceEnabled(false);       ///< Whether events are recorded.
+size_t traceMaxEvents = 0;                   ///< Per-thread event cap.
+
+typedef std::chrono::steady_clock Clock;
+uint64_t epochTicks = Profiler::now();       ///< Tick count at start-up, for calibration.
+Clock::time_point epochTime = Clock::now();  ///< Wall time at start-up, for calibration.
+
+/**
+ * @brief Estimates profiling ticks per microsecond since start-up.
+ */
+double ticksPerMicrosecond() {
+    double us = std::chrono::duration<double, std::micro>(Clock::now() - epochTime).count();
+    uint64_t ticks = Profiler::now() - epochTicks;
+    return (us > 0.0 && ticks > 0) ? ticks / us : 1000.0;
+}
+
+/**
+ * @brief Returns a representative duration (bucket midpoint) for a histogram bucket.
+ */
+double bucketValue(int bucket) {
+    if (bucket < 4) {
+        return bucket;
+    }
+    int exponent = bucket / 4 + 1;
+    uint64_t width = 1ull << (exponent - 2);
+    uint64_t low = static_cast<uint64_t>(4 + bucket % 4) << (exponent - 2);
+    return low + width / 2.0;
+}
+
+/**
+ * @brief Finds the duration at a percentile of a merged histogram.
+ */
+double histogramPercentile(const ZoneStats& stats, double pct) {
+    if (stats.calls == 0) {
+        return 0.0;
+    }
+    uint64_t rank = static_cast<uint64_t>(pct / 100.0 * (stats.calls - 1));
+    uint64_t seen = 0;
+    for (int b = 0; b < ZoneStats::kBuckets; ++b) {
+        seen += stats.histogram[b];
+        if (seen > rank) {
+            return bucketValue(b);
+        }
+    }
+    return static_cast<double>(stats.maxTicks);
+}
+
+} // namespace
+
+/**
+ * @brief Returns whether zones were compiled in.
+ * @return True if the build defines LB_PROFILE.
+ */
+bool Profiler::enabled() {
+#ifdef LB_PROFILE
+    return true;
+#else
+    return false;
+#endif
+}
+
+/**
+ * @brief Registers a zone name and returns its id (called once per call site).
+ *
+ * Call sites with the same name share one id, so a phase can be timed from
+ * several places.
+ *
+ * @param name Zone name shown in reports.
+ * @return The zone id.
+ */
+int Profiler::registerZone(const char* name) {
+    std::lock_guard<std::mutex> lock(registryMutex);
+    for (size_t i = 0; i < zoneNames.size(); ++i) {
+        if (zoneNames[i] == name) {
+            return static_cast<int>(i);
+        }
+    }
+    zoneNames.push_back(name);
+    return static_cast<int>(zoneNames.size() - 1);
+}
+
+/**
+ * @brief Allocates and registers the calling thread's buffer.
+ * @return The new buffer.
+ */
+ProfileThreadBuffer* Profiler::createThreadBuffer() {
+    ProfileThreadBuffer* buffer = new ProfileThreadBuffer();
+    std::lock_guard<std::mutex> lock(registryMutex);
+    buffer->threadIndex = static_cast<int>(buffers.size());
+    buffers.push_back(buffer);
+    return buffer;
+}
+
+/**
+ * @brief Starts recording individual zone events for a trace file.
+ * @param maxEvents Per-thread cap on recorded events.
+ */
+void Profiler::enableTrace(size_t maxEvents) {
+    traceMaxEvents = maxEvents;
+    traceEnabled = true;
+}
+
+/**
+ * @brief Returns whether individual events are being recorded.
+ * @return True after enableTrace().
+ */
+bool Profiler::tracing() {
+    return traceEnabled.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Gets the per-thread event cap set by enableTrace().
+ * @return The maximum number of events kept per thread.
+ */
+size_t Profiler::traceLimit() {
+    return traceMaxEvents;
+}
+
+/**
+ * @brief Prints per-zone totals, self-time share and percentiles of all threads.
+ *
+ * Call this after the instrumented threads have finished; buffers are read
+ * without synchronisation. Self-time shares add up to 100% of instrumented time.
+ *
+ * @param out Stream to write the report to.
+ */
+void Profiler::report(std::ostream& out) {
+    std::lock_guard<std::mutex> lock(registryMutex);
+    std::vector<ZoneStats> merged(zoneNames.size());
+    for (const auto* buffer : buffers) {
+        for (size_t z = 0; z < buffer->zones.size() && z < merged.size(); ++z) {
+            const ZoneStats& src = buffer->zones[z];
+            ZoneStats& dst = merged[z];
+            dst.calls += src.calls;
+            dst.inclusiveTicks += src.inclusiveTicks;
+            dst.selfTicks += src.selfTicks;
+            dst.maxTicks = std::max(dst.maxTicks, src.maxTicks);
+            for (int b = 0; b < ZoneStats::kBuckets; ++b) {
+                dst.histogram[b] += src.histogram[b];
+            }
+        }
+    }
+    uint64_t totalSelf = 0;
+    for (const auto& z : merged) {
+        totalSelf += z.selfTicks;
+    }
+
+    const double perUs = ticksPerMicrosecond();
+    out << "Profile (" << buffers.size() << " threads, " << std::fixed << std::setprecision(1)
+        << perUs << " ticks/us):" << std::endl;
+    out << "  " << std::left << std::setw(14) << "Zone" << std::right
+        << std::setw(12) << "Calls" << std::setw(12) << "Total ms" << std::setw(12) << "Self ms"
+        << std::setw(8) << "Self %" << std::setw(10) << "Mean us" << std::setw(10) << "p50 us"
+        << std::setw(10) << "p99 us" << std::setw(10) << "Max us" << std::endl;
+    out << std::setprecision(3);
+    for (size_t z = 0; z < merged.size(); ++z) {
+        const ZoneStats& s = merged[z];
+        if (s.calls == 0) {
+            continue;
+        }
+        out << "  " << std::left << std::setw(14) << zoneNames[z] << std::right
+            << std::setw(12) << s.calls
+            << std::setw(12) << s.inclusiveTicks / perUs / 1000.0
+            << std::setw(12) << s.selfTicks / perUs / 1000.0
+            << std::setw(8) << std::setprecision(1) << (totalSelf ? 100.0 * s.selfTicks / totalSelf : 0.0)
+            << std::setprecision(3)
+            << std::setw(10) << s.inclusiveTicks / perUs / s.calls
+            << std::setw(10) << histogramPercentile(s, 50.0) / perUs
+            << std::setw(10) << histogramPercentile(s, 99.0) / perUs
+            << std::setw(10) << s.maxTicks / perUs << std::endl;
+    }
+    out.unsetf(std::ios::floatfield);
+}
+
+/**
+ * @brief Writes recorded events as Chrome trace-event JSON (chrome://tracing, Perfetto).
+ * @param path Destination file.
+ * @return True on success, false otherwise.
+ */
+bool Profiler::writeTrace(const std::string& path) {
+    std::ofstream out(path.c_str());
+    if (!out.is_open()) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(registryMutex);
+    const double perUs = ticksPerMicrosecond();
+    out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    bool first = true;
+    char line[256];
+    for (const auto* buffer : buffers) {
+        for (const auto& ev : buffer->trace) {
+            std::snprintf(line, sizeof(line),
+                          "%s\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                          first ? "" : ",", zoneNames[static_cast<size_t>(ev.zone)].c_str(), buffer->threadIndex,
+                          (ev.start - epochTicks) / perUs, ev.duration / perUs);
+            out << line;
+            first = false;
+        }
+    }
+    out << "\n]}\n";
+    return out.good();
+}
@@ -0,0 +1,222 @@
+/**
+ * @file profiler.h
+ *
+ * This file contains the hot-path instrumentation layer: scoped zone timers
+ * that accumulate per-thread cycle counts, per-phase reports and an optional
+ * Chrome trace-event file.
+ *
+ * Zones are only compiled in when the build defines LB_PROFILE (make PROFILE=1).
+ * Otherwise PROFILE_ZONE expands to nothing and the instrumented code is
+ * identical to an uninstrumented build.
+ */
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+ //all doxygen comments are generated with AI assistance
+
+#ifdef LB_PROFILE
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+/**
+ * @brief Times the rest of the enclosing scope under the given zone name.
+ */
+#define PROFILE_ZONE(name) \
+    static const int PROFILE_CONCAT(profileZoneId_, __LINE__) = Profiler::registerZone(name); \
+    ProfileZone PROFILE_CONCAT(profileZone_, __LINE__)(PROFILE_CONCAT(profileZoneId_, __LINE__))
+#else
+#define PROFILE_ZONE(name) do {} while (0)
+#endif
+
+/**
+ * @brief Accumulated timings of one zone on one thread.
+ *
+ * Durations are bucketed into a log-linear histogram (four buckets per power
+ * of two), which bounds memory regardless of run length while keeping
+ * percentile error under 25%.
+ */
+struct ZoneStats {
+    static const int kBuckets = 256;   ///< Histogram buckets.
+
+    uint64_t calls = 0;                ///< Times the zone was entered.
+    uint64_t inclusiveTicks = 0;       ///< Ticks spent in the zone including nested zones.
+    uint64_t selfTicks = 0;            ///< Ticks spent in the zone excluding nested zones.
+    uint64_t maxTicks = 0;             ///< Longest single inclusive duration.
+    uint64_t histogram[kBuckets] = {}; ///< Inclusive durations by bucket.
+};
+
+/**
+ * @brief One completed zone, recorded only while tracing.
+ */
+struct TraceEvent {
+    int zone;          ///< Zone id.
+    uint64_t start;    ///< Start tick.
+    uint64_t duration; ///< Inclusive duration in ticks.
+};
+
+/**
+ * @brief Per-thread profiling state; only its owning thread writes to it.
+ */
+struct ProfileThreadBuffer {
+    static const int kMaxDepth = 64;  ///< Deepest zone nesting tracked.
+
+    int threadIndex = 0;              ///< Small id used as the trace "tid".
+    std::vector<ZoneStats> zones;     ///< Statistics indexed by zone id.
+    uint64_t childTicks[kMaxDepth];   ///< Ticks of nested zones, per open zone.
+    int depth = 0;                    ///< Number of currently open zones.
+    std::vector<TraceEvent> trace;    ///< Completed zones while tracing.
+};
+
+/**
+ * @class Profiler
+ * @brief Process-wide registry of zones and per-thread buffers.
+ */
+class Profiler {
+public:
+    /**
+     * @brief Reads the profiling clock (the TSC on x86, steady_clock elsewhere).
+     * @return The current tick count.
+     */
+    static inline uint64_t now() {
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+    }
+
+    /**
+     * @brief Returns whether zones were compiled in.
+     * @return True if the build defines LB_PROFILE.
+     */
+    static bool enabled();
+
+    /**
+     * @brief Registers a zone name and returns its id (called once per call site).
+     * @param name Zone name shown in reports.
+     * @return The zone id.
+     */
+    static int registerZone(const char* name);
+
+    /**
+     * @brief Gets the calling thread's buffer, creating it on first use.
+     * @return The thread's buffer.
+     */
+    static inline ProfileThreadBuffer& threadBuffer() {
+        static thread_local ProfileThreadBuffer* buffer = nullptr;
+        if (buffer == nullptr) {
+            buffer = createThreadBuffer();
+        }
+        return *buffer;
+    }
+
+    /**
+     * @brief Starts recording individual zone events for a trace file.
+     * @param maxEvents Per-thread cap on recorded events.
+     */
+    static void enableTrace(size_t maxEvents);
+
+    /**
+     * @brief Returns whether individual events are being recorded.
+     * @return True after enableTrace().
+     */
+    static bool tracing();
+
+    /**
+     * @brief Gets the per-thread event cap set by enableTrace().
+     * @return The maximum number of events kept per thread.
+     */
+    static size_t traceLimit();
+
+    /**
+     * @brief Prints per-zone totals, self-time share and percentiles of all threads.
+     * @param out Stream to write the report to.
+     */
+    static void report(std::ostream& out);
+
+    /**
+     * @brief Writes recorded events as Chrome trace-event JSON (chrome://tracing, Perfetto).
+     * @param path Destination file.
+     * @return True on success, false otherwise.
+     */
+    static bool writeTrace(const std::string& path);
+
+private:
+    static ProfileThreadBuffer* createThreadBuffer();
+};
+
+/**
+ * @class ProfileZone
+ * @brief RAII timer created by PROFILE_ZONE.
+ *
+ * The destructor charges the elapsed ticks to its zone, subtracts the time of
+ * nested zones to obtain self time, and adds its own duration to the parent's
+ * nested total.
+ */
+class ProfileZone {
+public:
+    explicit ProfileZone(int zoneId)
+        : zone(zoneId), buffer(Profiler::threadBuffer()), start(Profiler::now()) {
+        if (buffer.depth < ProfileThreadBuffer::kMaxDepth) {
+            buffer.childTicks[buffer.depth] = 0;
+        }
+        buffer.depth++;
+    }
+
+    ~ProfileZone() {
+        uint64_t end = Profiler::now();
+        uint64_t duration = end - start;
+        buffer.depth--;
+        uint64_t nested = buffer.depth < ProfileThreadBuffer::kMaxDepth ? buffer.childTicks[buffer.depth] : 0;
+        if (buffer.depth > 0 && buffer.depth <= ProfileThreadBuffer::kMaxDepth) {
+            buffer.childTicks[buffer.depth - 1] += duration;
+        }
+        if (static_cast<size_t>(zone) >= buffer.zones.size()) {
+            buffer.zones.resize(static_cast<size_t>(zone) + 1);
+        }
+        ZoneStats& stats = buffer.zones[static_cast<size_t>(zone)];
+        stats.calls++;
+        stats.inclusiveTicks += duration;
+        stats.selfTicks += duration - nested;
+        if (duration > stats.maxTicks) {
+            stats.maxTicks = duration;
+        }
+        stats.histogram[bucketOf(duration)]++;
+        if (Profiler::tracing() && buffer.trace.size() < Profiler::traceLimit()) {
+            TraceEvent ev = {zone, start, duration};
+            buffer.trace.push_back(ev);
+        }
+    }
+
+    /**
+     * @brief Maps a duration to its log-linear histogram bucket.
+     * @param ticks The duration.
+     * @return The bucket index.
+     */
+    static inline int bucketOf(uint64_t ticks) {
+        if (ticks < 4) {
+            return static_cast<int>(ticks);
+        }
+        int exponent = 63 - __builtin_clzll(ticks);
+        int sub = static_cast<int>((ticks >> (exponent - 2)) & 3);
+        return (exponent - 1) * 4 + sub;
+    }
+
+private:
+    int zone;                       ///< Zone id.
+    ProfileThreadBuffer& buffer;    ///< The owning thread's buffer.
+    uint64_t start;                 ///< Tick at construction.
+};
+
+#endif
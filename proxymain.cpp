@@ -0,0 +1,224 @@
+#include <arpa/inet.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "tcpproxy.h"
+
+ //all doxygen comments are generated with AI assistance
+
+namespace {
+
+std::atomic<bool> interrupted(false); ///< Set by SIGINT in serve mode.
+
+void onSignal(int) {
+    interrupted = true;
+}
+
+/**
+ * @brief Parses "a.b.c.d:port" into a socket address.
+ * @param text The address to parse.
+ * @param out Receives the parsed address.
+ * @return True if the text was a valid address.
+ */
+bool parseEndpoint(const std::string& text, sockaddr_in& out) {
+    size_t colon = text.rfind(':');
+    if (colon == std::string::npos) {
+        return false;
+    }
+    std::memset(&out, 0, sizeof(out));
+    out.sin_family = AF_INET;
+    out.sin_port = htons(static_cast<uint16_t>(std::atoi(text.c_str() + colon + 1)));
+    return inet_pton(AF_INET, text.substr(0, colon).c_str(), &out.sin_addr) == 1;
+}
+
+/**
+ * @brief Opens one connection through the proxy, sends a payload and waits for the echo.
+ * @param target Proxy address.
+ * @param payload Bytes to send.
+ * @return Round-trip time in microseconds, or -1 on failure.
+ */
+long roundTrip(const sockaddr_in& target, const std::string& payload) {
+    auto start = std::chrono::steady_clock::now();
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    if (connect(fd, reinterpret_cast<const sockaddr*>(&target), sizeof(target)) < 0 ||
+        write(fd, payload.data(), payload.size()) != static_cast<ssize_t>(payload.size())) {
+        close(fd);
+        return -1;
+    }
+    char buf[4096];
+    size_t received = 0;
+    while (received < payload.size()) {
+        ssize_t n = read(fd, buf, sizeof(buf));
+        if (n <= 0) {
+            close(fd);
+            return -1;
+        }
+        received += static_cast<size_t>(n);
+    }
+    close(fd);
+    return static_cast<long>(std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start).count());
+}
+
+void usage() {
+    std::cerr << "Usage: tcp_proxy [--port P] [--loops N] [--pool N]\n"
+              << "                 [--backends N | --backend a.b.c.d:port ...]\n"
+              << "                 [--bench CONNECTIONS] [--clients N] [--payload BYTES]\n"
+              << "Without --bench the proxy serves until interrupted." << std::endl;
+}
+
+} // namespace
+
+/**
+ * @brief Entry point of the networked load balancer front end.
+ *
+ * Starts a TcpProxy in front of either real backends or local LoopbackBackend
+ * stand-ins. In bench mode it also drives a closed-loop client load and prints
+ * connections per second together with client- and proxy-side latencies.
+ *
+ * @return int Status code of the program (0 for success).
+ */
+int main(int argc, char* argv[]) {
+    TcpProxyConfig config;
+    int standIns = 0;
+    long benchConnections = 0;
+    int clients = 8;
+    size_t payloadBytes = 64;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--port" && hasValue) {
+            config.listenPort = static_cast<uint16_t>(std::atoi(argv[++i]));
+        } else if (arg == "--loops" && hasValue) {
+            config.numLoops = std::atoi(argv[++i]);
+        } else if (arg == "--pool" && hasValue) {
+            config.poolSize = std::atoi(argv[++i]);
+        } else if (arg == "--backends" && hasValue) {
+            standIns = std::atoi(argv[++i]);
+        } else if (arg == "--backend" && hasValue) {
+            sockaddr_in addr;
+            if (!parseEndpoint(argv[++i], addr)) {
+                std::cerr << "Invalid backend address: " << argv[i] << std::endl;
+                return 1;
+            }
+            config.backends.push_back(addr);
+        } else if (arg == "--bench" && hasValue) {
+            benchConnections = std::atol(argv[++i]);
+        } else if (arg == "--clients" && hasValue) {
+            clients = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--payload" && hasValue) {
+            payloadBytes = static_cast<size_t>(std::max(1, std::atoi(argv[++i])));
+        } else {
+            usage();
+            return 1;
+        }
+    }
+    if (config.backends.empty() && standIns == 0) {
+        standIns = 4;
+    }
+
+    std::vector<LoopbackBackend*> backends;
+    for (int i = 0; i < standIns; ++i) {
+        LoopbackBackend* backend = new LoopbackBackend();
+        if (!backend->start()) {
+            std::cerr << "Failed to start loopback backend" << std::endl;
+            return 1;
+        }
+        config.backends.push_back(backend->getAddress());
+        backends.push_back(backend);
+    }
+
+    TcpProxy proxy(config);
+    if (!proxy.start()) {
+        return 1;
+    }
+    std::cout << "Proxy listening on port " << config.listenPort << " with "
+              << config.backends.size() << " backends" << std::endl;
+
+    std::vector<long> clientLatencies;
+    double elapsedSeconds = 0.0;
+    long failures = 0;
+    if (benchConnections > 0) {
+        sockaddr_in target = {};
+        target.sin_family = AF_INET;
+        target.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        target.sin_port = htons(config.listenPort);
+        std::string payload(payloadBytes, 'x');
+
+        std::vector<std::vector<long> > perClient(clients);
+        std::atomic<long> failed(0);
+        std::vector<std::thread> workers;
+        auto start = std::chrono::steady_clock::now();
+        for (int c = 0; c < clients; ++c) {
+            long share = benchConnections / clients + (c < benchConnections % clients ? 1 : 0);
+            workers.emplace_back([&, c, share]() {
+                for (long k = 0; k < share; ++k) {
+                    long us = roundTrip(target, payload);
+                    if (us < 0) {
+                        failed++;
+                    } else {
+                        perClient[c].push_back(us);
+                    }
+                }
+            });
+        }
+        for (auto& w : workers) {
+            w.join();
+        }
+        elapsedSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        failures = failed;
+        for (const auto& v : perClient) {
+            clientLatencies.insert(clientLatencies.end(), v.begin(), v.end());
+        }
+    } else {
+        std::signal(SIGINT, onSignal);
+        std::signal(SIGTERM, onSignal);
+        while (!interrupted) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+    }
+
+    proxy.stop();
+    for (auto* backend : backends) {
+        backend->stop();
+        delete backend;
+    }
+
+    TcpProxyStats stats = proxy.getStats();
+    std::cout << "Proxy status:" << std::endl
+              << "  Connections accepted: " << stats.accepted << std::endl
+              << "  Rejected by blocklist: " << stats.rejected << std::endl
+              << "  Forwarded to backends: " << stats.forwarded << std::endl
+              << "  Warm connections reused after an empty session: " << stats.warmReuses << std::endl
+              << "  Bytes spliced: " << stats.bytesSpliced << std::endl
+              << "  Proxy latency p50/p99 (us): " << stats.p50LatencyUs << " / " << stats.p99LatencyUs << std::endl;
+
+    if (benchConnections > 0) {
+        std::sort(clientLatencies.begin(), clientLatencies.end());
+        size_t n = clientLatencies.size();
+        std::cout << "Benchmark:" << std::endl
+                  << "  Completed connections: " << n << " (" << failures << " failed)" << std::endl
+                  << "  Connections per second: " << (elapsedSeconds > 0 ? n / elapsedSeconds : 0.0) << std::endl;
+        if (n > 0) {
+            std::cout << "  Client round trip p50/p99 (us): " << clientLatencies[(n - 1) / 2]
+                      << " / " << clientLatencies[static_cast<size_t>((n - 1) * 0.99)] << std::endl;
+        }
+    }
+    return 0;
+}
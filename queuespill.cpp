@@ -0,0 +1,403 @@
+#include "queuespill.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <sys/mman.h>
+#include <unistd.h>
+
+static_assert(sizeof(SpillRecord) == 28, "SpillRecord layout changed");
+
+namespace {
+
+std::atomic<unsigned> spillInstances(0); ///< Numbers the spills of this process.
+
+/**
+ * @brief Converts a request to its on-disk record.
+ */
+SpillRecord toRecord(const Request& r) {
+    SpillRecord rec;
+    rec.ipIn = r.getIpInAddr();
+    rec.ipOut = r.getIpOutAddr();
+    rec.processTime = r.getProcessTime();
+    rec.arrivalTime = r.getArrivalTime();
+    rec.id = r.getId();
+    rec.dispatchTime = r.getDispatchTime();
+    rec.retries = static_cast<uint16_t>(r.getRetries());
+    rec.jobType = static_cast<uint8_t>(r.getJobType());
+    rec.flags = r.isHedgeCopy() ? 1 : 0;
+    return rec;
+}
+
+/**
+ * @brief Converts an on-disk record back to a request.
+ */
+Request fromRecord(const SpillRecord& rec) {
+    Request r(rec.ipIn, rec.ipOut, rec.processTime, static_cast<char>(rec.jobType), rec.arrivalTime);
+    r.setId(rec.id);
+    r.setDispatchTime(rec.dispatchTime);
+    r.setRetries(rec.retries);
+    r.setHedgeCopy((rec.flags & 1) != 0);
+    return r;
+}
+
+} // namespace
+
+/**
+ * @brief Constructs an unconfigured spill; append() fails until configure() is called.
+ */
+QueueSpill::QueueSpill()
+    : instance(spillInstances++) {}
+
+/**
+ * @brief Unmaps and deletes every segment file.
+ */
+QueueSpill::~QueueSpill() {
+    clear();
+}
+
+/**
+ * @brief Sets where segment files are created and how large they are.
+ *
+ * Takes effect for segments created afterwards.
+ *
+ * @param dir Directory for the segment files.
+ * @param records Records per segment file.
+ */
+void QueueSpill::configure(const std::string& dir, size_t records) {
+    directory = dir;
+    segmentRecords = records;
+}
+
+/**
+ * @brief Appends a request at the back.
+ *
+ * @param r The request.
+ * @return True on success, false if a segment could not be created or mapped.
+ */
+bool QueueSpill::append(const Request& r) {
+    if (segments.empty() || segments.back().end == segmentRecords) {
+        if (!addSegment()) {
+            return false;
+        }
+    }
+    Segment& back = segments.back();
+    if (!map(back, false)) {
+        return false;
+    }
+    back.records[back.end++] = toRecord(r);
+    count++;
+    spilled++;
+    return true;
+}
+
+/**
+ * @brief Inserts a request in front of every spilled request.
+ *
+ * Reading leaves room at the start of the front segment, which is filled
+ * backwards; when there is none, a new segment is put in front of it.
+ *
+ * @param r The request.
+ * @return True on success, false if a segment could not be created or mapped.
+ */
+bool QueueSpill::prepend(const Request& r) {
+    if (segments.empty() || segments.front().begin == 0) {
+        if (!addFrontSegment()) {
+            return false;
+        }
+    }
+    Segment& front = segments.front();
+    if (!map(front, true)) {
+        return false;
+    }
+    front.records[--front.begin] = toRecord(r);
+    count++;
+    spilled++;
+    return true;
+}
+
+/**
+ * @brief Moves the oldest requests to the back of a deque.
+ *
+ * A segment is deleted once it has been read completely, and the next one is
+ * mapped with sequential read-ahead straight away so its pages are on their
+ * way in before they are needed. A segment that cannot be mapped is read with
+ * pread instead; one that cannot be read at all is reported and dropped, so
+ * size() never counts requests that can no longer be read back.
+ *
+ * @param out Receives the requests in FIFO order.
+ * @param max Most requests to move.
+ * @return The number of requests moved.
+ */
+size_t QueueSpill::read(std::deque<Request, CountingAllocator<Request> >& out, size_t max) {
+    size_t moved = 0;
+    std::vector<SpillRecord> buffer;
+    while (moved < max && count > 0) {
+        Segment& front = segments.front();
+        if (map(front, true)) {
+            while (moved < max && front.begin < front.end) {
+                out.push_back(fromRecord(front.records[front.begin++]));
+                moved++;
+                count--;
+            }
+        } else {
+            const size_t n = std::min(max - moved, front.end - front.begin);
+            buffer.resize(n);
+            if (!readRecords(front, front.begin, buffer.data(), n)) {
+                std::cerr << "Dropping " << (front.end - front.begin) << " unreadable spilled requests" << std::endl;
+                count -= front.end - front.begin;
+                front.begin = front.end;
+            } else {
+                for (size_t i = 0; i < n; ++i) {
+                    out.push_back(fromRecord(buffer[i]));
+                }
+                front.begin += n;
+                moved += n;
+                count -= n;
+            }
+        }
+        if (front.begin == front.end && segments.size() > 1) {
+            destroy(front);
+            segments.pop_front();
+            map(segments.front(), true);
+        }
+    }
+    if (count == 0) {
+        clear();
+    }
+    return moved;
+}
+
+/**
+ * @brief Removes the newest request.
+ *
+ * @param out Receives the request.
+ * @return True if there was a request to remove.
+ */
+bool QueueSpill::takeNewest(Request& out) {
+    if (count == 0) {
+        return false;
+    }
+    Segment& back = segments.back();
+    if (map(back, false)) {
+        out = fromRecord(back.records[back.end - 1]);
+    } else {
+        SpillRecord rec;
+        if (!readRecords(back, back.end - 1, &rec, 1)) {
+            return false;
+        }
+        out = fromRecord(rec);
+    }
+    back.end--;
+    count--;
+    if (count == 0) {
+        clear();
+    } else if (back.begin == back.end) {
+        destroy(back);
+        segments.pop_back();
+    }
+    return true;
+}
+
+/**
+ * @brief Copies every spilled request, oldest first, without removing them.
+ *
+ * Reads the segment files directly, so segments that are not mapped stay
+ * unmapped.
+ *
+ * @param out Receives the requests.
+ */
+void QueueSpill::copyTo(std::vector<Request>& out) const {
+    std::vector<SpillRecord> buffer(4096);
+    for (const auto& segment : segments) {
+        for (size_t pos = segment.begin; pos < segment.end;) {
+            size_t n = std::min(buffer.size(), segment.end - pos);
+            if (!readRecords(segment, pos, buffer.data(), n)) {
+                return;
+            }
+            for (size_t i = 0; i < n; ++i) {
+                out.push_back(fromRecord(buffer[i]));
+            }
+            pos += n;
+        }
+    }
+}
+
+/**
+ * @brief Gets the number of spilled requests.
+ *
+ * @return The spilled request count.
+ */
+size_t QueueSpill::size() const {
+    return count;
+}
+
+/**
+ * @brief Deletes every spilled request and segment file.
+ */
+void QueueSpill::clear() {
+    for (auto& segment : segments) {
+        destroy(segment);
+    }
+    segments.clear();
+    count = 0;
+}
+
+/**
+ * @brief Gets the number of requests ever appended.
+ *
+ * @return The spilled request total.
+ */
+uint64_t QueueSpill::getSpilledRecords() const {
+    return spilled;
+}
+
+/**
+ * @brief Gets the most bytes held in segment files at once.
+ *
+ * @return The peak size of the live segments.
+ */
+uint64_t QueueSpill::getPeakBytes() const {
+    return peakBytes;
+}
+
+/**
+ * @brief Creates and maps a new segment at the back.
+ *
+ * The previous back segment is full; it is unmapped unless it is also being
+ * read, so at most two segments stay mapped.
+ *
+ * @return True on success, false if the file could not be created or mapped.
+ */
+bool QueueSpill::addSegment() {
+    Segment segment;
+    if (!createSegment(segment)) {
+        return false;
+    }
+    if (segments.size() > 1) {
+        unmap(segments.back());
+    }
+    segments.push_back(segment);
+    peakBytes = std::max<uint64_t>(peakBytes, segments.size() * segmentRecords * sizeof(SpillRecord));
+    return true;
+}
+
+/**
+ * @brief Creates a new, empty segment at the front that fills from its end.
+ *
+ * The old front segment is unmapped unless it is also being written, so at
+ * most two segments stay mapped.
+ *
+ * @return True on success, false if the file could not be created.
+ */
+bool QueueSpill::addFrontSegment() {
+    Segment segment;
+    if (!createSegment(segment)) {
+        return false;
+    }
+    segment.begin = segmentRecords;
+    segment.end = segmentRecords;
+    if (segments.size() > 1) {
+        unmap(segments.front());
+    }
+    segments.push_front(segment);
+    peakBytes = std::max<uint64_t>(peakBytes, segments.size() * segmentRecords * sizeof(SpillRecord));
+    return true;
+}
+
+/**
+ * @brief Creates and sizes a segment file.
+ *
+ * @param segment Receives the file name and descriptor.
+ * @return True on success, false if the file could not be created or sized.
+ */
+bool QueueSpill::createSegment(Segment& segment) {
+    if (segmentRecords == 0) {
+        return false;
+    }
+    segment.path = directory + "/lb_queue_" + std::to_string(getpid()) + "_" + std::to_string(instance) + "_" +
+                   std::to_string(nextSegment++) + ".spill";
+    segment.fd = open(segment.path.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+    if (segment.fd < 0) {
+        std::cerr << "Failed to create queue spill segment " << segment.path << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    if (ftruncate(segment.fd, static_cast<off_t>(segmentRecords * sizeof(SpillRecord))) < 0) {
+        std::cerr << "Failed to size queue spill segment " << segment.path << ": " << std::strerror(errno) << std::endl;
+        destroy(segment);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Maps a segment if it is not mapped.
+ *
+ * @param segment The segment.
+ * @param forReading Whether it is about to be read front to back (enables read-ahead).
+ * @return True if the segment is mapped.
+ */
+bool QueueSpill::map(Segment& segment, bool forReading) {
+    if (segment.records != nullptr) {
+        return true;
+    }
+    const size_t bytes = segmentRecords * sizeof(SpillRecord);
+    void* p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, segment.fd, 0);
+    if (p == MAP_FAILED) {
+        std::cerr << "Failed to map queue spill segment " << segment.path << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    if (forReading) {
+        madvise(p, bytes, MADV_SEQUENTIAL);
+        madvise(p, bytes, MADV_WILLNEED);
+    }
+    segment.records = static_cast<SpillRecord*>(p);
+    return true;
+}
+
+/**
+ * @brief Reads records from a segment file with pread, whether or not it is mapped.
+ *
+ * @param segment The segment.
+ * @param pos Index of the first record.
+ * @param dst Receives the records.
+ * @param n Number of records.
+ * @return True if all n records were read.
+ */
+bool QueueSpill::readRecords(const Segment& segment, size_t pos, SpillRecord* dst, size_t n) const {
+    const size_t bytes = n * sizeof(SpillRecord);
+    ssize_t got = pread(segment.fd, dst, bytes, static_cast<off_t>(pos * sizeof(SpillRecord)));
+    if (got != static_cast<ssize_t>(bytes)) {
+        std::cerr << "Failed to read queue spill segment: " << segment.path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Unmaps a segment, keeping its file.
+ *
+ * @param segment The segment.
+ */
+void QueueSpill::unmap(Segment& segment) {
+    if (segment.records != nullptr) {
+        munmap(segment.records, segmentRecords * sizeof(SpillRecord));
+        segment.records = nullptr;
+    }
+}
+
+/**
+ * @brief Unmaps, closes and deletes a segment file.
+ *
+ * @param segment The segment.
+ */
+void QueueSpill::destroy(Segment& segment) {
+    unmap(segment);
+    if (segment.fd >= 0) {
+        close(segment.fd);
+        unlink(segment.path.c_str());
+        segment.fd = -1;
+    }
+}
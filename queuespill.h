@@ -0,0 +1,204 @@
+/**
+ * @file queuespill.h
+ *
+ * This file contains the QueueSpill class, the disk tier of a RequestQueue:
+ * requests that do not fit in the queue's in-memory head are appended to a
+ * chain of memory-mapped segment files and read back in FIFO order.
+ *
+ * Segment file layout (host byte order, no header):
+ *
+ *     SpillRecord[segmentRecords]   28 bytes each, the file is sized up front
+ *
+ * SpillRecord (28 bytes):
+ *
+ *     0   uint32  ipIn          source address
+ *     4   uint32  ipOut         destination address
+ *     8   int32   processTime   service time in clock cycles
+ *     12  int32   arrivalTime   arrival cycle
+ *     16  uint32  id            request id
+ *     20  int32   dispatchTime  last dispatch cycle
+ *     24  uint16  retries       requeues after server failures
+ *     26  uint8   jobType       'P' or 'S'
+ *     27  uint8   flags         bit 0: hedge copy
+ *
+ * Only the segment being written and the segment being read are mapped, so
+ * the process holds at most two segments whatever the backlog; filled
+ * segments are unmapped and left to the page cache, and a segment is
+ * deleted as soon as it has been read back. Requests put back at the front of
+ * the queue fill the room reading left at the start of the front segment, or
+ * a new segment in front of it. A segment that cannot be mapped
+ * is read back with pread instead. Segment files live in a
+ * directory of the caller's choice and are removed when the spill empties
+ * or is destroyed.
+ */
+
+#ifndef QUEUESPILL_H
+#define QUEUESPILL_H
+
+#include "request.h"
+#include "memoryaccount.h"
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+
+ //all doxygen comments are generated with AI assistance
+
+/**
+ * @brief One spilled request as stored in a segment file.
+ */
+struct SpillRecord {
+    uint32_t ipIn;          ///< Source address in host byte order.
+    uint32_t ipOut;         ///< Destination address in host byte order.
+    int32_t processTime;    ///< Service time in clock cycles.
+    int32_t arrivalTime;    ///< Arrival cycle.
+    uint32_t id;            ///< Request id.
+    int32_t dispatchTime;   ///< Last dispatch cycle.
+    uint16_t retries;       ///< Requeues after server failures.
+    uint8_t jobType;        ///< 'P' or 'S'.
+    uint8_t flags;          ///< Bit 0: hedge copy.
+};
+
+/**
+ * @class QueueSpill
+ * @brief FIFO of requests stored in memory-mapped segment files.
+ */
+class QueueSpill {
+public:
+    /**
+     * @brief Constructs an unconfigured spill; append() fails until configure() is called.
+     */
+    QueueSpill();
+
+    /**
+     * @brief Unmaps and deletes every segment file.
+     */
+    ~QueueSpill();
+
+    QueueSpill(const QueueSpill&) = delete;
+    QueueSpill& operator=(const QueueSpill&) = delete;
+
+    /**
+     * @brief Sets where segment files are created and how large they are.
+     * @param directory Directory for the segment files.
+     * @param segmentRecords Records per segment file.
+     */
+    void configure(const std::string& directory, size_t segmentRecords);
+
+    /**
+     * @brief Appends a request at the back.
+     * @param r The request.
+     * @return True on success, false if a segment could not be created or mapped.
+     */
+    bool append(const Request& r);
+
+    /**
+     * @brief Inserts a request in front of every spilled request.
+     * @param r The request.
+     * @return True on success, false if a segment could not be created or mapped.
+     */
+    bool prepend(const Request& r);
+
+    /**
+     * @brief Moves the oldest requests to the back of a deque.
+     * @param out Receives the requests in FIFO order.
+     * @param max Most requests to move.
+     * @return The number of requests moved.
+     */
+    size_t read(std::deque<Request, CountingAllocator<Request> >& out, size_t max);
+
+    /**
+     * @brief Removes the newest request.
+     * @param out Receives the request.
+     * @return True if there was a request to remove.
+     */
+    bool takeNewest(Request& out);
+
+    /**
+     * @brief Copies every spilled request, oldest first, without removing them.
+     * @param out Receives the requests.
+     */
+    void copyTo(std::vector<Request>& out) const;
+
+    /**
+     * @brief Gets the number of spilled requests.
+     * @return The spilled request count.
+     */
+    size_t size() const;
+
+    /**
+     * @brief Deletes every spilled request and segment file.
+     */
+    void clear();
+
+    /**
+     * @brief Gets the number of requests ever appended.
+     * @return The spilled request total.
+     */
+    uint64_t getSpilledRecords() const;
+
+    /**
+     * @brief Gets the most bytes held in segment files at once.
+     * @return The peak size of the live segments.
+     */
+    uint64_t getPeakBytes() const;
+
+private:
+    /**
+     * @brief One segment file.
+     */
+    struct Segment {
+        std::string path;             ///< File name.
+        int fd = -1;                  ///< Open descriptor.
+        SpillRecord* records = nullptr; ///< Mapping, null while unmapped.
+        size_t begin = 0;             ///< First record not yet read back.
+        size_t end = 0;               ///< One past the last record written.
+    };
+
+    /**
+     * @brief Creates and maps a new segment at the back.
+     */
+    bool addSegment();
+
+    /**
+     * @brief Creates a new, empty segment at the front that fills from its end.
+     */
+    bool addFrontSegment();
+
+    /**
+     * @brief Creates and sizes a segment file.
+     */
+    bool createSegment(Segment& segment);
+
+    /**
+     * @brief Maps a segment if it is not mapped.
+     */
+    bool map(Segment& segment, bool forReading);
+
+    /**
+     * @brief Reads records from a segment file with pread, whether or not it is mapped.
+     */
+    bool readRecords(const Segment& segment, size_t pos, SpillRecord* dst, size_t n) const;
+
+    /**
+     * @brief Unmaps a segment, keeping its file.
+     */
+    void unmap(Segment& segment);
+
+    /**
+     * @brief Unmaps, closes and deletes a segment file.
+     */
+    void destroy(Segment& segment);
+
+    std::string directory;          ///< Where segment files are created.
+    size_t segmentRecords = 0;      ///< Records per segment, 0 while unconfigured.
+    unsigned instance;              ///< Distinguishes the spills of one process.
+    uint64_t nextSegment = 0;       ///< Sequence number of the next segment file.
+    std::deque<Segment> segments;   ///< Oldest first; reads from the front, writes to the back.
+    size_t count = 0;               ///< Spilled requests.
+    uint64_t spilled = 0;           ///< Requests ever appended.
+    uint64_t peakBytes = 0;         ///< Most bytes in live segments.
+};
+
+#endif
@@ -1,18 +1,20 @@
 #include "request.h"
+#include "ipv4.h"
 
 /**
  * @brief Default constructor for Request.
  * 
- * Initializes a Request object with default values: empty IP addresses,
+ * Initializes a Request object with default values: 0.0.0.0 addresses,
  * a processing time of 0, an undefined job type, and an arrival time of 0.
  */
-Request::Request() : ipIn(""), ipOut(""), processTime(0), jobType(' '), arrivalTime(0) {}
+Request::Request() : ipIn(0), ipOut(0), processTime(0), jobType(' '), arrivalTime(0) {}
 
 /**
  * @brief Parameterized constructor for Request.
  * 
  * Initializes a Request object with the specified input IP, output IP,
- * processing time, job type, and arrival time.
+ * processing time, job type, and arrival time. Addresses that are not valid
+ * dotted quads are stored as 0.0.0.0.
  * 
  * @param ip_in The input IP address for the request.
  * @param ip_out The output IP address for the request.
@@ -21,6 +23,21 @@ Request::Request() : ipIn(""), ipOut(""), processTime(0), jobType(' '), arrivalT
  * @param arrival The arrival time of the request.
  */
 Request::Request(const std::string& ip_in, const std::string& ip_out, int time, char type, int arrival)
+    : ipIn(0), ipOut(0), processTime(time), jobType(type), arrivalTime(arrival) {
+    parseIpv4(ip_in, ipIn);
+    parseIpv4(ip_out, ipOut);
+}
+
+/**
+ * @brief Constructs a Request from numeric addresses.
+ * 
+ * @param ip_in The input IP address in host byte order.
+ * @param ip_out The output IP address in host byte order.
+ * @param time The processing time for the request.
+ * @param type The job type (character P for processing, S for streaming).
+ * @param arrival The arrival time of the request.
+ */
+Request::Request(uint32_t ip_in, uint32_t ip_out, int time, char type, int arrival)
     : ipIn(ip_in), ipOut(ip_out), processTime(time), jobType(type), arrivalTime(arrival) {}
 
 /**
@@ -28,14 +45,46 @@ Request::Request(const std::string& ip_in, const std::string& ip_out, int time,
  * 
  * @return The input IP address as a string.
  */
-std::string Request::getIpIn() const { return ipIn; }
+std::string Request::getIpIn() const { return formatIpv4(ipIn); }
 
 /**
  * @brief Gets the output IP address of the request.
  * 
  * @return The output IP address as a string.
  */
-std::string Request::getIpOut() const { return ipOut; }
+std::string Request::getIpOut() const { return formatIpv4(ipOut); }
+
+/**
+ * @brief Gets the input IP address of the request as a number.
+ * 
+ * @return The input IP address in host byte order.
+ */
+uint32_t Request::getIpInAddr() const { return ipIn; }
+
+/**
+ * @brief Gets the output IP address of the request as a number.
+ * 
+ * @return The output IP address in host byte order.
+ */
+uint32_t Request::getIpOutAddr() const { return ipOut; }
+
+/**
+ * @brief Formats both addresses for a log line.
+ * 
+ * Both addresses are written straight into one string with the table-driven
+ * IPv4 formatter instead of going through two temporary strings.
+ * 
+ * @param separator Text placed between the input and output address.
+ * @return "<ipIn><separator><ipOut>".
+ */
+std::string Request::describeRoute(const char* separator) const {
+    std::string route;
+    route.reserve(2 * kIpv4MaxTextLength + 8);
+    appendIpv4(route, ipIn);
+    route += separator;
+    appendIpv4(route, ipOut);
+    return route;
+}
 
 /**
  * @brief Gets the processing time of the request.
@@ -57,3 +106,100 @@ char Request::getJobType() const { return jobType; }
  * @return The arrival time as an integer.
  */
 int Request::getArrivalTime() const { return arrivalTime; }
+
+/**
+ * @brief Gets the identifier the LoadBalancer assigned to the request.
+ * 
+ * @return The request id, 0 if none was assigned.
+ */
+uint32_t Request::getId() const { return id; }
+
+/**
+ * @brief Sets the request id.
+ * 
+ * @param requestId The new id.
+ */
+void Request::setId(uint32_t requestId) { id = requestId; }
+
+/**
+ * @brief Gets the time the request was last handed to a server.
+ * 
+ * @return The dispatch time in clock cycles.
+ */
+int Request::getDispatchTime() const { return dispatchTime; }
+
+/**
+ * @brief Sets the time the request was handed to a server.
+ * 
+ * @param time The dispatch time in clock cycles.
+ */
+void Request::setDispatchTime(int time) { dispatchTime = time; }
+
+/**
+ * @brief Gets how many times the request was requeued after a server failure.
+ * 
+ * @return The retry count.
+ */
+int Request::getRetries() const { return retries; }
+
+/**
+ * @brief Sets the retry count.
+ * 
+ * @param count The new retry count.
+ */
+void Request::setRetries(int count) { retries = count; }
+
+/**
+ * @brief Checks whether this is the duplicate of a hedged request.
+ * 
+ * @return True for the hedge copy, false for the original.
+ */
+bool Request::isHedgeCopy() const { return hedgeCopy; }
+
+/**
+ * @brief Marks the request as the duplicate of a hedged request.
+ * 
+ * @param copy True for the hedge copy.
+ */
+void Request::setHedgeCopy(bool copy) { hedgeCopy = copy; }
+
+/**
+ * @brief Gets the stage program of a pipelined request.
+ * 
+ * @return Up to four 4-bit steps, first step in the low bits; each step is a stage number plus 1, 0 ends the program.
+ */
+uint16_t Request::getStageProgram() const { return stageProgram; }
+
+/**
+ * @brief Sets the stage program and rewinds it to the first step.
+ * 
+ * @param program The packed program (see getStageProgram()).
+ */
+void Request::setStageProgram(uint16_t program) {
+    stageProgram = program;
+    stageStep = 0;
+}
+
+/**
+ * @brief Gets the stage of the current step of the program.
+ * 
+ * The program and its step live in what used to be padding, so a pipelined
+ * request is no larger than any other.
+ * 
+ * @return The stage number, -1 once the program has finished.
+ */
+int Request::getStage() const {
+    if (stageStep >= 4) {
+        return -1;
+    }
+    return static_cast<int>((stageProgram >> (4 * stageStep)) & 0xF) - 1;
+}
+
+/**
+ * @brief Moves the program on to its next step.
+ */
+void Request::advanceStage() {
+    if (stageStep < 4) {
+        stageStep++;
+    }
+}
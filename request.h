@@ -1,6 +1,7 @@
 #ifndef REQUEST_H
 #define REQUEST_H
 
+#include <cstdint>
 #include <string>
 
  //all doxygen comments are generated with AI assistance
@@ -11,6 +12,8 @@
  * 
  * The Request class encapsulates the details of a network request, including 
  * the input and output IP addresses, processing time, job type, and arrival time.
+ * Addresses are stored as host-order 32-bit integers and only turned into
+ * text when a caller asks for it.
  */
 class Request {
 public:
@@ -35,6 +38,17 @@ public:
      */
     Request(const std::string& ip_in, const std::string& ip_out, int time, char type, int arrival);
 
+    /**
+     * @brief Constructs a Request from numeric addresses.
+     * 
+     * @param ip_in The input IP address in host byte order.
+     * @param ip_out The output IP address in host byte order.
+     * @param time The processing time for the request.
+     * @param type The job type (character P for processing, S for streaming).
+     * @param arrival The arrival time of the request.
+     */
+    Request(uint32_t ip_in, uint32_t ip_out, int time, char type, int arrival);
+
     /**
      * @brief Gets the input IP address of the request.
      * 
@@ -49,6 +63,27 @@ public:
      */
     std::string getIpOut() const;
 
+    /**
+     * @brief Gets the input IP address of the request as a number.
+     * 
+     * @return The input IP address in host byte order.
+     */
+    uint32_t getIpInAddr() const;
+
+    /**
+     * @brief Gets the output IP address of the request as a number.
+     * 
+     * @return The output IP address in host byte order.
+     */
+    uint32_t getIpOutAddr() const;
+
+    /**
+     * @brief Formats both addresses for a log line.
+     * @param separator Text placed between the input and output address.
+     * @return "<ipIn><separator><ipOut>".
+     */
+    std::string describeRoute(const char* separator) const;
+
     /**
      * @brief Gets the processing time of the request.
      * 
@@ -70,12 +105,89 @@ public:
      */
     int getArrivalTime() const;
 
+    /**
+     * @brief Gets the identifier the LoadBalancer assigned to the request.
+     * @return The request id, 0 if none was assigned.
+     */
+    uint32_t getId() const;
+
+    /**
+     * @brief Sets the request id.
+     * @param requestId The new id.
+     */
+    void setId(uint32_t requestId);
+
+    /**
+     * @brief Gets the time the request was last handed to a server.
+     * @return The dispatch time in clock cycles.
+     */
+    int getDispatchTime() const;
+
+    /**
+     * @brief Sets the time the request was handed to a server.
+     * @param time The dispatch time in clock cycles.
+     */
+    void setDispatchTime(int time);
+
+    /**
+     * @brief Gets how many times the request was requeued after a server failure.
+     * @return The retry count.
+     */
+    int getRetries() const;
+
+    /**
+     * @brief Sets the retry count.
+     * @param count The new retry count.
+     */
+    void setRetries(int count);
+
+    /**
+     * @brief Checks whether this is the duplicate of a hedged request.
+     * @return True for the hedge copy, false for the original.
+     */
+    bool isHedgeCopy() const;
+
+    /**
+     * @brief Marks the request as the duplicate of a hedged request.
+     * @param copy True for the hedge copy.
+     */
+    void setHedgeCopy(bool copy);
+
+    /**
+     * @brief Gets the stage program of a pipelined request.
+     * @return Up to four 4-bit steps, first step in the low bits; each step is a stage number plus 1, 0 ends the program.
+     */
+    uint16_t getStageProgram() const;
+
+    /**
+     * @brief Sets the stage program and rewinds it to the first step.
+     * @param program The packed program (see getStageProgram()).
+     */
+    void setStageProgram(uint16_t program);
+
+    /**
+     * @brief Gets the stage of the current step of the program.
+     * @return The stage number, -1 once the program has finished.
+     */
+    int getStage() const;
+
+    /**
+     * @brief Moves the program on to its next step.
+     */
+    void advanceStage();
+
 private:
-    std::string ipIn;        ///< The input IP address for the request.
-    std::string ipOut;       ///< The output IP address for the request.
+    uint32_t ipIn;           ///< The input IP address for the request (host byte order).
+    uint32_t ipOut;          ///< The output IP address for the request (host byte order).
     int processTime;         ///< The processing time for the request.
     char jobType;            ///< The job type (P for processing, S for streaming).
+    uint8_t stageStep = 0;   ///< Current step of the stage program (fills the padding after jobType).
+    uint16_t stageProgram = 0; ///< Packed stage program of a pipelined request, 0 for none.
     int arrivalTime;         ///< The arrival time of the request.
+    uint32_t id = 0;         ///< Identifier shared by all copies of the request.
+    int dispatchTime = 0;    ///< When the request was last handed to a server.
+    int retries = 0;         ///< Requeues after server failures.
+    bool hedgeCopy = false;  ///< Whether this is the duplicate of a hedged request.
 };
 
 #endif
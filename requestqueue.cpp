@@ -1,4 +1,15 @@
 #include "requestqueue.h"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+
+/**
+ * @brief Constructs an empty queue that keeps every request in memory.
+ */
+RequestQueue::RequestQueue()
+    : queue(CountingAllocator<Request>(&memory)) {}
 
 /**
  * @brief Adds a request to the queue.
@@ -8,7 +19,83 @@
  * @param r The request to be added to the queue.
  */
 void RequestQueue::addRequest(const Request& r) {
-    queue.push(r);
+    if (memoryLimit == 0 || (spill.size() == 0 && queue.size() < memoryLimit)) {
+        queue.push_back(r);
+    } else if (!spill.append(r)) {
+        // keep FIFO order: bring everything back and stop spilling
+        std::cerr << "Queue spill failed, keeping the queue in memory" << std::endl;
+        spill.read(queue, spill.size());
+        memoryLimit = 0;
+        queue.push_back(r);
+    }
+}
+
+/**
+ * @brief Puts a request back at the head of the queue.
+ * 
+ * With a memory bound, the newest request of a full head moves to the front
+ * of the spill to make room.
+ * 
+ * @param r The request to be requeued.
+ */
+void RequestQueue::addRequestFront(const Request& r) {
+    queue.push_front(r);
+    trimHead();
+}
+
+/**
+ * @brief Adds several requests to the back of the queue, in order.
+ * 
+ * Without a memory bound this is one bulk insert into the head.
+ * 
+ * @param requests The requests.
+ * @param count Number of requests.
+ */
+void RequestQueue::addRequests(const Request* requests, size_t count) {
+    if (memoryLimit == 0) {
+        queue.insert(queue.end(), requests, requests + count);
+        return;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        addRequest(requests[i]);
+    }
+}
+
+/**
+ * @brief Removes up to max requests from the head of the queue.
+ * 
+ * Requests are copied out and erased a block at a time; spilled requests are
+ * paged back in between blocks as the head drains.
+ * 
+ * @param out Receives the requests in FIFO order.
+ * @param max Most requests to remove.
+ * @return The number of requests removed.
+ */
+size_t RequestQueue::takeRequests(std::vector<Request>& out, size_t max) {
+    peakLength = std::max(peakLength, queue.size());
+    size_t taken = 0;
+    while (taken < max && !queue.empty()) {
+        const size_t n = std::min(max - taken, queue.size());
+        out.insert(out.end(), queue.begin(), queue.begin() + n);
+        queue.erase(queue.begin(), queue.begin() + n);
+        taken += n;
+        refill();
+    }
+    return taken;
+}
+
+/**
+ * @brief Puts requests taken by takeRequests() back at the head, in order.
+ * 
+ * With a memory bound, whatever no longer fits in the head moves to the
+ * front of the spill.
+ * 
+ * @param requests The requests, the next one first.
+ * @param count Number of requests.
+ */
+void RequestQueue::returnRequests(const Request* requests, size_t count) {
+    queue.insert(queue.begin(), requests, requests + count);
+    trimHead();
 }
 
 /**
@@ -22,12 +109,33 @@ void RequestQueue::addRequest(const Request& r) {
 Request RequestQueue::getRequest() {
     if (!queue.empty()) {
         Request r = queue.front();
-        queue.pop();
+        queue.pop_front();
+        refill();
         return r;
     }
     return Request(); // Return a default-constructed Request if the queue is empty.
 }
 
+/**
+ * @brief Retrieves and removes the newest request (the back of the queue).
+ * 
+ * The newest request is on disk whenever anything is. If the queue is empty, it returns a default-constructed Request object.
+ * 
+ * @return The request at the back of the queue, or a default Request if the queue is empty.
+ */
+Request RequestQueue::getNewestRequest() {
+    Request spilled;
+    if (spill.takeNewest(spilled)) {
+        return spilled;
+    }
+    if (!queue.empty()) {
+        Request r = queue.back();
+        queue.pop_back();
+        return r;
+    }
+    return Request();
+}
+
 /**
  * @brief Checks if the queue is empty.
  * 
@@ -36,7 +144,7 @@ Request RequestQueue::getRequest() {
  * @return True if the queue is empty, false otherwise.
  */
 bool RequestQueue::isEmpty() const {
-    return queue.empty();
+    return queue.empty(); // the head is only empty when nothing is spilled
 }
 
 /**
@@ -47,5 +155,139 @@ bool RequestQueue::isEmpty() const {
  * @return The number of requests in the queue.
  */
 size_t RequestQueue::size() const {
-    return queue.size();
+    return queue.size() + spill.size();
+}
+
+/**
+ * @brief Gets the next request without removing it.
+ * 
+ * @return The request at the front of the queue (the queue must not be empty).
+ */
+const Request& RequestQueue::front() const {
+    return queue.front();
+}
+
+/**
+ * @brief Copies the queued requests in FIFO order without removing them.
+ * 
+ * @param out Receives the requests, the next request first.
+ */
+void RequestQueue::copyTo(std::vector<Request>& out) const {
+    out.reserve(out.size() + size());
+    out.insert(out.end(), queue.begin(), queue.end());
+    spill.copyTo(out);
+}
+
+/**
+ * @brief Removes every request from the queue.
+ */
+void RequestQueue::clear() {
+    queue.clear();
+    spill.clear();
+}
+
+/**
+ * @brief Bounds the in-memory part of the queue and spills the rest to disk.
+ * 
+ * Spill segments hold 64K requests (1.75 MB) each. Call this before the
+ * queue fills up; requests already queued stay in memory.
+ * 
+ * @param limit Requests kept in memory, 0 to keep every request in memory.
+ * @param directory Directory for the spill segment files.
+ */
+void RequestQueue::setSpill(size_t limit, const std::string& directory) {
+    memoryLimit = limit;
+    spill.configure(directory, 65536);
+}
+
+/**
+ * @brief Checks whether the queue spills to disk.
+ * 
+ * @return True after setSpill() with a non-zero limit.
+ */
+bool RequestQueue::isSpilling() const {
+    return memoryLimit > 0;
+}
+
+/**
+ * @brief Describes how much was spilled and what paging it back in cost.
+ * 
+ * A stall is a refill the dispatcher had to wait for because the in-memory
+ * head had run dry.
+ * 
+ * @return One report line.
+ */
+std::string RequestQueue::describeSpill() const {
+    const uint64_t records = spill.getSpilledRecords();
+    std::ostringstream ss;
+    ss << std::fixed << std::setprecision(1)
+       << "Queue spill: " << records << " requests (" << records * sizeof(SpillRecord) / 1e6 << " MB) spilled, peak "
+       << spill.getPeakBytes() / 1e6 << " MB on disk, " << refills << " refills (" << std::setprecision(3)
+       << refillSeconds * 1000.0 << " ms, max " << maxRefillSeconds * 1000.0 << " ms), " << stalls << " stalls ("
+       << stallSeconds * 1000.0 << " ms)";
+    return ss.str();
+}
+
+/**
+ * @brief Gets the memory held by the in-memory head.
+ * 
+ * @return Current and peak bytes and allocations of the head's storage.
+ */
+const MemoryAccount& RequestQueue::getMemory() const {
+    return memory;
+}
+
+/**
+ * @brief Gets the most requests the in-memory head has held at once.
+ * 
+ * @return The peak head length.
+ */
+size_t RequestQueue::getPeakLength() const {
+    return std::max(peakLength, queue.size());
+}
+
+/**
+ * @brief Pages spilled requests back in once the head has drained to a quarter.
+ * 
+ * Refilling in large batches before the head runs dry keeps the page-in off
+ * the dispatch path; the segment being read is already mapped with read-ahead.
+ * The spill falls back to pread when a segment cannot be mapped and drops
+ * (and reports) records it cannot read, so the head is only left empty once
+ * nothing is spilled.
+ */
+void RequestQueue::refill() {
+    if (spill.size() == 0 || queue.size() > memoryLimit / 4) {
+        return;
+    }
+    const bool stalled = queue.empty();
+    const auto start = std::chrono::steady_clock::now();
+    spill.read(queue, memoryLimit - queue.size());
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    refills++;
+    refillSeconds += seconds;
+    maxRefillSeconds = std::max(maxRefillSeconds, seconds);
+    if (stalled) {
+        stalls++;
+        stallSeconds += seconds;
+    }
+}
+
+/**
+ * @brief Moves the newest requests of an over-full head to the front of the spill.
+ * 
+ * Requests put back at the head can take it past the memory bound; the ones
+ * at its back are the next to be read after it, so they go in front of
+ * everything already spilled and FIFO order holds. If the spill fails the
+ * queue stops spilling, as in addRequest().
+ */
+void RequestQueue::trimHead() {
+    while (memoryLimit > 0 && queue.size() > memoryLimit) {
+        if (!spill.prepend(queue.back())) {
+            std::cerr << "Queue spill failed, keeping the queue in memory" << std::endl;
+            spill.read(queue, spill.size());
+            memoryLimit = 0;
+            return;
+        }
+        queue.pop_back();
+    }
 }
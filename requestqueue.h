@@ -2,7 +2,11 @@
 #define REQUESTQUEUE_H
 
 #include "request.h"
-#include <queue>
+#include "queuespill.h"
+#include "memoryaccount.h"
+#include <deque>
+#include <string>
+#include <vector>
 
  //all doxygen comments are generated with AI assistance
 
@@ -12,9 +16,18 @@
  * 
  * The RequestQueue class manages a queue of Request objects, allowing 
  * requests to be added, retrieved, and checked for size and emptiness.
+ *
+ * By default every request is kept in memory. With setSpill() only a bounded
+ * head stays in memory; once it is full, later requests are appended to a
+ * QueueSpill on disk and paged back in, in order, as the head drains.
  */
 class RequestQueue {
 public:
+    /**
+     * @brief Constructs an empty queue that keeps every request in memory.
+     */
+    RequestQueue();
+
     /**
      * @brief Adds a request to the queue.
      * 
@@ -23,6 +36,40 @@ public:
      * @param r The request to be added to the queue.
      */
     void addRequest(const Request& r);
+
+    /**
+     * @brief Puts a request back at the head of the queue.
+     * 
+     * Used for retries, so a request that already waited is served next.
+     * 
+     * @param r The request to be requeued.
+     */
+    void addRequestFront(const Request& r);
+
+    /**
+     * @brief Adds several requests to the back of the queue, in order.
+     * 
+     * @param requests The requests.
+     * @param count Number of requests.
+     */
+    void addRequests(const Request* requests, size_t count);
+
+    /**
+     * @brief Removes up to max requests from the head of the queue.
+     * 
+     * @param out Receives the requests in FIFO order.
+     * @param max Most requests to remove.
+     * @return The number of requests removed.
+     */
+    size_t takeRequests(std::vector<Request>& out, size_t max);
+
+    /**
+     * @brief Puts requests taken by takeRequests() back at the head, in order.
+     * 
+     * @param requests The requests, the next one first.
+     * @param count Number of requests.
+     */
+    void returnRequests(const Request* requests, size_t count);
     
     /**
      * @brief Retrieves and removes a request from the queue.
@@ -32,6 +79,13 @@ public:
      * @return The request at the front of the queue.
      */
     Request getRequest();
+
+    /**
+     * @brief Retrieves and removes the newest request (the back of the queue).
+     * 
+     * @return The request at the back of the queue.
+     */
+    Request getNewestRequest();
     
     /**
      * @brief Checks if the queue is empty.
@@ -51,8 +105,86 @@ public:
      */
     size_t size() const;
 
+    /**
+     * @brief Gets the next request without removing it.
+     * 
+     * @return The request at the front of the queue (the queue must not be empty).
+     */
+    const Request& front() const;
+
+    /**
+     * @brief Copies the queued requests in FIFO order without removing them.
+     * 
+     * Used to checkpoint the queue; spilled requests are read from disk.
+     * 
+     * @param out Receives the requests, the next request first.
+     */
+    void copyTo(std::vector<Request>& out) const;
+
+    /**
+     * @brief Removes every request from the queue.
+     */
+    void clear();
+
+    /**
+     * @brief Bounds the in-memory part of the queue and spills the rest to disk.
+     * 
+     * @param memoryLimit Requests kept in memory, 0 to keep every request in memory.
+     * @param directory Directory for the spill segment files.
+     */
+    void setSpill(size_t memoryLimit, const std::string& directory);
+
+    /**
+     * @brief Checks whether the queue spills to disk.
+     * 
+     * @return True after setSpill() with a non-zero limit.
+     */
+    bool isSpilling() const;
+
+    /**
+     * @brief Describes how much was spilled and what paging it back in cost.
+     * 
+     * @return One report line.
+     */
+    std::string describeSpill() const;
+
+    /**
+     * @brief Gets the memory held by the in-memory head.
+     * 
+     * @return Current and peak bytes and allocations of the head's storage.
+     */
+    const MemoryAccount& getMemory() const;
+
+    /**
+     * @brief Gets the most requests the in-memory head has held at once.
+     * 
+     * Sampled when requests are taken, so it can miss a peak by one batch.
+     * 
+     * @return The peak head length.
+     */
+    size_t getPeakLength() const;
+
 private:
-    std::queue<Request> queue; ///< The underlying queue storing Request objects.
+    /**
+     * @brief Pages spilled requests back in once the head has drained to a quarter.
+     */
+    void refill();
+
+    /**
+     * @brief Moves the newest requests of an over-full head to the front of the spill.
+     */
+    void trimHead();
+
+    MemoryAccount memory;       ///< Storage of the head; declared before the head, which charges it.
+    std::deque<Request, CountingAllocator<Request> > queue;  ///< The in-memory head (all requests when not spilling).
+    size_t peakLength = 0;      ///< Most requests the head has held at once.
+    QueueSpill spill;           ///< Requests behind the head, on disk.
+    size_t memoryLimit = 0;     ///< Head capacity, 0 when not spilling.
+    uint64_t refills = 0;       ///< Batches paged back in.
+    uint64_t stalls = 0;        ///< Refills that found the head empty.
+    double refillSeconds = 0.0; ///< Time spent paging back in.
+    double maxRefillSeconds = 0.0; ///< Longest single refill.
+    double stallSeconds = 0.0;  ///< Part of it spent while the head was empty.
 };
 
 #endif
@@ -0,0 +1,379 @@
+#include "snapshot.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+namespace {
+
+const uint64_t kSectionAlign = 64; ///< Alignment of every section in the file.
+
+uint64_t alignUp(uint64_t offset) {
+    return (offset + kSectionAlign - 1) & ~(kSectionAlign - 1);
+}
+
+/**
+ * @brief Converts a Request to its fixed-size record.
+ */
+SnapshotRequest toRecord(const Request& r) {
+    SnapshotRequest rec;
+    std::memset(&rec, 0, sizeof(rec));
+    rec.ipIn = r.getIpInAddr();
+    rec.ipOut = r.getIpOutAddr();
+    rec.processTime = r.getProcessTime();
+    rec.arrivalTime = r.getArrivalTime();
+    rec.id = r.getId();
+    rec.dispatchTime = r.getDispatchTime();
+    rec.retries = r.getRetries();
+    rec.jobType = static_cast<uint8_t>(r.getJobType());
+    rec.hedgeCopy = r.isHedgeCopy() ? 1 : 0;
+    return rec;
+}
+
+/**
+ * @brief Converts a fixed-size record back to a Request.
+ */
+Request fromRecord(const SnapshotRequest& rec) {
+    if (rec.jobType == ' ') {
+        return Request();
+    }
+    Request r(rec.ipIn, rec.ipOut, rec.processTime, static_cast<char>(rec.jobType), rec.arrivalTime);
+    r.setId(rec.id);
+    r.setDispatchTime(rec.dispatchTime);
+    r.setRetries(rec.retries);
+    r.setHedgeCopy(rec.hedgeCopy != 0);
+    return r;
+}
+
+/**
+ * @brief Converts a WebServer to its fixed-size record.
+ */
+SnapshotServer toRecord(const WebServer& s) {
+    SnapshotServer rec;
+    std::memset(&rec, 0, sizeof(rec));
+    rec.current = toRecord(s.getCurrentRequest());
+    rec.startTime = s.getRequestStartTime();
+    rec.processedCount = s.getProcessedRequestCount();
+    rec.name = static_cast<uint8_t>(s.getName());
+    const StreamState& sharing = s.getStreamState();
+    rec.active = s.getConcurrency() > static_cast<int>(sharing.streams.size()) ? 1 : 0; // the exclusive request
+    rec.streamSlots = sharing.slots;
+    rec.peakConcurrency = sharing.peakConcurrency;
+    rec.streamCount = static_cast<uint32_t>(sharing.streams.size());
+    rec.virtualTime = sharing.virtualTime;
+    rec.clock = sharing.clock;
+    rec.jobCycles = sharing.jobCycles;
+    rec.nextSequence = sharing.nextSequence;
+    const FaultState& fault = s.getFaultState();
+    rec.crashed = fault.crashed ? 1 : 0;
+    rec.ejected = fault.ejected ? 1 : 0;
+    rec.slowFactor = fault.slowFactor;
+    rec.recoverAt = fault.recoverAt;
+    rec.failedChecks = fault.failedChecks;
+    rec.lostCount = static_cast<uint32_t>(fault.lost.size());
+    rec.exclusiveLag = fault.exclusiveLag;
+    return rec;
+}
+
+/**
+ * @brief Converts a fixed-size record, its streams and its lost requests back to a WebServer.
+ */
+WebServer fromRecord(const SnapshotServer& rec, const SnapshotStream* streams) {
+    WebServer s(static_cast<char>(rec.name));
+    s.restoreState(fromRecord(rec.current), rec.startTime, rec.active != 0, rec.processedCount);
+    StreamState sharing;
+    sharing.slots = rec.streamSlots;
+    sharing.peakConcurrency = rec.peakConcurrency;
+    sharing.virtualTime = rec.virtualTime;
+    sharing.clock = rec.clock;
+    sharing.jobCycles = rec.jobCycles;
+    sharing.nextSequence = rec.nextSequence;
+    for (uint32_t i = 0; i < rec.streamCount; ++i) {
+        StreamJob job = {streams[i].finishTag, streams[i].sequence, fromRecord(streams[i].request)};
+        sharing.streams.push_back(job);
+    }
+    s.restoreStreamState(sharing);
+    FaultState fault;
+    fault.crashed = rec.crashed != 0;
+    fault.ejected = rec.ejected != 0;
+    fault.slowFactor = rec.slowFactor;
+    fault.recoverAt = rec.recoverAt;
+    fault.failedChecks = rec.failedChecks;
+    fault.exclusiveLag = rec.exclusiveLag;
+    for (uint32_t i = 0; i < rec.lostCount; ++i) {
+        fault.lost.push_back(fromRecord(streams[rec.streamCount + i].request));
+    }
+    s.restoreFaultState(fault);
+    return s;
+}
+
+/**
+ * @brief Counts the stream-section records (streams and lost requests) of a group of servers.
+ */
+uint64_t countStreams(const std::vector<WebServer>& servers) {
+    uint64_t count = 0;
+    for (const auto& s : servers) {
+        count += s.getStreamState().streams.size() + s.getFaultState().lost.size();
+    }
+    return count;
+}
+
+/**
+ * @brief Appends the streams of a group of servers, each server's heap as stored, then its lost requests.
+ */
+void writeStreams(std::ofstream& out, const std::vector<WebServer>& servers) {
+    for (const auto& s : servers) {
+        for (const auto& job : s.getStreamState().streams) {
+            SnapshotStream rec;
+            std::memset(&rec, 0, sizeof(rec));
+            rec.request = toRecord(job.request);
+            rec.finishTag = job.finishTag;
+            rec.sequence = job.sequence;
+            out.write(reinterpret_cast<const char*>(&rec), sizeof(rec));
+        }
+        for (const auto& req : s.getFaultState().lost) {
+            SnapshotStream rec;
+            std::memset(&rec, 0, sizeof(rec));
+            rec.request = toRecord(req);
+            out.write(reinterpret_cast<const char*>(&rec), sizeof(rec));
+        }
+    }
+}
+
+/**
+ * @brief Rebuilds a group of servers, taking their streams and lost requests from the stream section in order.
+ * @return False if the servers claim more streams than the section holds.
+ */
+bool readServers(const SnapshotServer* saved, uint64_t count, const SnapshotStream* streams,
+                 uint64_t streamCount, uint64_t& streamCursor, std::vector<WebServer>& out) {
+    out.clear();
+    for (uint64_t i = 0; i < count; ++i) {
+        uint64_t records = static_cast<uint64_t>(saved[i].streamCount) + saved[i].lostCount;
+        if (records > streamCount - streamCursor) {
+            return false;
+        }
+        out.push_back(fromRecord(saved[i], streams + streamCursor));
+        streamCursor += records;
+    }
+    return true;
+}
+
+/**
+ * @brief Writes zero bytes until the stream reaches the given offset.
+ */
+void padTo(std::ofstream& out, uint64_t offset) {
+    static const char zeros[kSectionAlign] = {};
+    uint64_t pos = static_cast<uint64_t>(out.tellp());
+    if (offset > pos) {
+        out.write(zeros, static_cast<std::streamsize>(offset - pos));
+    }
+}
+
+/**
+ * @brief Writes a section of fixed-size server records.
+ */
+void writeServers(std::ofstream& out, uint64_t offset, const std::vector<WebServer>& servers) {
+    padTo(out, offset);
+    for (const auto& s : servers) {
+        SnapshotServer rec = toRecord(s);
+        out.write(reinterpret_cast<const char*>(&rec), sizeof(rec));
+    }
+}
+
+} // namespace
+
+/**
+ * @brief Writes a snapshot file.
+ *
+ * Section offsets are computed up front so the header can be written first
+ * and every section lands on a 64-byte boundary.
+ *
+ * @param path Destination file, overwritten if it exists.
+ * @param loadBalancer The balancer whose clock, counters and queue are saved.
+ * @param servers The simulation's servers.
+ * @param rng The random number generator driving the simulation.
+ * @param stats Driver statistics.
+ * @param faults The fault injector whose counts are saved.
+ * @return True on success, false otherwise.
+ */
+bool Snapshot::save(const std::string& path, const LoadBalancer& loadBalancer,
+                    const std::vector<WebServer>& servers, const std::mt19937& rng,
+                    const SimulationStats& stats, const FaultInjector& faults) {
+    std::ostringstream rngText;
+    rngText << rng;
+    const std::string rngState = rngText.str();
+    std::vector<Request> queued;
+    loadBalancer.getRequestQueue().copyTo(queued);
+    const std::vector<WebServer>& fleet = loadBalancer.getServers();
+    const ResilienceStats resilience = loadBalancer.getResilienceStats();
+    const std::vector<uint64_t>& latency = resilience.latency.getBuckets();
+    const std::vector<uint64_t>& hedgeless = resilience.latencyWithoutHedging.getBuckets();
+
+    SnapshotHeader h;
+    std::memset(&h, 0, sizeof(h));
+    std::memcpy(h.magic, kSnapshotMagic, sizeof(h.magic));
+    h.version = kSnapshotVersion;
+    h.headerSize = sizeof(SnapshotHeader);
+    h.clock = loadBalancer.getTime();
+    h.processedRequests = loadBalancer.getProcessedRequests();
+    h.rejectedRequests = loadBalancer.getRejectedRequests();
+    h.serverIndex = loadBalancer.getCurrentServerIndex();
+    h.minProcessTime = stats.minProcessTime;
+    h.maxProcessTime = stats.maxProcessTime;
+    h.rngOffset = alignUp(sizeof(SnapshotHeader));
+    h.rngBytes = rngState.size();
+    h.queueOffset = alignUp(h.rngOffset + h.rngBytes);
+    h.queueCount = queued.size();
+    h.serverOffset = alignUp(h.queueOffset + h.queueCount * sizeof(SnapshotRequest));
+    h.serverCount = servers.size();
+    h.fleetOffset = alignUp(h.serverOffset + h.serverCount * sizeof(SnapshotServer));
+    h.fleetCount = fleet.size();
+    h.streamOffset = alignUp(h.fleetOffset + h.fleetCount * sizeof(SnapshotServer));
+    h.streamCount = countStreams(servers) + countStreams(fleet);
+    h.ejections = resilience.ejections;
+    h.requeued = resilience.requeued;
+    h.failedRequests = resilience.failedRequests;
+    h.hedges = resilience.hedges;
+    h.hedgeWins = resilience.hedgeWins;
+    h.crashes = faults.getCrashes();
+    h.slowdowns = faults.getSlowdowns();
+    h.cancelledWork = resilience.cancelledWork;
+    h.latencyOffset = alignUp(h.streamOffset + h.streamCount * sizeof(SnapshotStream));
+    h.latencyBuckets = latency.size();
+    h.hedgelessOffset = alignUp(h.latencyOffset + h.latencyBuckets * sizeof(uint64_t));
+    h.hedgelessBuckets = hedgeless.size();
+
+    std::ofstream out(path.c_str(), std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) {
+        std::cerr << "Failed to open snapshot file: " << path << std::endl;
+        return false;
+    }
+    out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+    padTo(out, h.rngOffset);
+    out.write(rngState.data(), static_cast<std::streamsize>(rngState.size()));
+
+    padTo(out, h.queueOffset);
+    std::vector<SnapshotRequest> block;
+    block.reserve(4096);
+    for (const auto& r : queued) {
+        block.push_back(toRecord(r));
+        if (block.size() == block.capacity()) {
+            out.write(reinterpret_cast<const char*>(block.data()), static_cast<std::streamsize>(block.size() * sizeof(SnapshotRequest)));
+            block.clear();
+        }
+    }
+    out.write(reinterpret_cast<const char*>(block.data()), static_cast<std::streamsize>(block.size() * sizeof(SnapshotRequest)));
+
+    writeServers(out, h.serverOffset, servers);
+    writeServers(out, h.fleetOffset, fleet);
+    padTo(out, h.streamOffset);
+    writeStreams(out, servers);
+    writeStreams(out, fleet);
+    padTo(out, h.latencyOffset);
+    out.write(reinterpret_cast<const char*>(latency.data()), static_cast<std::streamsize>(latency.size() * sizeof(uint64_t)));
+    padTo(out, h.hedgelessOffset);
+    out.write(reinterpret_cast<const char*>(hedgeless.data()), static_cast<std::streamsize>(hedgeless.size() * sizeof(uint64_t)));
+    return out.good();
+}
+
+/**
+ * @brief Maps a snapshot file and restores the simulation from it.
+ *
+ * The file is mapped read-only and every section is validated against the
+ * file size before it is touched, so a truncated file is rejected instead of
+ * faulting.
+ *
+ * @param path Snapshot file to read.
+ * @param loadBalancer Receives clock, counters, queue and autoscaler servers.
+ * @param servers Replaced with the saved simulation servers.
+ * @param rng Receives the saved generator state.
+ * @param stats Receives the saved driver statistics.
+ * @param faults Receives the saved fault counts.
+ * @return True on success, false if the file is missing or incompatible.
+ */
+bool Snapshot::restore(const std::string& path, LoadBalancer& loadBalancer,
+                       std::vector<WebServer>& servers, std::mt19937& rng,
+                       SimulationStats& stats, FaultInjector& faults) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cerr << "Failed to open snapshot file: " << path << std::endl;
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0 || static_cast<size_t>(st.st_size) < sizeof(SnapshotHeader)) {
+        close(fd);
+        std::cerr << "Snapshot file is truncated: " << path << std::endl;
+        return false;
+    }
+    const uint64_t size = static_cast<uint64_t>(st.st_size);
+    void* map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        return false;
+    }
+    madvise(map, size, MADV_SEQUENTIAL);
+    madvise(map, size, MADV_WILLNEED);
+    const char* base = static_cast<const char*>(map);
+    const SnapshotHeader& h = *reinterpret_cast<const SnapshotHeader*>(base);
+
+    bool valid = std::memcmp(h.magic, kSnapshotMagic, sizeof(h.magic)) == 0 &&
+                 h.version == kSnapshotVersion && h.headerSize == sizeof(SnapshotHeader) &&
+                 h.rngOffset + h.rngBytes <= size &&
+                 h.queueOffset + h.queueCount * sizeof(SnapshotRequest) <= size &&
+                 h.serverOffset + h.serverCount * sizeof(SnapshotServer) <= size &&
+                 h.fleetOffset + h.fleetCount * sizeof(SnapshotServer) <= size &&
+                 h.streamOffset + h.streamCount * sizeof(SnapshotStream) <= size &&
+                 h.latencyBuckets <= kLatencyBuckets && h.hedgelessBuckets <= kLatencyBuckets &&
+                 h.latencyOffset + h.latencyBuckets * sizeof(uint64_t) <= size &&
+                 h.hedgelessOffset + h.hedgelessBuckets * sizeof(uint64_t) <= size;
+    if (!valid) {
+        munmap(map, size);
+        std::cerr << "Incompatible snapshot file: " << path << std::endl;
+        return false;
+    }
+
+    std::istringstream rngText(std::string(base + h.rngOffset, h.rngBytes));
+    rngText >> rng;
+
+    const SnapshotRequest* queued = reinterpret_cast<const SnapshotRequest*>(base + h.queueOffset);
+    std::vector<Request> requests;
+    requests.reserve(h.queueCount);
+    for (uint64_t i = 0; i < h.queueCount; ++i) {
+        requests.push_back(fromRecord(queued[i]));
+    }
+
+    const SnapshotStream* streams = reinterpret_cast<const SnapshotStream*>(base + h.streamOffset);
+    uint64_t streamCursor = 0;
+    std::vector<WebServer> fleet;
+    if (!readServers(reinterpret_cast<const SnapshotServer*>(base + h.serverOffset), h.serverCount,
+                     streams, h.streamCount, streamCursor, servers) ||
+        !readServers(reinterpret_cast<const SnapshotServer*>(base + h.fleetOffset), h.fleetCount,
+                     streams, h.streamCount, streamCursor, fleet)) {
+        munmap(map, size);
+        std::cerr << "Incompatible snapshot file: " << path << std::endl;
+        return false;
+    }
+
+    loadBalancer.restoreState(h.clock, h.processedRequests, h.rejectedRequests, h.serverIndex,
+                              requests, fleet);
+    ResilienceStats resilience;
+    resilience.ejections = h.ejections;
+    resilience.requeued = h.requeued;
+    resilience.failedRequests = h.failedRequests;
+    resilience.hedges = h.hedges;
+    resilience.hedgeWins = h.hedgeWins;
+    resilience.cancelledWork = h.cancelledWork;
+    resilience.latency.restoreBuckets(reinterpret_cast<const uint64_t*>(base + h.latencyOffset), h.latencyBuckets);
+    resilience.latencyWithoutHedging.restoreBuckets(reinterpret_cast<const uint64_t*>(base + h.hedgelessOffset),
+                                                    h.hedgelessBuckets);
+    loadBalancer.restoreResilienceStats(resilience);
+    faults.restoreCounts(h.crashes, h.slowdowns);
+    stats.minProcessTime = h.minProcessTime;
+    stats.maxProcessTime = h.maxProcessTime;
+    munmap(map, size);
+    return true;
+}
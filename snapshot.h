@@ -0,0 +1,177 @@
+/**
+ * @file snapshot.h
+ *
+ * This file contains the Snapshot class, which checkpoints the complete state
+ * of a simulation into a versioned binary file and restores it again.
+ *
+ * File layout (every section starts on a 64-byte boundary):
+ *
+ *     SnapshotHeader                      fixed size, holds counters and section offsets
+ *     char[rngBytes]                      std::mt19937 state in its standard text form
+ *     SnapshotRequest[queueCount]         the request queue, front first
+ *     SnapshotServer[serverCount]         the simulation's servers and their in-flight requests
+ *     SnapshotServer[fleetCount]          the servers allocated by the LoadBalancer autoscaler
+ *     SnapshotStream[streamCount]         per server in the order above: its processor-sharing
+ *                                         streams, then the requests it lost in a crash
+ *     uint64_t[latencyBuckets]            LoadBalancer latency histogram, log-linear buckets
+ *                                         as in latencyhistogram.h (at most kLatencyBuckets)
+ *     uint64_t[hedgelessBuckets]          the same without hedging
+ *
+ * The header also carries the run-wide resilience and fault counters, so a
+ * run branched from a snapshot reports its whole history.
+ *
+ * All records are fixed-size and stored in host byte order, so restoring maps
+ * the file and walks the arrays in place; nothing is tokenised except the RNG
+ * state, which the standard library only exposes as text.
+ */
+
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include "faultinjector.h"
+#include "loadbalancer.h"
+#include "webserver.h"
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+ //all doxygen comments are generated with AI assistance
+
+/**
+ * @brief Run statistics kept by the driver outside the LoadBalancer.
+ */
+struct SimulationStats {
+    int minProcessTime; ///< Shortest process time generated so far.
+    int maxProcessTime; ///< Longest process time generated so far.
+};
+
+const char kSnapshotMagic[8] = {'L', 'B', 'S', 'N', 'A', 'P', 0, 0}; ///< File signature.
+const uint32_t kSnapshotVersion = 5;                                  ///< Current format version.
+
+/**
+ * @brief Fixed header at offset 0 of a snapshot file.
+ */
+struct SnapshotHeader {
+    char magic[8];            ///< kSnapshotMagic.
+    uint32_t version;         ///< kSnapshotVersion.
+    uint32_t headerSize;      ///< sizeof(SnapshotHeader), for forward compatibility.
+    int32_t clock;            ///< LoadBalancer simulation time.
+    int32_t processedRequests; ///< LoadBalancer processed counter.
+    int32_t rejectedRequests; ///< LoadBalancer rejected counter.
+    int32_t serverIndex;      ///< LoadBalancer round-robin position.
+    int32_t minProcessTime;   ///< SimulationStats::minProcessTime.
+    int32_t maxProcessTime;   ///< SimulationStats::maxProcessTime.
+    uint64_t rngOffset;       ///< Offset of the RNG state.
+    uint64_t rngBytes;        ///< Length of the RNG state.
+    uint64_t queueOffset;     ///< Offset of the queued requests.
+    uint64_t queueCount;      ///< Number of queued requests.
+    uint64_t serverOffset;    ///< Offset of the simulation's servers.
+    uint64_t serverCount;     ///< Number of simulation servers.
+    uint64_t fleetOffset;     ///< Offset of the autoscaler's servers.
+    uint64_t fleetCount;      ///< Number of autoscaler servers.
+    uint64_t streamOffset;    ///< Offset of the processor-sharing streams.
+    uint64_t streamCount;     ///< Number of streams over all servers.
+    int32_t ejections;        ///< ResilienceStats::ejections.
+    int32_t requeued;         ///< ResilienceStats::requeued.
+    int32_t failedRequests;   ///< ResilienceStats::failedRequests.
+    int32_t hedges;           ///< ResilienceStats::hedges.
+    int32_t hedgeWins;        ///< ResilienceStats::hedgeWins.
+    int32_t crashes;          ///< FaultInjector crash count.
+    int32_t slowdowns;        ///< FaultInjector slowdown count.
+    int32_t pad;              ///< Zero.
+    double cancelledWork;     ///< ResilienceStats::cancelledWork.
+    uint64_t latencyOffset;   ///< Offset of the latency histogram buckets.
+    uint64_t latencyBuckets;  ///< Number of latency buckets.
+    uint64_t hedgelessOffset; ///< Offset of the without-hedging histogram buckets.
+    uint64_t hedgelessBuckets; ///< Number of without-hedging buckets.
+};
+
+/**
+ * @brief A request as stored in a snapshot.
+ */
+struct SnapshotRequest {
+    uint32_t ipIn;        ///< Source address in host byte order.
+    uint32_t ipOut;       ///< Destination address in host byte order.
+    int32_t processTime;  ///< Processing time in clock cycles.
+    int32_t arrivalTime;  ///< Arrival time in clock cycles.
+    uint32_t id;          ///< Request id.
+    int32_t dispatchTime; ///< Last dispatch time in clock cycles.
+    int32_t retries;      ///< Requeues after server failures.
+    uint8_t jobType;      ///< 'P', 'S', or ' ' for an empty request.
+    uint8_t hedgeCopy;    ///< 1 for the duplicate of a hedged request.
+    uint8_t pad[2];       ///< Zero.
+};
+
+/**
+ * @brief A server as stored in a snapshot.
+ */
+struct SnapshotServer {
+    SnapshotRequest current;  ///< The in-flight (or last) request.
+    int32_t startTime;        ///< Job-type adjusted start time of current.
+    int32_t processedCount;   ///< Requests completed by the server.
+    uint8_t name;             ///< Server name.
+    uint8_t active;           ///< 1 if current is still being processed.
+    uint8_t crashed;          ///< FaultState::crashed.
+    uint8_t ejected;          ///< FaultState::ejected.
+    int32_t streamSlots;      ///< StreamState::slots.
+    int32_t peakConcurrency;  ///< StreamState::peakConcurrency.
+    uint32_t streamCount;     ///< Streams of this server in the stream section.
+    uint32_t pad2;            ///< Zero.
+    double virtualTime;       ///< StreamState::virtualTime.
+    double clock;             ///< StreamState::clock.
+    double jobCycles;         ///< StreamState::jobCycles.
+    uint64_t nextSequence;    ///< StreamState::nextSequence.
+    int32_t slowFactor;       ///< FaultState::slowFactor.
+    int32_t recoverAt;        ///< FaultState::recoverAt.
+    int32_t failedChecks;     ///< FaultState::failedChecks.
+    uint32_t lostCount;       ///< Lost requests following the streams in the stream section.
+    double exclusiveLag;      ///< FaultState::exclusiveLag.
+};
+
+/**
+ * @brief One processor-sharing stream, in the server's heap order, or a lost request.
+ */
+struct SnapshotStream {
+    SnapshotRequest request;  ///< The streamed request.
+    uint32_t pad;             ///< Zero.
+    double finishTag;         ///< Virtual finish time.
+    uint64_t sequence;        ///< Admission order.
+};
+
+/**
+ * @class Snapshot
+ * @brief Saves and restores full simulation state.
+ */
+class Snapshot {
+public:
+    /**
+     * @brief Writes a snapshot file.
+     * @param path Destination file, overwritten if it exists.
+     * @param loadBalancer The balancer whose clock, counters and queue are saved.
+     * @param servers The simulation's servers.
+     * @param rng The random number generator driving the simulation.
+     * @param stats Driver statistics.
+     * @param faults The fault injector whose counts are saved.
+     * @return True on success, false otherwise.
+     */
+    static bool save(const std::string& path, const LoadBalancer& loadBalancer,
+                     const std::vector<WebServer>& servers, const std::mt19937& rng,
+                     const SimulationStats& stats, const FaultInjector& faults);
+
+    /**
+     * @brief Maps a snapshot file and restores the simulation from it.
+     * @param path Snapshot file to read.
+     * @param loadBalancer Receives clock, counters, queue and autoscaler servers.
+     * @param servers Replaced with the saved simulation servers.
+     * @param rng Receives the saved generator state.
+     * @param stats Receives the saved driver statistics.
+     * @param faults Receives the saved fault counts.
+     * @return True on success, false if the file is missing or incompatible.
+     */
+    static bool restore(const std::string& path, LoadBalancer& loadBalancer,
+                        std::vector<WebServer>& servers, std::mt19937& rng,
+                        SimulationStats& stats, FaultInjector& faults);
+};
+
+#endif
@@ -0,0 +1,839 @@
+#include "tcpproxy.h"
+#include "loadbalancer.h"
+#include "logmanager.h"
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <deque>
+#include <iostream>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace {
+
+const int kMaxEvents = 256;            ///< Events handled per epoll_wait call.
+const int kWaitTimeoutMs = 50;         ///< epoll_wait timeout, bounds how long stop() waits.
+const size_t kSpliceChunk = 1 << 16;   ///< Bytes moved per splice() call.
+
+typedef std::chrono::steady_clock Clock;
+
+/**
+ * @brief Opens a non-blocking listening socket on the given address.
+ * @param addr Address to bind.
+ * @param reusePort Whether to set SO_REUSEPORT so several loops can share the port.
+ * @return The listening descriptor, or -1 on failure.
+ */
+int openListener(const sockaddr_in& addr, bool reusePort) {
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    if (reusePort) {
+        setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one));
+    }
+    if (bind(fd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) < 0 || listen(fd, 1024) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/**
+ * @brief Returns the value at the given percentile of a sample set.
+ * @param samples Samples to inspect, reordered in place.
+ * @param pct Percentile between 0 and 100.
+ * @return The sample at that percentile, or 0 if there are none.
+ */
+double percentile(std::vector<uint32_t>& samples, double pct) {
+    if (samples.empty()) {
+        return 0.0;
+    }
+    size_t rank = static_cast<size_t>(pct / 100.0 * (samples.size() - 1));
+    std::nth_element(samples.begin(), samples.begin() + rank, samples.end());
+    return samples[rank];
+}
+
+} // namespace
+
+/**
+ * @brief A socket registered with a loop's epoll set.
+ *
+ * The epoll event data points straight at the channel so dispatching an event
+ * needs no lookup.
+ */
+struct Channel {
+    enum Kind { Listener, Client, Backend };
+
+    int fd = -1;                 ///< Socket descriptor, -1 once closed.
+    Kind kind = Client;          ///< What the socket is used for.
+    int backend = -1;            ///< Backend index for backend channels.
+    bool connecting = false;     ///< True while a backend connect() is in progress.
+    int uses = 0;                ///< Sessions this backend connection has served.
+    uint32_t interest = 0;       ///< Events currently registered with epoll.
+    struct Session* session = nullptr; ///< Session using this channel, if any.
+};
+
+/**
+ * @brief A client connection paired with a backend connection.
+ */
+struct Session {
+    Channel client;              ///< Accepted client socket.
+    Channel* backend = nullptr;  ///< Warm backend socket serving this client.
+    int toBackend[2] = {-1, -1}; ///< Pipe carrying client bytes to the backend.
+    int toClient[2] = {-1, -1};  ///< Pipe carrying backend bytes to the client.
+    size_t toBackendPending = 0; ///< Bytes sitting in toBackend.
+    size_t toClientPending = 0;  ///< Bytes sitting in toClient.
+    Clock::time_point acceptedAt; ///< When the client was accepted.
+    bool responded = false;      ///< Set once the first backend byte reached the client.
+    uint64_t sentToBackend = 0;  ///< Client bytes read so far; the backend may owe a reply once this is non-zero.
+    bool clientEof = false;      ///< The client finished sending.
+    bool backendShut = false;    ///< The client's EOF was passed on with shutdown(SHUT_WR).
+    bool backendEof = false;     ///< The backend finished sending and its connection was closed.
+    bool backendHup = false;     ///< The backend hung up with bytes still unread; collected as the client drains.
+};
+
+/**
+ * @class ProxyLoop
+ * @brief One single-threaded epoll event loop of a TcpProxy.
+ */
+class ProxyLoop {
+public:
+    ProxyLoop(const TcpProxyConfig& config, int index)
+        : config(config),
+          logger(config.logPrefix + "_" + std::to_string(index) + ".txt"),
+          loadBalancer(logger),
+          idle(config.backends.size()),
+          connecting(config.backends.size(), 0) {}
+
+    ~ProxyLoop() {
+        recycleChannels();
+        for (auto* c : allChannels) {
+            if (c->fd >= 0) {
+                close(c->fd);
+            }
+            delete c;
+        }
+        for (auto& p : pending) {
+            close(p.first);
+        }
+        for (auto& p : pipePool) {
+            close(p.first);
+            close(p.second);
+        }
+        if (epollFd >= 0) {
+            close(epollFd);
+        }
+    }
+
+    /**
+     * @brief Creates the epoll set and listening socket and opens the warm backend connections.
+     * @return True on success.
+     */
+    bool init() {
+        epollFd = epoll_create1(EPOLL_CLOEXEC);
+        sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_ANY);
+        addr.sin_port = htons(config.listenPort);
+        listener.fd = openListener(addr, true);
+        listener.kind = Channel::Listener;
+        if (epollFd < 0 || listener.fd < 0) {
+            return false;
+        }
+        watch(&listener, EPOLLIN, EPOLL_CTL_ADD);
+        for (size_t b = 0; b < config.backends.size(); ++b) {
+            refill(static_cast<int>(b));
+        }
+        return true;
+    }
+
+    /**
+     * @brief Runs the loop until the running flag is cleared.
+     * @param running Shared stop flag.
+     */
+    void run(const std::atomic<bool>& running) {
+        epoll_event events[kMaxEvents];
+        while (running.load(std::memory_order_relaxed)) {
+            int n = epoll_wait(epollFd, events, kMaxEvents, kWaitTimeoutMs);
+            for (int i = 0; i < n; ++i) {
+                Channel* ch = static_cast<Channel*>(events[i].data.ptr);
+                if (ch->fd < 0) {
+                    continue; // closed earlier in this batch
+                }
+                uint32_t ev = events[i].events;
+                switch (ch->kind) {
+                case Channel::Listener:
+                    acceptClients();
+                    break;
+                case Channel::Client:
+                    onClientEvent(ch->session, ev);
+                    break;
+                case Channel::Backend:
+                    onBackendEvent(ch, ev);
+                    break;
+                }
+            }
+            for (auto* s : graveyard) {
+                delete s;
+            }
+            graveyard.clear();
+            recycleChannels();
+            loadBalancer.incTime();
+        }
+        close(listener.fd);
+        listener.fd = -1;
+    }
+
+    uint64_t accepted = 0;       ///< Connections accepted by this loop.
+    uint64_t rejected = 0;       ///< Connections refused by the blocklist.
+    uint64_t forwarded = 0;      ///< Connections paired with a backend.
+    uint64_t warmReuses = 0;     ///< Sessions given a warm connection an earlier client left unused.
+    uint64_t bytesSpliced = 0;   ///< Bytes forwarded in either direction.
+    std::vector<uint32_t> latencyUs; ///< Accept-to-first-response samples.
+
+private:
+    /**
+     * @brief Adds or modifies a channel's epoll registration.
+     */
+    void watch(Channel* ch, uint32_t events, int op) {
+        epoll_event ev = {};
+        ev.events = events;
+        ev.data.ptr = ch;
+        epoll_ctl(epollFd, op, ch->fd, &ev);
+        ch->interest = events;
+    }
+
+    /**
+     * @brief Updates a channel's interest set only if it changed.
+     */
+    void setInterest(Channel* ch, uint32_t events) {
+        if (ch->interest != events) {
+            watch(ch, events, EPOLL_CTL_MOD);
+        }
+    }
+
+    /**
+     * @brief Starts non-blocking connects until the backend has poolSize warm connections.
+     * @param b Backend index.
+     */
+    void refill(int b) {
+        while (static_cast<int>(idle[b].size()) + connecting[b] < config.poolSize) {
+            int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+            if (fd < 0) {
+                return;
+            }
+            int one = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            const sockaddr_in& addr = config.backends[b];
+            int rc = connect(fd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr));
+            if (rc < 0 && errno != EINPROGRESS) {
+                close(fd);
+                return;
+            }
+            Channel* ch;
+            if (spareChannels.empty()) {
+                ch = new Channel();
+                allChannels.push_back(ch);
+            } else {
+                ch = spareChannels.back();
+                spareChannels.pop_back();
+                *ch = Channel();
+            }
+            ch->fd = fd;
+            ch->kind = Channel::Backend;
+            ch->backend = b;
+            ch->connecting = true;
+            connecting[b]++;
+            watch(ch, EPOLLOUT, EPOLL_CTL_ADD);
+        }
+    }
+
+    /**
+     * @brief Accepts every pending client and admits it through the LoadBalancer.
+     */
+    void acceptClients() {
+        for (;;) {
+            sockaddr_in peer = {};
+            socklen_t len = sizeof(peer);
+            int fd = accept4(listener.fd, reinterpret_cast<sockaddr*>(&peer), &len,
+                             SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd < 0) {
+                break;
+            }
+            accepted++;
+
+            const sockaddr_in& target = config.backends[nextBackend];
+            int rejectedBefore = loadBalancer.getRejectedRequests();
+            loadBalancer.addRequest(Request(ntohl(peer.sin_addr.s_addr), ntohl(target.sin_addr.s_addr),
+                                            0, 'P', loadBalancer.getTime()));
+            if (loadBalancer.getRejectedRequests() != rejectedBefore) {
+                rejected++;
+                close(fd);
+                continue;
+            }
+            int one = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            pending.push_back(std::make_pair(fd, Clock::now()));
+        }
+        dispatchPending();
+    }
+
+    /**
+     * @brief Takes a warm backend connection, preferring round-robin order.
+     * @return A connected backend channel, or nullptr if none is ready.
+     */
+    Channel* takeBackend() {
+        size_t n = config.backends.size();
+        for (size_t i = 0; i < n; ++i) {
+            int b = static_cast<int>((nextBackend + i) % n);
+            if (!idle[b].empty()) {
+                Channel* ch = idle[b].back();
+                idle[b].pop_back();
+                nextBackend = static_cast<int>((b + 1) % n);
+                refill(b);
+                return ch;
+            }
+        }
+        return nullptr;
+    }
+
+    /**
+     * @brief Pairs queued clients with warm backend connections in FIFO order.
+     */
+    void dispatchPending() {
+        while (!pending.empty()) {
+            Channel* backend = takeBackend();
+            if (backend == nullptr) {
+                return; // clients stay queued until a connect completes
+            }
+            loadBalancer.getRequest();
+            Session* s = new Session();
+            s->client.fd = pending.front().first;
+            s->client.kind = Channel::Client;
+            s->client.session = s;
+            s->acceptedAt = pending.front().second;
+            pending.pop_front();
+            s->backend = backend;
+            backend->session = s;
+            takePipe(s->toBackend);
+            takePipe(s->toClient);
+            forwarded++;
+            if (backend->uses++ > 0) {
+                warmReuses++;
+            }
+            watch(&s->client, EPOLLIN, EPOLL_CTL_ADD);
+            setInterest(backend, EPOLLIN);
+        }
+    }
+
+    /**
+     * @brief Reuses a drained pipe from the pool or creates a new one.
+     */
+    void takePipe(int p[2]) {
+        if (!pipePool.empty()) {
+            p[0] = pipePool.back().first;
+            p[1] = pipePool.back().second;
+            pipePool.pop_back();
+            return;
+        }
+        if (pipe2(p, O_NONBLOCK | O_CLOEXEC) < 0) {
+            p[0] = p[1] = -1;
+        }
+    }
+
+    /**
+     * @brief Returns a pipe to the pool if it is empty, otherwise closes it.
+     */
+    void releasePipe(int p[2], size_t pendingBytes) {
+        if (p[0] < 0) {
+            return;
+        }
+        if (pendingBytes == 0) {
+            pipePool.push_back(std::make_pair(p[0], p[1]));
+        } else {
+            close(p[0]);
+            close(p[1]);
+        }
+        p[0] = p[1] = -1;
+    }
+
+    /**
+     * @brief Moves bytes from a socket into a pipe with splice().
+     * @return Bytes moved, 0 on end of stream, -1 on error, -2 if it would block.
+     */
+    ssize_t fill(int from, int pipeIn) {
+        ssize_t n = splice(from, nullptr, pipeIn, nullptr, kSpliceChunk, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+        if (n < 0) {
+            return (errno == EAGAIN) ? -2 : -1;
+        }
+        return n;
+    }
+
+    /**
+     * @brief Drains as much of a pipe as the destination socket accepts.
+     * @return False if the destination failed.
+     */
+    bool drain(int pipeOut, int to, size_t& pendingBytes) {
+        while (pendingBytes > 0) {
+            ssize_t n = splice(pipeOut, nullptr, to, nullptr, pendingBytes, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+            if (n < 0) {
+                return errno == EAGAIN;
+            }
+            pendingBytes -= static_cast<size_t>(n);
+            bytesSpliced += static_cast<uint64_t>(n);
+        }
+        return true;
+    }
+
+    /**
+     * @brief Recomputes both sides' interest sets from the pipe fill levels.
+     *
+     * A side is only read while its outgoing pipe is empty and only watched for
+     * writability while its incoming pipe has bytes, so level-triggered epoll
+     * never spins on a full pipe.
+     */
+    void updateInterest(Session* s) {
+        setInterest(&s->client, (s->toBackendPending == 0 && !s->clientEof ? EPOLLIN : 0u) |
+                                (s->toClientPending > 0 ? EPOLLOUT : 0u));
+        if (!s->backendEof && !s->backendHup) {
+            setInterest(s->backend, (s->toClientPending == 0 ? EPOLLIN : 0u) |
+                                    (s->toBackendPending > 0 ? EPOLLOUT : 0u));
+        }
+    }
+
+    /**
+     * @brief Passes half-closes on once the bytes ahead of them are delivered.
+     *
+     * The client's EOF becomes shutdown(SHUT_WR) on the backend after the last
+     * client byte reached it, so the backend still answers what it received.
+     * The session ends when the backend has finished and the client has been
+     * sent everything.
+     *
+     * @param s The session.
+     * @return False if the session was closed.
+     */
+    bool propagateClose(Session* s) {
+        while (s->backendHup && !s->backendEof && s->toClientPending == 0) {
+            ssize_t n = fill(s->backend->fd, s->toClient[1]);
+            if (n < 0) {
+                closeSession(s, false);
+                return false;
+            }
+            if (n == 0) {
+                finishBackend(s);
+                break;
+            }
+            s->toClientPending += static_cast<size_t>(n);
+            if (!drain(s->toClient[0], s->client.fd, s->toClientPending)) {
+                closeSession(s, false);
+                return false;
+            }
+        }
+        if (s->clientEof && !s->backendShut && !s->backendEof && s->toBackendPending == 0) {
+            shutdown(s->backend->fd, SHUT_WR);
+            s->backendShut = true;
+        }
+        if (s->backendEof && s->toClientPending == 0) {
+            closeSession(s, false);
+            return false;
+        }
+        return true;
+    }
+
+    void onClientEvent(Session* s, uint32_t ev) {
+        if (ev & EPOLLIN) {
+            ssize_t n = fill(s->client.fd, s->toBackend[1]);
+            if (n == -1) {
+                closeSession(s, false);
+                return;
+            }
+            if (n == 0) {
+                if (s->sentToBackend == 0 && !s->responded) {
+                    closeSession(s, true); // the backend never saw a byte, so it owes nothing
+                    return;
+                }
+                s->clientEof = true;
+            }
+            if (n > 0) {
+                s->sentToBackend += static_cast<uint64_t>(n);
+                s->toBackendPending += static_cast<size_t>(n);
+                if (s->backend == nullptr || !drain(s->toBackend[0], s->backend->fd, s->toBackendPending)) {
+                    closeSession(s, false);
+                    return;
+                }
+            }
+        }
+        if ((ev & EPOLLOUT) && !drain(s->toClient[0], s->client.fd, s->toClientPending)) {
+            closeSession(s, false);
+            return;
+        }
+        if (ev & (EPOLLERR | EPOLLHUP)) {
+            closeSession(s, false);
+            return;
+        }
+        if (propagateClose(s)) {
+            updateInterest(s);
+        }
+    }
+
+    void onBackendEvent(Channel* ch, uint32_t ev) {
+        if (ch->connecting) {
+            int err = 0;
+            socklen_t len = sizeof(err);
+            getsockopt(ch->fd, SOL_SOCKET, SO_ERROR, &err, &len);
+            connecting[ch->backend]--;
+            ch->connecting = false;
+            if (err != 0) {
+                closeChannel(ch);
+                return;
+            }
+            idle[ch->backend].push_back(ch);
+            setInterest(ch, EPOLLIN | EPOLLRDHUP);
+            dispatchPending();
+            return;
+        }
+        Session* s = ch->session;
+        if (s == nullptr) {
+            // A warm connection became readable: the backend closed it.
+            auto& pool = idle[ch->backend];
+            pool.erase(std::remove(pool.begin(), pool.end(), ch), pool.end());
+            closeChannel(ch);
+            refill(ch->backend);
+            return;
+        }
+        if (ev & EPOLLIN) {
+            ssize_t n = fill(ch->fd, s->toClient[1]);
+            if (n == -1) {
+                closeSession(s, false);
+                return;
+            }
+            if (n == 0) {
+                // The backend is done: close it now and finish delivering what it sent.
+                finishBackend(s);
+                if (propagateClose(s)) {
+                    updateInterest(s);
+                }
+                return;
+            }
+            if (n > 0) {
+                s->toClientPending += static_cast<size_t>(n);
+                if (!drain(s->toClient[0], s->client.fd, s->toClientPending)) {
+                    closeSession(s, false);
+                    return;
+                }
+                if (!s->responded) {
+                    s->responded = true;
+                    latencyUs.push_back(static_cast<uint32_t>(
+                        std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - s->acceptedAt).count()));
+                }
+            }
+        }
+        if ((ev & EPOLLOUT) && !drain(s->toBackend[0], ch->fd, s->toBackendPending)) {
+            closeSession(s, false);
+            return;
+        }
+        if ((ev & EPOLLHUP) && !(ev & EPOLLERR)) {
+            // Both directions are shut but the reply may not all be read yet:
+            // stop watching (a hang-up is always reported) and collect the rest
+            // as the client accepts it.
+            epoll_ctl(epollFd, EPOLL_CTL_DEL, ch->fd, nullptr);
+            ch->interest = 0;
+            s->backendHup = true;
+            if (propagateClose(s)) {
+                updateInterest(s);
+            }
+            return;
+        }
+        if (ev & (EPOLLERR | EPOLLHUP)) {
+            closeSession(s, false);
+            return;
+        }
+        if (propagateClose(s)) {
+            updateInterest(s);
+        }
+    }
+
+    /**
+     * @brief Closes a backend channel; the object is recycled after the current batch.
+     */
+    void closeChannel(Channel* ch) {
+        close(ch->fd);
+        ch->fd = -1;
+        ch->session = nullptr;
+        closedChannels.push_back(ch);
+    }
+
+    /**
+     * @brief Closes a session's backend once it has sent everything and opens a replacement.
+     *
+     * The session lets go of the channel, which is recycled after the batch.
+     */
+    void finishBackend(Session* s) {
+        Channel* backend = s->backend;
+        s->backendEof = true;
+        s->backend = nullptr;
+        closeChannel(backend);
+        refill(backend->backend);
+    }
+
+    /**
+     * @brief Makes the channels closed in the last batch available to refill().
+     *
+     * Events later in a batch may still point at a channel closed earlier in
+     * it, so channels are only reused once the batch has been handled; the
+     * loop then holds no more channels than it ever had open at once.
+     */
+    void recycleChannels() {
+        spareChannels.insert(spareChannels.end(), closedChannels.begin(), closedChannels.end());
+        closedChannels.clear();
+    }
+
+    /**
+     * @brief Tears down a session.
+     *
+     * The proxy relays opaque bytes, so it cannot tell when a backend has
+     * answered everything it was sent. Warm connections are therefore used for
+     * one exchange: after any exchange the connection is closed and refill()
+     * opens a new one, so a late reply can never reach the next client. Only
+     * a connection whose client left without sending a byte goes back to the
+     * warm set.
+     *
+     * @param s Session to close.
+     * @param clientFinished True if the client closed its side before sending anything.
+     */
+    void closeSession(Session* s, bool clientFinished) {
+        close(s->client.fd);
+        s->client.fd = -1;
+        Channel* backend = s->backend;
+        bool reusable = clientFinished && s->sentToBackend == 0 && !s->responded && !s->backendShut &&
+                        s->toBackendPending == 0 && s->toClientPending == 0;
+        releasePipe(s->toBackend, s->toBackendPending);
+        releasePipe(s->toClient, s->toClientPending);
+        if (backend == nullptr) {
+            // already closed and replaced when the backend finished
+        } else if (reusable) {
+            backend->session = nullptr;
+            idle[backend->backend].push_back(backend);
+            setInterest(backend, EPOLLIN | EPOLLRDHUP);
+            dispatchPending();
+        } else {
+            closeChannel(backend);
+            refill(backend->backend);
+        }
+        graveyard.push_back(s);
+    }
+
+    const TcpProxyConfig& config;                 ///< Shared proxy configuration.
+    LogManager logger;                            ///< Per-loop log file.
+    LoadBalancer loadBalancer;                    ///< Admission, blocklist and queue for this loop.
+    int epollFd = -1;                             ///< This loop's epoll set.
+    Channel listener;                             ///< SO_REUSEPORT listening socket.
+    int nextBackend = 0;                          ///< Round-robin cursor over backends.
+    std::vector<std::vector<Channel*> > idle;     ///< Warm connections ready for a client, per backend.
+    std::vector<int> connecting;                  ///< In-progress connects per backend.
+    std::vector<Channel*> allChannels;            ///< Every backend channel object, open or spare.
+    std::vector<Channel*> closedChannels;         ///< Channels closed in the current batch.
+    std::vector<Channel*> spareChannels;          ///< Closed channels ready for reuse by refill().
+    std::vector<std::pair<int, int> > pipePool;   ///< Drained pipes ready for reuse.
+    std::deque<std::pair<int, Clock::time_point> > pending; ///< Admitted clients waiting for a backend.
+    std::vector<Session*> graveyard;              ///< Sessions freed after the current batch.
+};
+
+/**
+ * @brief Constructs a TcpProxy with the given configuration.
+ * @param config Listening port, backends and loop settings.
+ */
+TcpProxy::TcpProxy(const TcpProxyConfig& config)
+    : config(config), running(false) {
+    if (this->config.numLoops <= 0) {
+        this->config.numLoops = std::max(1u, std::thread::hardware_concurrency());
+    }
+}
+
+/**
+ * @brief Stops the proxy if it is still running.
+ */
+TcpProxy::~TcpProxy() {
+    stop();
+    for (auto* loop : loops) {
+        delete loop;
+    }
+}
+
+/**
+ * @brief Binds the listening sockets and starts one thread per event loop.
+ * @return True if every loop started, false otherwise.
+ */
+bool TcpProxy::start() {
+    if (config.backends.empty()) {
+        std::cerr << "TcpProxy: no backends configured" << std::endl;
+        return false;
+    }
+    for (int i = 0; i < config.numLoops; ++i) {
+        ProxyLoop* loop = new ProxyLoop(config, i);
+        loops.push_back(loop);
+        if (!loop->init()) {
+            std::cerr << "TcpProxy: failed to listen on port " << config.listenPort << std::endl;
+            return false;
+        }
+    }
+    running = true;
+    for (auto* loop : loops) {
+        threads.emplace_back([this, loop]() { loop->run(running); });
+    }
+    return true;
+}
+
+/**
+ * @brief Signals all loops to exit and joins their threads.
+ */
+void TcpProxy::stop() {
+    running = false;
+    for (auto& t : threads) {
+        t.join();
+    }
+    threads.clear();
+}
+
+/**
+ * @brief Merges the counters and latency samples of all loops.
+ * @return The aggregated statistics.
+ */
+TcpProxyStats TcpProxy::getStats() const {
+    TcpProxyStats stats;
+    std::vector<uint32_t> samples;
+    for (const auto* loop : loops) {
+        stats.accepted += loop->accepted;
+        stats.rejected += loop->rejected;
+        stats.forwarded += loop->forwarded;
+        stats.warmReuses += loop->warmReuses;
+        stats.bytesSpliced += loop->bytesSpliced;
+        samples.insert(samples.end(), loop->latencyUs.begin(), loop->latencyUs.end());
+    }
+    stats.p50LatencyUs = percentile(samples, 50.0);
+    stats.p99LatencyUs = percentile(samples, 99.0);
+    return stats;
+}
+
+LoopbackBackend::LoopbackBackend() : address(), running(false) {}
+
+LoopbackBackend::~LoopbackBackend() {
+    stop();
+}
+
+/**
+ * @brief Binds to an ephemeral loopback port and starts the echo thread.
+ * @return True on success, false otherwise.
+ */
+bool LoopbackBackend::start() {
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = 0;
+    listenFd = openListener(address, false);
+    if (listenFd < 0) {
+        return false;
+    }
+    socklen_t len = sizeof(address);
+    getsockname(listenFd, reinterpret_cast<sockaddr*>(&address), &len);
+    running = true;
+    thread = std::thread(&LoopbackBackend::run, this);
+    return true;
+}
+
+/**
+ * @brief Stops the echo thread and closes all connections.
+ */
+void LoopbackBackend::stop() {
+    running = false;
+    if (thread.joinable()) {
+        thread.join();
+    }
+    if (listenFd >= 0) {
+        close(listenFd);
+        listenFd = -1;
+    }
+}
+
+/**
+ * @brief Gets the address the backend is listening on.
+ * @return The loopback address and port.
+ */
+sockaddr_in LoopbackBackend::getAddress() const {
+    return address;
+}
+
+/**
+ * @brief Echo loop: writes every received byte back on the same connection.
+ */
+void LoopbackBackend::run() {
+    int ep = epoll_create1(EPOLL_CLOEXEC);
+    epoll_event ev = {};
+    ev.events = EPOLLIN;
+    ev.data.fd = listenFd;
+    epoll_ctl(ep, EPOLL_CTL_ADD, listenFd, &ev);
+
+    std::unordered_map<int, std::string> unsent; // bytes the peer has not accepted yet
+    std::unordered_set<int> finished;            // peers that sent EOF, closed once their echo is written
+    epoll_event events[kMaxEvents];
+    char buf[16384];
+    while (running.load(std::memory_order_relaxed)) {
+        int n = epoll_wait(ep, events, kMaxEvents, kWaitTimeoutMs);
+        for (int i = 0; i < n; ++i) {
+            int fd = events[i].data.fd;
+            if (fd == listenFd) {
+                int c;
+                while ((c = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0) {
+                    int one = 1;
+                    setsockopt(c, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+                    epoll_event cev = {};
+                    cev.events = EPOLLIN;
+                    cev.data.fd = c;
+                    epoll_ctl(ep, EPOLL_CTL_ADD, c, &cev);
+                }
+                continue;
+            }
+            std::string& out = unsent[fd];
+            bool closed = false;
+            if (events[i].events & EPOLLIN) {
+                ssize_t r = read(fd, buf, sizeof(buf));
+                if (r == 0) {
+                    finished.insert(fd);
+                } else if (r < 0 && errno != EAGAIN) {
+                    closed = true;
+                } else if (r > 0) {
+                    out.append(buf, static_cast<size_t>(r));
+                }
+            }
+            if (!closed && !out.empty()) {
+                ssize_t w = write(fd, out.data(), out.size());
+                if (w > 0) {
+                    out.erase(0, static_cast<size_t>(w));
+                } else if (!(w < 0 && errno == EAGAIN)) {
+                    closed = true;
+                }
+            }
+            if (closed || (out.empty() && finished.count(fd) > 0)) {
+                finished.erase(fd);
+                unsent.erase(fd);
+                close(fd);
+                continue;
+            }
+            epoll_event cev = {};
+            cev.events = out.empty() ? EPOLLIN : EPOLLOUT;
+            cev.data.fd = fd;
+            epoll_ctl(ep, EPOLL_CTL_MOD, fd, &cev);
+        }
+    }
+    for (auto& entry : unsent) {
+        close(entry.first);
+    }
+    close(ep);
+}
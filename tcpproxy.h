@@ -0,0 +1,135 @@
+/**
+ * @file tcpproxy.h
+ *
+ * This file contains the definition of the TcpProxy class, a networked front
+ * end that accepts real TCP connections, admits them through a LoadBalancer
+ * and forwards their bytes to a set of backend sockets.
+ */
+
+#ifndef TCPPROXY_H
+#define TCPPROXY_H
+
+#include <netinet/in.h>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+ //all doxygen comments are generated with AI assistance
+
+/**
+ * @brief Configuration for a TcpProxy instance.
+ */
+struct TcpProxyConfig {
+    uint16_t listenPort = 8080;             ///< Port every event loop binds with SO_REUSEPORT.
+    std::vector<sockaddr_in> backends;      ///< Backend addresses requests are forwarded to.
+    int numLoops = 0;                       ///< Number of event loops (0 means one per core).
+    int poolSize = 8;                       ///< Warm (pre-connected) connections kept ready to each backend per loop.
+    std::string logPrefix = "tcp_proxy_log"; ///< Each loop logs to <logPrefix>_<loop>.txt.
+};
+
+/**
+ * @brief Aggregated counters reported by a TcpProxy after it stops.
+ */
+struct TcpProxyStats {
+    uint64_t accepted = 0;        ///< Connections accepted by all loops.
+    uint64_t rejected = 0;        ///< Connections refused by the blocklist.
+    uint64_t forwarded = 0;       ///< Connections handed to a backend.
+    uint64_t warmReuses = 0;      ///< Sessions given a warm connection an earlier client left without sending anything.
+    uint64_t bytesSpliced = 0;    ///< Bytes moved between sockets with splice().
+    double p50LatencyUs = 0.0;    ///< Median accept-to-first-response latency.
+    double p99LatencyUs = 0.0;    ///< 99th percentile accept-to-first-response latency.
+};
+
+class ProxyLoop;
+
+/**
+ * @class TcpProxy
+ * @brief A multi-core epoll proxy that balances TCP connections across backends.
+ *
+ * Every event loop runs on its own thread with its own listening socket
+ * (SO_REUSEPORT lets the kernel spread new connections across them), its own
+ * LoadBalancer and its own set of warm backend connections, so the loops
+ * share no state on the hot path. Each accepted connection becomes a Request
+ * that goes through LoadBalancer::addRequest, which means the blocklist and
+ * the request queue behave exactly as they do in the simulation. Payload bytes
+ * are forwarded with splice() through a pipe and never copied to user space.
+ */
+class TcpProxy {
+public:
+    /**
+     * @brief Constructs a TcpProxy with the given configuration.
+     * @param config Listening port, backends and loop settings.
+     */
+    explicit TcpProxy(const TcpProxyConfig& config);
+
+    /**
+     * @brief Stops the proxy if it is still running.
+     */
+    ~TcpProxy();
+
+    /**
+     * @brief Binds the listening sockets and starts one thread per event loop.
+     * @return True if every loop started, false otherwise.
+     */
+    bool start();
+
+    /**
+     * @brief Signals all loops to exit and joins their threads.
+     */
+    void stop();
+
+    /**
+     * @brief Merges the counters and latency samples of all loops.
+     * @return The aggregated statistics.
+     */
+    TcpProxyStats getStats() const;
+
+private:
+    TcpProxyConfig config;              ///< Proxy configuration.
+    std::vector<ProxyLoop*> loops;      ///< One event loop per thread.
+    std::vector<std::thread> threads;   ///< Threads running the event loops.
+    std::atomic<bool> running;          ///< Cleared to ask the loops to exit.
+};
+
+/**
+ * @class LoopbackBackend
+ * @brief A stand-in backend server that echoes every byte it receives.
+ *
+ * Used to exercise the proxy locally without real services. It listens on
+ * 127.0.0.1 with an ephemeral port and serves all connections from one
+ * epoll thread.
+ */
+class LoopbackBackend {
+public:
+    LoopbackBackend();
+    ~LoopbackBackend();
+
+    /**
+     * @brief Binds to an ephemeral loopback port and starts the echo thread.
+     * @return True on success, false otherwise.
+     */
+    bool start();
+
+    /**
+     * @brief Stops the echo thread and closes all connections.
+     */
+    void stop();
+
+    /**
+     * @brief Gets the address the backend is listening on.
+     * @return The loopback address and port.
+     */
+    sockaddr_in getAddress() const;
+
+private:
+    void run();
+
+    int listenFd = -1;            ///< Listening socket.
+    sockaddr_in address;          ///< Bound loopback address.
+    std::thread thread;           ///< Echo thread.
+    std::atomic<bool> running;    ///< Cleared to ask the echo thread to exit.
+};
+
+#endif
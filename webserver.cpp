@@ -1,4 +1,25 @@
 #include "webserver.h"
+#include <algorithm>
+
+namespace {
+
+/**
+ * @brief Heap order for StreamJob: the earliest finish tag (then the earliest admission) on top.
+ */
+bool finishesLater(const StreamJob& a, const StreamJob& b) {
+    return a.finishTag > b.finishTag || (a.finishTag == b.finishTag && a.sequence > b.sequence);
+}
+
+/**
+ * @brief Work of an S request in cycles: the time it takes when it has the server to itself.
+ */
+double streamWork(const Request& req) {
+    return 2.0 * (req.getProcessTime() / 2);
+}
+
+const double kTimeEpsilon = 1e-9; ///< Tolerance when comparing fractional finish times.
+
+} // namespace
 
 /**
  * @brief Constructs a WebServer object with the specified name.
@@ -19,39 +40,59 @@ WebServer::WebServer(char name)
  * active request status. It also adjusts the processing time based on the
  * job type (Processing or Streaming).
  * 
+ * With stream slots, an S request instead joins the processor-sharing heap
+ * with a finish tag of the current virtual time plus its work.
+ * 
  * @param req The request to be added.
  * @param currTime The current time in clock cycles.
  */
 void WebServer::addRequest(Request req, int currTime) {
+    accrue(currTime);
+    if (fault.crashed) {
+        fault.lost.push_back(req); // sent to a dead server: lost until the balancer notices
+        return;
+    }
+    if (sharing.slots > 0 && req.getJobType() == 'S') {
+        StreamJob job = {sharing.virtualTime + streamWork(req), sharing.nextSequence++, req};
+        sharing.streams.push_back(job);
+        std::push_heap(sharing.streams.begin(), sharing.streams.end(), finishesLater);
+        sharing.peakConcurrency = std::max(sharing.peakConcurrency, getConcurrency());
+        return;
+    }
+
     currentRequest = req;
     requestStartTime = currTime;
     hasActiveRequest = true;
+    fault.exclusiveLag = 0.0;
 
     if (req.getJobType() == 'P') {
         // Processing jobs
     } else if (req.getJobType() == 'S') {
         requestStartTime += req.getProcessTime() / 2; 
     }
+    sharing.peakConcurrency = std::max(sharing.peakConcurrency, getConcurrency());
 }
 
 /**
  * @brief Checks if the current request is done processing.
  * 
  * This method evaluates whether the current request has completed processing
- * based on the job type and the current time.
+ * based on the job type and the current time. Time lost to slowdowns is
+ * added to the request's due time.
  * 
  * @param currTime The current time in clock cycles.
  * @return True if the request is completed, false otherwise.
  */
 bool WebServer::isRequestDone(int currTime) {
     if (hasActiveRequest) {
+        accrue(currTime);
         if (currentRequest.getJobType() == 'P') {
-            if (currTime >= requestStartTime + currentRequest.getProcessTime()) {
+            if (currTime >= requestStartTime + currentRequest.getProcessTime() + fault.exclusiveLag - kTimeEpsilon) {
                 hasActiveRequest = false; 
                 return true;
             }
         } else if (currentRequest.getJobType() == 'S') {
-            if (currTime >= requestStartTime + (currentRequest.getProcessTime() / 2)) {
+            if (currTime >= requestStartTime + (currentRequest.getProcessTime() / 2) + fault.exclusiveLag - kTimeEpsilon) {
                 hasActiveRequest = false; 
                 return true;
             }
@@ -60,6 +101,336 @@ bool WebServer::isRequestDone(int currTime) {
     return false; 
 }
 
+/**
+ * @brief Gets when the exclusive request is due at normal speed, including time already lost.
+ */
+double WebServer::exclusiveDue() const {
+    int duration = currentRequest.getJobType() == 'S' ? currentRequest.getProcessTime() / 2 : currentRequest.getProcessTime();
+    return requestStartTime + duration + fault.exclusiveLag;
+}
+
+/**
+ * @brief Completes every request that has finished by the given time.
+ * 
+ * The exclusive request is checked with isRequestDone(). Streams are popped
+ * from the heap while the earliest finish tag is reachable: with n streams
+ * active the top one finishes (tag - virtual time) * n cycles after the last
+ * update, and every departure speeds up the rest.
+ * 
+ * @param currTime The current time in clock cycles.
+ * @param done Receives the completed requests.
+ * @return The number of requests that completed.
+ */
+int WebServer::completeRequests(int currTime, std::vector<Request>& done) {
+    int completed = 0;
+    if (isRequestDone(currTime)) {
+        done.push_back(currentRequest);
+        ++completed;
+    }
+    while (!sharing.streams.empty()) {
+        const StreamJob& top = sharing.streams.front();
+        double finishAt = sharing.clock + (top.finishTag - sharing.virtualTime) * sharing.streams.size() * fault.slowFactor;
+        if (finishAt > currTime + kTimeEpsilon) {
+            break;
+        }
+        double tag = top.finishTag;
+        accrue(std::max(finishAt, sharing.clock));
+        sharing.virtualTime = tag;
+        done.push_back(top.request);
+        std::pop_heap(sharing.streams.begin(), sharing.streams.end(), finishesLater);
+        sharing.streams.pop_back();
+        ++completed;
+    }
+    accrue(currTime);
+    return completed;
+}
+
+/**
+ * @brief Removes an in-flight request, e.g. the losing copy of a hedged request.
+ * 
+ * Removing a stream re-heapifies the streams, which is O(k) but only happens
+ * on cancellation. A copy already lost to a crash but not yet collected is
+ * dropped from the lost list, so the balancer does not retry a request that
+ * has been served; there is no running work to cancel, so false is returned.
+ * 
+ * @param id Id of the request to remove.
+ * @param currTime The current time in clock cycles.
+ * @param cancelled Receives the removed request.
+ * @return True if the request was in flight on this server.
+ */
+bool WebServer::cancelRequest(uint32_t id, int currTime, Request& cancelled) {
+    accrue(currTime);
+    if (hasActiveRequest && currentRequest.getId() == id) {
+        cancelled = currentRequest;
+        hasActiveRequest = false;
+        return true;
+    }
+    for (size_t i = 0; i < sharing.streams.size(); ++i) {
+        if (sharing.streams[i].request.getId() == id) {
+            cancelled = sharing.streams[i].request;
+            sharing.streams.erase(sharing.streams.begin() + static_cast<std::ptrdiff_t>(i));
+            std::make_heap(sharing.streams.begin(), sharing.streams.end(), finishesLater);
+            return true;
+        }
+    }
+    for (size_t i = 0; i < fault.lost.size(); ++i) {
+        if (fault.lost[i].getId() == id) {
+            fault.lost.erase(fault.lost.begin() + static_cast<std::ptrdiff_t>(i));
+            break;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Lists the requests currently being processed.
+ * 
+ * @param out Receives the exclusive request and every stream.
+ */
+void WebServer::inFlightRequests(std::vector<Request>& out) const {
+    if (hasActiveRequest) {
+        out.push_back(currentRequest);
+    }
+    for (const auto& job : sharing.streams) {
+        out.push_back(job.request);
+    }
+}
+
+/**
+ * @brief Estimates when an in-flight request would finish if its speed stayed as it is now.
+ * 
+ * Used to estimate the latency a hedged request would have had without its
+ * hedge. A stream is assumed to keep sharing the server with as many streams
+ * as it does now.
+ * 
+ * @param id Id of the request.
+ * @param currTime The current time in clock cycles.
+ * @return The estimated completion time, currTime if the request is not in flight here.
+ */
+double WebServer::projectedFinish(uint32_t id, int currTime) {
+    accrue(currTime);
+    if (hasActiveRequest && currentRequest.getId() == id) {
+        return currTime + std::max(0.0, exclusiveDue() - currTime) * fault.slowFactor;
+    }
+    for (const auto& job : sharing.streams) {
+        if (job.request.getId() == id) {
+            return currTime + std::max(0.0, job.finishTag - sharing.virtualTime) *
+                              sharing.streams.size() * fault.slowFactor;
+        }
+    }
+    return currTime;
+}
+
+/**
+ * @brief Crashes the server, losing every in-flight request.
+ * 
+ * @param currTime The current time in clock cycles.
+ * @param recoverAt Cycle at which the server comes back.
+ */
+void WebServer::crash(int currTime, int recoverAt) {
+    accrue(currTime);
+    if (hasActiveRequest) {
+        fault.lost.push_back(currentRequest);
+        hasActiveRequest = false;
+    }
+    for (const auto& job : sharing.streams) {
+        fault.lost.push_back(job.request);
+    }
+    sharing.streams.clear();
+    fault.crashed = true;
+    fault.slowFactor = 1;
+    fault.recoverAt = recoverAt;
+}
+
+/**
+ * @brief Slows the server down.
+ * 
+ * @param currTime The current time in clock cycles.
+ * @param factor Work progresses at 1/factor of normal speed.
+ * @param recoverAt Cycle at which normal speed returns.
+ */
+void WebServer::slowDown(int currTime, int factor, int recoverAt) {
+    accrue(currTime);
+    fault.slowFactor = std::max(1, factor);
+    fault.recoverAt = recoverAt;
+}
+
+/**
+ * @brief Ends a crash or slowdown.
+ * 
+ * @param currTime The current time in clock cycles.
+ */
+void WebServer::recover(int currTime) {
+    accrue(currTime);
+    fault.crashed = false;
+    fault.slowFactor = 1;
+    fault.recoverAt = -1;
+}
+
+/**
+ * @brief Answers a health check.
+ * 
+ * A slow server still answers; only a crash fails the check.
+ * 
+ * @return True unless the server is down.
+ */
+bool WebServer::checkHealth() const {
+    return !fault.crashed;
+}
+
+/**
+ * @brief Records the outcome of a health check.
+ * 
+ * @param passed Whether the check passed.
+ * @return The number of consecutive failed checks.
+ */
+int WebServer::recordHealthCheck(bool passed) {
+    fault.failedChecks = passed ? 0 : fault.failedChecks + 1;
+    return fault.failedChecks;
+}
+
+/**
+ * @brief Takes the server in or out of the LoadBalancer's rotation.
+ * 
+ * @param value True to eject the server.
+ */
+void WebServer::setEjected(bool value) {
+    fault.ejected = value;
+}
+
+/**
+ * @brief Checks whether the LoadBalancer has ejected the server.
+ * 
+ * @return True while ejected.
+ */
+bool WebServer::isEjected() const {
+    return fault.ejected;
+}
+
+/**
+ * @brief Collects the requests lost to a crash.
+ * 
+ * @param lost Receives the lost requests; the server forgets them.
+ */
+void WebServer::takeLostRequests(std::vector<Request>& lost) {
+    lost.insert(lost.end(), fault.lost.begin(), fault.lost.end());
+    fault.lost.clear();
+}
+
+/**
+ * @brief Checks whether the server can start the given request now.
+ * 
+ * An exclusive request needs a completely idle server; an S request can join
+ * the running streams while a slot is free. A crashed server looks idle
+ * until it has been sent a request, which then hangs there.
+ * 
+ * @param next The request at the head of the queue.
+ * @return True if the request can be added without waiting.
+ */
+bool WebServer::canAccept(const Request& next) const {
+    if (hasActiveRequest || (fault.crashed && !fault.lost.empty())) {
+        return false;
+    }
+    if (sharing.slots == 0 || next.getJobType() != 'S') {
+        return sharing.streams.empty();
+    }
+    return sharing.streams.size() < static_cast<size_t>(sharing.slots);
+}
+
+/**
+ * @brief Gets how many more requests the server could start now.
+ * 
+ * A crashed server takes one more request, which hangs there.
+ * 
+ * @return An upper bound: exclusive requests need all of them, S requests take one each.
+ */
+int WebServer::getFreeSlots() const {
+    if (hasActiveRequest || (fault.crashed && !fault.lost.empty())) {
+        return 0;
+    }
+    if (sharing.slots == 0 || fault.crashed) {
+        return sharing.streams.empty() ? 1 : 0;
+    }
+    return sharing.slots - static_cast<int>(sharing.streams.size());
+}
+
+/**
+ * @brief Estimates the memory the server holds.
+ * 
+ * @return The object plus the capacity of its stream heap and lost-request list, in bytes.
+ */
+size_t WebServer::getMemoryBytes() const {
+    return sizeof(WebServer) + sharing.streams.capacity() * sizeof(StreamJob) +
+           fault.lost.capacity() * sizeof(Request);
+}
+
+/**
+ * @brief Sets the number of S requests the server streams concurrently.
+ * 
+ * @param slots Stream slots, 0 to keep the one-request-at-a-time model.
+ */
+void WebServer::setStreamSlots(int slots) {
+    sharing.slots = std::max(0, slots);
+}
+
+/**
+ * @brief Gets the number of stream slots.
+ * 
+ * @return The stream slots, 0 in the one-request-at-a-time model.
+ */
+int WebServer::getStreamSlots() const {
+    return sharing.slots;
+}
+
+/**
+ * @brief Gets the number of requests currently being processed.
+ * 
+ * @return Active streams plus the exclusive request, if any.
+ */
+int WebServer::getConcurrency() const {
+    return static_cast<int>(sharing.streams.size()) + (hasActiveRequest ? 1 : 0);
+}
+
+/**
+ * @brief Gets the integral of the number of active requests over time.
+ * 
+ * Dividing by the elapsed cycles gives the average concurrency.
+ * 
+ * @return Request-cycles of work in progress, up to the last update.
+ */
+double WebServer::getConcurrencyCycles() const {
+    return sharing.jobCycles;
+}
+
+/**
+ * @brief Gets the most requests the server has had active at once.
+ * 
+ * @return The peak concurrency.
+ */
+int WebServer::getPeakConcurrency() const {
+    return sharing.peakConcurrency;
+}
+
+/**
+ * @brief Advances virtual time and the concurrency integral to the given time.
+ * 
+ * @param until Simulation time to advance to; earlier times are ignored.
+ */
+void WebServer::accrue(double until) {
+    if (until <= sharing.clock) {
+        return;
+    }
+    double elapsed = until - sharing.clock;
+    sharing.jobCycles += elapsed * getConcurrency();
+    if (!sharing.streams.empty()) {
+        sharing.virtualTime += elapsed / (sharing.streams.size() * fault.slowFactor);
+    }
+    if (hasActiveRequest && fault.slowFactor > 1) {
+        fault.exclusiveLag += elapsed * (1.0 - 1.0 / fault.slowFactor);
+    }
+    sharing.clock = until;
+}
+
 /**
  * @brief Increments the count of processed requests.
  * 
@@ -81,10 +452,10 @@ int WebServer::getProcessedRequestCount() const {
 /**
  * @brief Checks if the server is currently idle.
  * 
- * @return True if the server has no active requests, false otherwise.
+ * @return True if the server has no active request or stream, false otherwise.
  */
 bool WebServer::isIdle() const {
-    return !hasActiveRequest;
+    return !hasActiveRequest && sharing.streams.empty();
 }
 
 /**
@@ -95,3 +466,75 @@ bool WebServer::isIdle() const {
 char WebServer::getName() const {
     return serverName;
 }
+
+/**
+ * @brief Gets the request currently assigned to the server.
+ * 
+ * @return The in-flight request (meaningless while the server is idle).
+ */
+const Request& WebServer::getCurrentRequest() const {
+    return currentRequest;
+}
+
+/**
+ * @brief Gets the (job-type adjusted) start time of the in-flight request.
+ * 
+ * @return The start time in clock cycles.
+ */
+int WebServer::getRequestStartTime() const {
+    return requestStartTime;
+}
+
+/**
+ * @brief Restores the server's state from a snapshot.
+ * 
+ * The start time is stored exactly as addRequest() left it, so the request
+ * completes on the same cycle it would have without the checkpoint.
+ * 
+ * @param req The in-flight request.
+ * @param startTime The stored start time, already adjusted for the job type.
+ * @param active Whether the request is still being processed.
+ * @param processedCount The number of requests the server had completed.
+ */
+void WebServer::restoreState(const Request& req, int startTime, bool active, int processedCount) {
+    currentRequest = req;
+    requestStartTime = startTime;
+    hasActiveRequest = active;
+    processedRequestCount = processedCount;
+}
+
+/**
+ * @brief Gets the processor-sharing state, for snapshots.
+ * 
+ * @return The stream state.
+ */
+const StreamState& WebServer::getStreamState() const {
+    return sharing;
+}
+
+/**
+ * @brief Restores the processor-sharing state from a snapshot.
+ * 
+ * @param state The saved stream state; its streams must already form a heap.
+ */
+void WebServer::restoreStreamState(const StreamState& state) {
+    sharing = state;
+}
+
+/**
+ * @brief Gets the fault and health state, for snapshots and the fault injector.
+ * 
+ * @return The fault state.
+ */
+const FaultState& WebServer::getFaultState() const {
+    return fault;
+}
+
+/**
+ * @brief Restores the fault and health state from a snapshot.
+ * 
+ * @param state The saved fault state.
+ */
+void WebServer::restoreFaultState(const FaultState& state) {
+    fault = state;
+}
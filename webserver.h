@@ -10,9 +10,57 @@
 #define WEBSERVER_H
 
 #include "request.h"
+#include <cstdint>
+#include <vector>
 
  //all doxygen comments are generated with AI assistance
 
+/**
+ * @brief A streaming request sharing a server under processor sharing.
+ */
+struct StreamJob {
+    double finishTag;   ///< Virtual time at which the stream's work is done.
+    uint64_t sequence;  ///< Admission order, breaks ties between equal tags.
+    Request request;    ///< The request being streamed.
+};
+
+/**
+ * @brief Processor-sharing and concurrency state of a WebServer.
+ *
+ * With n streams active, virtual time advances at 1/n per clock cycle, so a
+ * stream admitted at virtual time v with w cycles of work finishes when
+ * virtual time reaches v + w no matter how n changes in between. The streams
+ * are kept in a min-heap on that finish tag, so an arrival or departure costs
+ * O(log k) and a cycle without one costs O(1).
+ */
+struct StreamState {
+    int slots = 0;                  ///< Concurrent S streams allowed, 0 for the legacy one-at-a-time model.
+    double virtualTime = 0.0;       ///< Work done so far by every stream active since it started.
+    double clock = 0.0;             ///< Simulation time the state was last brought up to.
+    double jobCycles = 0.0;         ///< Integral of the number of active requests over time.
+    int peakConcurrency = 0;        ///< Most requests active at once.
+    uint64_t nextSequence = 0;      ///< Sequence number of the next admitted stream.
+    std::vector<StreamJob> streams; ///< Active streams, a heap ordered by finish tag.
+};
+
+/**
+ * @brief Fault and health state of a WebServer.
+ *
+ * A crash drops every in-flight request into the lost list (and so does any
+ * request sent to the server while it is down) until the LoadBalancer notices
+ * through a health check. A slowdown makes all work progress at 1/slowFactor
+ * of normal speed but passes health checks.
+ */
+struct FaultState {
+    bool crashed = false;       ///< Whether the server is down.
+    int slowFactor = 1;         ///< Work progresses at 1/slowFactor of normal speed.
+    int recoverAt = -1;         ///< Cycle the current fault ends, -1 when healthy.
+    double exclusiveLag = 0.0;  ///< Cycles the exclusive request has lost to slowdowns.
+    int failedChecks = 0;       ///< Consecutive failed health checks.
+    bool ejected = false;       ///< Whether the LoadBalancer took the server out of rotation.
+    std::vector<Request> lost;  ///< Requests lost to a crash and not yet collected.
+};
+
 /**
  * @class WebServer
  * @brief A class to represent a server that processes a request
@@ -42,6 +90,153 @@ public:
      */
     bool isRequestDone(int currTime);
 
+    /**
+     * @brief Completes every request that has finished by the given time.
+     * @param currTime The current time in clock cycles.
+     * @param done Receives the completed requests.
+     * @return The number of requests that completed.
+     */
+    int completeRequests(int currTime, std::vector<Request>& done);
+
+    /**
+     * @brief Removes an in-flight request, e.g. the losing copy of a hedged request.
+     *
+     * A copy lost to a crash and not yet collected is forgotten as well.
+     *
+     * @param id Id of the request to remove.
+     * @param currTime The current time in clock cycles.
+     * @param cancelled Receives the removed request.
+     * @return True if the request was in flight on this server.
+     */
+    bool cancelRequest(uint32_t id, int currTime, Request& cancelled);
+
+    /**
+     * @brief Lists the requests currently being processed.
+     * @param out Receives the exclusive request and every stream.
+     */
+    void inFlightRequests(std::vector<Request>& out) const;
+
+    /**
+     * @brief Estimates when an in-flight request would finish if its speed stayed as it is now.
+     * @param id Id of the request.
+     * @param currTime The current time in clock cycles.
+     * @return The estimated completion time, currTime if the request is not in flight here.
+     */
+    double projectedFinish(uint32_t id, int currTime);
+
+    /**
+     * @brief Crashes the server, losing every in-flight request.
+     * @param currTime The current time in clock cycles.
+     * @param recoverAt Cycle at which the server comes back.
+     */
+    void crash(int currTime, int recoverAt);
+
+    /**
+     * @brief Slows the server down.
+     * @param currTime The current time in clock cycles.
+     * @param factor Work progresses at 1/factor of normal speed.
+     * @param recoverAt Cycle at which normal speed returns.
+     */
+    void slowDown(int currTime, int factor, int recoverAt);
+
+    /**
+     * @brief Ends a crash or slowdown.
+     * @param currTime The current time in clock cycles.
+     */
+    void recover(int currTime);
+
+    /**
+     * @brief Answers a health check.
+     * @return True unless the server is down.
+     */
+    bool checkHealth() const;
+
+    /**
+     * @brief Records the outcome of a health check.
+     * @param passed Whether the check passed.
+     * @return The number of consecutive failed checks.
+     */
+    int recordHealthCheck(bool passed);
+
+    /**
+     * @brief Takes the server in or out of the LoadBalancer's rotation.
+     * @param value True to eject the server.
+     */
+    void setEjected(bool value);
+
+    /**
+     * @brief Checks whether the LoadBalancer has ejected the server.
+     * @return True while ejected.
+     */
+    bool isEjected() const;
+
+    /**
+     * @brief Collects the requests lost to a crash.
+     * @param lost Receives the lost requests; the server forgets them.
+     */
+    void takeLostRequests(std::vector<Request>& lost);
+
+    /**
+     * @brief Gets the fault and health state, for snapshots and the fault injector.
+     * @return The fault state.
+     */
+    const FaultState& getFaultState() const;
+
+    /**
+     * @brief Restores the fault and health state from a snapshot.
+     * @param state The saved fault state.
+     */
+    void restoreFaultState(const FaultState& state);
+
+    /**
+     * @brief Checks whether the server can start the given request now.
+     * @param next The request at the head of the queue.
+     * @return True if the request can be added without waiting.
+     */
+    bool canAccept(const Request& next) const;
+
+    /**
+     * @brief Gets how many more requests the server could start now.
+     * @return An upper bound: exclusive requests need all of them, S requests take one each.
+     */
+    int getFreeSlots() const;
+
+    /**
+     * @brief Estimates the memory the server holds.
+     * @return The object plus the capacity of its stream heap and lost-request list, in bytes.
+     */
+    size_t getMemoryBytes() const;
+
+    /**
+     * @brief Sets the number of S requests the server streams concurrently.
+     * @param slots Stream slots, 0 to keep the one-request-at-a-time model.
+     */
+    void setStreamSlots(int slots);
+
+    /**
+     * @brief Gets the number of stream slots.
+     * @return The stream slots, 0 in the one-request-at-a-time model.
+     */
+    int getStreamSlots() const;
+
+    /**
+     * @brief Gets the number of requests currently being processed.
+     * @return Active streams plus the exclusive request, if any.
+     */
+    int getConcurrency() const;
+
+    /**
+     * @brief Gets the integral of the number of active requests over time.
+     * @return Request-cycles of work in progress, up to the last update.
+     */
+    double getConcurrencyCycles() const;
+
+    /**
+     * @brief Gets the most requests the server has had active at once.
+     * @return The peak concurrency.
+     */
+    int getPeakConcurrency() const;
+
     /**
      * @brief Checks if the server is currently idle.
      * @return True if the server has no active requests, false otherwise.
@@ -65,12 +260,59 @@ public:
      */
     int getProcessedRequestCount() const;
 
+    /**
+     * @brief Gets the request currently assigned to the server.
+     * @return The in-flight request (meaningless while the server is idle).
+     */
+    const Request& getCurrentRequest() const;
+
+    /**
+     * @brief Gets the (job-type adjusted) start time of the in-flight request.
+     * @return The start time in clock cycles.
+     */
+    int getRequestStartTime() const;
+
+    /**
+     * @brief Restores the server's state from a snapshot.
+     * @param req The in-flight request.
+     * @param startTime The stored start time, already adjusted for the job type.
+     * @param active Whether the request is still being processed.
+     * @param processedCount The number of requests the server had completed.
+     */
+    void restoreState(const Request& req, int startTime, bool active, int processedCount);
+
+    /**
+     * @brief Gets the processor-sharing state, for snapshots.
+     * @return The stream state.
+     */
+    const StreamState& getStreamState() const;
+
+    /**
+     * @brief Restores the processor-sharing state from a snapshot.
+     * @param state The saved stream state.
+     */
+    void restoreStreamState(const StreamState& state);
+
 private:
+    /**
+     * @brief Advances virtual time and the concurrency integral to the given time.
+     * @param until Simulation time to advance to.
+     */
+    void accrue(double until);
+
+    /**
+     * @brief Gets when the exclusive request is due at normal speed, including time already lost.
+     * @return The due time in clock cycles.
+     */
+    double exclusiveDue() const;
+
     char serverName; ///< The name of the server.
     Request currentRequest; ///< The request currently being processed.
     int requestStartTime; ///< The time when the current request started processing.
     bool hasActiveRequest = false; ///< Flag indicating if there is an active request.
     int processedRequestCount = 0; ///< Count of processed requests.
+    StreamState sharing; ///< Streams shared under processor sharing and concurrency statistics.
+    FaultState fault; ///< Injected faults and the LoadBalancer's view of the server's health.
 };
 
 #endif